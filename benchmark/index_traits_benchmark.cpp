@@ -0,0 +1,134 @@
+#include "search_server.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <execution>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    using Clock = chrono::steady_clock;
+
+    const int VOCABULARY_SIZE = 50000;
+    const int WORDS_IN_DOCUMENT = 12;
+    const int PLUS_WORDS_IN_QUERY = 3;
+
+    // Word frequencies fall roughly as in natural texts: a few words are in many documents, most are rare
+    string RandomWord(mt19937 &generator)
+    {
+        uniform_real_distribution<double> uniform(0.0, 1.0);
+        const double x = uniform(generator);
+        return "w"s + to_string(static_cast<int>(x * x * x * VOCABULARY_SIZE));
+    }
+
+    vector<string> GenerateTexts(int document_count)
+    {
+        mt19937 generator(1);
+        vector<string> texts(document_count);
+        for (string &text : texts)
+        {
+            for (int i = 0; i < WORDS_IN_DOCUMENT; ++i)
+            {
+                text += RandomWord(generator) + " "s;
+            }
+        }
+        return texts;
+    }
+
+    // Plus words and one minus word
+    vector<string> GenerateQueries(int query_count)
+    {
+        mt19937 generator(2);
+        vector<string> queries(query_count);
+        for (string &query : queries)
+        {
+            for (int i = 0; i < PLUS_WORDS_IN_QUERY; ++i)
+            {
+                query += RandomWord(generator) + " "s;
+            }
+            query += "-"s + RandomWord(generator);
+        }
+        return queries;
+    }
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return chrono::duration<double, milli>(Clock::now() - start).count();
+    }
+
+    template <typename Traits>
+    vector<vector<int64_t>> Run(const string &name, const vector<string> &texts, const vector<string> &queries)
+    {
+        using Server = BasicSearchServer<Traits>;
+        Server search_server(""s);
+
+        vector<typename Server::NewDocument> documents(texts.size());
+        for (size_t id = 0; id < texts.size(); ++id)
+        {
+            documents[id] = {static_cast<typename Server::DocumentId>(id), texts[id], DocumentStatus::ACTUAL,
+                             {static_cast<int>(id % 10)}};
+        }
+        auto start = Clock::now();
+        search_server.AddDocuments(execution::seq, documents);
+        const double add_ms = MillisecondsSince(start);
+
+        vector<vector<int64_t>> top_ids;
+        top_ids.reserve(queries.size());
+        start = Clock::now();
+        for (const string &query : queries)
+        {
+            top_ids.emplace_back();
+            for (const auto &document : search_server.FindTopDocuments(query))
+            {
+                top_ids.back().push_back(static_cast<int64_t>(document.id));
+            }
+        }
+        const double query_ms = MillisecondsSince(start);
+
+        const MemoryStats memory = search_server.GetMemoryStats();
+        cout << left << setw(24) << name << right << fixed << setprecision(1)
+             << setw(10) << add_ms
+             << setw(10) << query_ms
+             << setw(12) << memory.terms / 1048576.0
+             << setw(12) << memory.Total() / 1048576.0;
+        return top_ids;
+    }
+
+    void PrintAgreement(const vector<vector<int64_t>> &expected, const vector<vector<int64_t>> &actual)
+    {
+        size_t same = 0;
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            same += expected[i] == actual[i];
+        }
+        cout << setw(10) << setprecision(2) << 100.0 * same / expected.size() << '%' << endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const int document_count = argc > 1 ? atoi(argv[1]) : 200000;
+    const int query_count = argc > 2 ? atoi(argv[2]) : 1000;
+
+    const auto texts = GenerateTexts(document_count);
+    const auto queries = GenerateQueries(query_count);
+
+    cout << document_count << " documents, " << query_count << " queries" << endl;
+    cout << left << setw(24) << "traits" << right
+         << setw(10) << "add ms"
+         << setw(10) << "query ms"
+         << setw(12) << "terms MB"
+         << setw(12) << "total MB"
+         << setw(11) << "same top" << endl;
+
+    const auto expected = Run<DefaultIndexTraits>("int/double/tree", texts, queries);
+    PrintAgreement(expected, expected);
+    PrintAgreement(expected, Run<CompactIndexTraits>("uint32/float/flat", texts, queries));
+    PrintAgreement(expected, Run<WideIndexTraits>("int64/double/tree", texts, queries));
+}
@@ -0,0 +1,220 @@
+#include "load_generator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <execution>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    using Clock = chrono::steady_clock;
+
+    template <typename ExecutionPolicy>
+    size_t Execute(ExecutionPolicy policy, const SearchServer &search_server, const LoggedQuery &query)
+    {
+        switch (query.filter)
+        {
+        case QueryFilter::MIN_RATING:
+            return search_server
+                .FindTopDocuments(policy, query.text,
+                                  [min_rating = query.min_rating](int, DocumentStatus, int rating)
+                                  {
+                                      return rating >= min_rating;
+                                  })
+                .size();
+        case QueryFilter::EVEN_ID:
+            return search_server
+                .FindTopDocuments(policy, query.text,
+                                  [](int document_id, DocumentStatus, int)
+                                  {
+                                      return document_id % 2 == 0;
+                                  })
+                .size();
+        default:
+            return search_server.FindTopDocuments(policy, query.text, query.status).size();
+        }
+    }
+
+    size_t Execute(PolicyKind policy, const SearchServer &search_server, const LoggedQuery &query)
+    {
+        switch (policy)
+        {
+        case PolicyKind::PAR:
+            return Execute(execution::par, search_server, query);
+        case PolicyKind::AUTO:
+            return Execute(auto_policy, search_server, query);
+        default:
+            return Execute(execution::seq, search_server, query);
+        }
+    }
+
+    double Microseconds(Clock::duration duration)
+    {
+        return chrono::duration<double, micro>(duration).count();
+    }
+
+    struct ThreadResult
+    {
+        vector<double> latencies;
+        vector<double> service_times;
+        size_t requests = 0;
+        size_t errors = 0;
+        size_t found = 0;
+        size_t late = 0;
+        size_t unsent = 0;
+    };
+
+    void Replay(PolicyKind policy, const SearchServer &search_server, const LoggedQuery &query, ThreadResult &result)
+    {
+        ++result.requests;
+        try
+        {
+            result.found += Execute(policy, search_server, query);
+        }
+        catch (const exception &)
+        {
+            ++result.errors;
+        }
+    }
+
+    void RunClosedLoop(const SearchServer &search_server, const vector<LoggedQuery> &queries,
+                       const LoadOptions &options, Clock::time_point deadline, atomic<size_t> &next_query,
+                       ThreadResult &result)
+    {
+        while (Clock::now() < deadline)
+        {
+            const LoggedQuery &query = queries[next_query.fetch_add(1, memory_order_relaxed) % queries.size()];
+            const auto sent = Clock::now();
+            Replay(options.policy, search_server, query, result);
+            result.latencies.push_back(Microseconds(Clock::now() - sent));
+        }
+    }
+
+    void RunOpenLoop(const SearchServer &search_server, const vector<LoggedQuery> &queries,
+                     const LoadOptions &options, Clock::time_point start, Clock::time_point deadline,
+                     atomic<size_t> &next_query, ThreadResult &result)
+    {
+        const chrono::duration<double> interval(1.0 / options.target_qps);
+        // Queries due before the deadline are still sent after it, for at most the duration of the run once more
+        const auto drain_deadline = deadline + (deadline - start);
+        while (true)
+        {
+            const size_t index = next_query.fetch_add(1, memory_order_relaxed);
+            const auto due = start + chrono::duration_cast<Clock::duration>(interval * static_cast<double>(index));
+            if (due >= deadline)
+            {
+                return;
+            }
+            this_thread::sleep_until(due);
+            const auto sent = Clock::now();
+            if (sent >= drain_deadline)
+            {
+                // Never sent: the wait up to the end of the drain is a lower bound of its latency
+                result.latencies.push_back(Microseconds(drain_deadline - due));
+                ++result.unsent;
+                continue;
+            }
+            if (sent >= deadline)
+            {
+                ++result.late;
+            }
+            Replay(options.policy, search_server, queries[index % queries.size()], result);
+            const auto done = Clock::now();
+            result.latencies.push_back(Microseconds(done - due));
+            result.service_times.push_back(Microseconds(done - sent));
+        }
+    }
+
+    vector<double> MergeSorted(vector<ThreadResult> &results, vector<double> ThreadResult::*samples)
+    {
+        vector<double> merged;
+        for (ThreadResult &result : results)
+        {
+            merged.insert(merged.end(), (result.*samples).begin(), (result.*samples).end());
+            (result.*samples) = {};
+        }
+        sort(merged.begin(), merged.end());
+        return merged;
+    }
+}
+
+double LoadReport::GetThroughput() const
+{
+    return elapsed_seconds > 0.0 ? requests / elapsed_seconds : 0.0;
+}
+
+LoadReport RunLoad(const SearchServer &search_server, const vector<LoggedQuery> &queries, const LoadOptions &options)
+{
+    CheckLoadOptions(options);
+    if (queries.empty())
+    {
+        throw invalid_argument("Empty query log"s);
+    }
+
+    vector<ThreadResult> results(options.threads);
+    atomic<size_t> next_query = 0;
+    const auto start = Clock::now();
+    const auto deadline = start + chrono::duration_cast<Clock::duration>(options.duration);
+    vector<thread> threads;
+    for (int i = 0; i < options.threads; ++i)
+    {
+        threads.emplace_back([&, i]
+                             {
+                                 if (options.mode == LoopMode::OPEN)
+                                 {
+                                     RunOpenLoop(search_server, queries, options, start, deadline, next_query, results[i]);
+                                 }
+                                 else
+                                 {
+                                     RunClosedLoop(search_server, queries, options, deadline, next_query, results[i]);
+                                 }
+                             });
+    }
+    for (thread &t : threads)
+    {
+        t.join();
+    }
+
+    LoadReport report;
+    report.elapsed_seconds = chrono::duration<double>(Clock::now() - start).count();
+    for (const ThreadResult &result : results)
+    {
+        report.requests += result.requests;
+        report.errors += result.errors;
+        report.documents_found += result.found;
+        report.late += result.late;
+        report.unsent += result.unsent;
+    }
+    report.latencies = MergeSorted(results, &ThreadResult::latencies);
+    report.service_times = MergeSorted(results, &ThreadResult::service_times);
+    return report;
+}
+
+void CheckLoadOptions(const LoadOptions &options)
+{
+    if (options.threads < 1)
+    {
+        throw invalid_argument("At least one thread is required"s);
+    }
+    if (options.duration.count() <= 0.0)
+    {
+        throw invalid_argument("Duration must be positive"s);
+    }
+    if (options.mode == LoopMode::OPEN && !(options.target_qps > 0.0))
+    {
+        throw invalid_argument("Open loop requires a positive target QPS"s);
+    }
+}
+
+double Percentile(const vector<double> &sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+    const size_t index = min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+    return sorted[index];
+}
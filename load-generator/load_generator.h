@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "search_server.h"
+#include "workload.h"
+
+enum class LoopMode
+{
+    CLOSED, // every thread sends its next query as soon as the previous one returns
+    OPEN,   // queries are due at a fixed rate whether or not the earlier ones have returned
+};
+
+enum class PolicyKind
+{
+    SEQ,
+    PAR,
+    AUTO,
+};
+
+struct LoadOptions
+{
+    LoopMode mode = LoopMode::CLOSED;
+    int threads = 1;
+    std::chrono::duration<double> duration = std::chrono::seconds(10);
+    // Open loop only: query k is due at start + k / target_qps
+    double target_qps = 0.0;
+    PolicyKind policy = PolicyKind::SEQ;
+};
+
+struct LoadReport
+{
+    size_t requests = 0;
+    // Queries that threw, e.g. a malformed query in the log
+    size_t errors = 0;
+    size_t documents_found = 0;
+    // Open loop only. Queries due before the deadline are sent after it too, while the run is drained for at most
+    // its duration once more. Late ones were sent after the deadline, unsent ones not even by the end of the drain.
+    // Either means the target rate was not held
+    size_t late = 0;
+    size_t unsent = 0;
+    double elapsed_seconds = 0.0;
+    // Microseconds, sorted. In the open loop a latency is counted from the time the query was due, so the wait
+    // behind slow queries is included (coordinated omission correction); service_times start when it was sent.
+    // An unsent query gets the time from its due time to the end of the drain, a lower bound of its latency
+    std::vector<double> latencies;
+    std::vector<double> service_times;
+
+    double GetThroughput() const;
+};
+
+// Replays `queries` in log order, wrapping around, from options.threads threads until options.duration passes.
+// The server must not be modified during the call
+LoadReport RunLoad(const SearchServer &search_server, const std::vector<LoggedQuery> &queries,
+                   const LoadOptions &options);
+
+// Throws std::invalid_argument
+void CheckLoadOptions(const LoadOptions &options);
+
+double Percentile(const std::vector<double> &sorted, double fraction);
@@ -0,0 +1,205 @@
+#include "load_generator.h"
+#include "workload.h"
+
+#include <chrono>
+#include <execution>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    using Clock = chrono::steady_clock;
+
+    const int WORDS_IN_DOCUMENT = 10;
+    const int WORDS_IN_QUERY = 3;
+    const int VOCABULARY_SIZE = 2000;
+
+    const char USAGE[] =
+        "load_generator [--corpus FILE | --documents N] [--queries FILE | --query-count N]\n"
+        "               [--mode closed|open] [--qps Q] [--threads N] [--seconds S] [--policy seq|par|auto]\n"
+        "               [--scoring exact|impact] [--fuzzy DISTANCE] [--prefix] [--stop-words \"words\"]\n";
+
+    const set<string> KNOWN_ARGUMENTS = {"corpus"s, "documents"s, "queries"s, "query-count"s, "mode"s, "qps"s,
+                                         "threads"s, "seconds"s, "policy"s, "scoring"s, "fuzzy"s, "prefix"s,
+                                         "stop-words"s};
+
+    // --name value pairs; flags without a value map to an empty string
+    map<string, string> ParseArguments(int argc, char *argv[])
+    {
+        map<string, string> arguments;
+        for (int i = 1; i < argc; ++i)
+        {
+            const string name = argv[i];
+            if (name.size() < 3 || name.substr(0, 2) != "--"s || KNOWN_ARGUMENTS.count(name.substr(2)) == 0)
+            {
+                throw invalid_argument("Unexpected argument "s + name);
+            }
+            if (name == "--prefix"s)
+            {
+                arguments[name.substr(2)];
+                continue;
+            }
+            if (i + 1 == argc)
+            {
+                throw invalid_argument("Missing value of "s + name);
+            }
+            arguments[name.substr(2)] = argv[++i];
+        }
+        return arguments;
+    }
+
+    string GetArgument(const map<string, string> &arguments, const string &name, const string &default_value)
+    {
+        const auto it = arguments.find(name);
+        return it == arguments.end() ? default_value : it->second;
+    }
+
+    ifstream OpenFile(const string &path)
+    {
+        ifstream input(path);
+        if (!input)
+        {
+            throw runtime_error("Cannot open "s + path);
+        }
+        return input;
+    }
+
+    LoadOptions MakeLoadOptions(const map<string, string> &arguments)
+    {
+        LoadOptions options;
+        const string mode = GetArgument(arguments, "mode"s, "closed"s);
+        if (mode == "open"s)
+        {
+            options.mode = LoopMode::OPEN;
+        }
+        else if (mode != "closed"s)
+        {
+            throw invalid_argument("Unknown mode "s + mode);
+        }
+        options.target_qps = stod(GetArgument(arguments, "qps"s, "0"s));
+        options.threads = stoi(GetArgument(arguments, "threads"s, to_string(max(1u, thread::hardware_concurrency()))));
+        options.duration = chrono::duration<double>(stod(GetArgument(arguments, "seconds"s, "10"s)));
+        const string policy = GetArgument(arguments, "policy"s, "seq"s);
+        if (policy == "par"s)
+        {
+            options.policy = PolicyKind::PAR;
+        }
+        else if (policy == "auto"s)
+        {
+            options.policy = PolicyKind::AUTO;
+        }
+        else if (policy != "seq"s)
+        {
+            throw invalid_argument("Unknown policy "s + policy);
+        }
+        CheckLoadOptions(options);
+        return options;
+    }
+
+    void ConfigureServer(SearchServer &search_server, const map<string, string> &arguments)
+    {
+        const string scoring = GetArgument(arguments, "scoring"s, "exact"s);
+        if (scoring == "impact"s)
+        {
+            search_server.SetScoringMode(ScoringMode::IMPACT);
+        }
+        else if (scoring != "exact"s)
+        {
+            throw invalid_argument("Unknown scoring mode "s + scoring);
+        }
+        if (arguments.count("fuzzy"s) > 0)
+        {
+            FuzzyOptions fuzzy_options;
+            fuzzy_options.max_edit_distance = stoi(arguments.at("fuzzy"s));
+            search_server.EnableFuzzySearch(fuzzy_options);
+        }
+        if (arguments.count("prefix"s) > 0)
+        {
+            search_server.EnablePrefixSearch();
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        const map<string, string> arguments = ParseArguments(argc, argv);
+        const LoadOptions options = MakeLoadOptions(arguments);
+
+        Corpus corpus;
+        if (arguments.count("corpus"s) > 0)
+        {
+            ifstream input = OpenFile(arguments.at("corpus"s));
+            corpus = ReadCorpus(input);
+        }
+        else
+        {
+            const int documents = stoi(GetArgument(arguments, "documents"s, "100000"s));
+            corpus = GenerateCorpus(documents, WORDS_IN_DOCUMENT, VOCABULARY_SIZE, 1);
+        }
+        vector<LoggedQuery> queries;
+        if (arguments.count("queries"s) > 0)
+        {
+            ifstream input = OpenFile(arguments.at("queries"s));
+            queries = ReadQueryLog(input);
+        }
+        else
+        {
+            const int query_count = stoi(GetArgument(arguments, "query-count"s, "10000"s));
+            queries = GenerateQueryLog(query_count, WORDS_IN_QUERY, VOCABULARY_SIZE, 2);
+        }
+
+        SearchServer search_server(GetArgument(arguments, "stop-words"s, ""s));
+        ConfigureServer(search_server, arguments);
+        const auto load_start = Clock::now();
+        search_server.AddDocuments(execution::par, corpus.documents);
+        cout << "Loaded "s << search_server.GetDocumentCount() << " documents in "s
+             << chrono::duration<double>(Clock::now() - load_start).count() << " s, replaying "s << queries.size()
+             << " queries"s << endl;
+
+        if (options.policy == PolicyKind::AUTO)
+        {
+            // Before the timed replay, so the first auto query does not calibrate
+            cout << "Parallel threshold: "s << CalibrateParallelThreshold() << " postings"s << endl;
+        }
+
+        const LoadReport report = RunLoad(search_server, queries, options);
+
+        cout << "Requests: "s << report.requests << ", errors: "s << report.errors
+             << ", documents found: "s << report.documents_found << endl;
+        if (report.late > 0 || report.unsent > 0)
+        {
+            cout << "Sent after the deadline: "s << report.late << ", not sent: "s << report.unsent << endl;
+        }
+        cout << "Throughput: "s << static_cast<int>(report.GetThroughput()) << " QPS"s;
+        if (options.mode == LoopMode::OPEN)
+        {
+            cout << " (target "s << options.target_qps << ")"s;
+        }
+        cout << endl;
+        cout << "Latency, us: p50 = "s << Percentile(report.latencies, 0.5)
+             << ", p99 = "s << Percentile(report.latencies, 0.99)
+             << ", p999 = "s << Percentile(report.latencies, 0.999) << endl;
+        if (options.mode == LoopMode::OPEN)
+        {
+            cout << "Service time, us: p50 = "s << Percentile(report.service_times, 0.5)
+                 << ", p99 = "s << Percentile(report.service_times, 0.99)
+                 << ", p999 = "s << Percentile(report.service_times, 0.999) << endl;
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << "Load generator failed: "s << e.what() << endl
+             << USAGE;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include "load_generator.h"
+#include "test_example_functions.h"
+#include "workload.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+void TestReadCorpus()
+{
+    istringstream input("5\tBANNED\t1 -2 4\tcurly cat\n"
+                        "\n"
+                        "plain text\n"
+                        "9\tACTUAL\t\tdog\n"s);
+    Corpus read = ReadCorpus(input);
+    // The texts of the documents point into the corpus, a move keeps them valid
+    const Corpus corpus = move(read);
+    ASSERT_EQUAL(corpus.documents.size(), 3u);
+    ASSERT_EQUAL(corpus.documents[0].id, 5);
+    ASSERT(corpus.documents[0].status == DocumentStatus::BANNED);
+    ASSERT((corpus.documents[0].ratings == vector<int>{1, -2, 4}));
+    ASSERT_EQUAL(corpus.documents[0].text, "curly cat"sv);
+    // A line without tabs is an ACTUAL document with the next id
+    ASSERT_EQUAL(corpus.documents[1].id, 6);
+    ASSERT(corpus.documents[1].status == DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(corpus.documents[1].text, "plain text"sv);
+    ASSERT(corpus.documents[2].ratings.empty());
+
+    for (const string &malformed : {"1\tACTUAL\tdog\n"s, "x\tACTUAL\t1\tdog\n"s, "1\tDELETED\t1\tdog\n"s})
+    {
+        istringstream malformed_input("cat\n"s + malformed);
+        try
+        {
+            ReadCorpus(malformed_input);
+            ASSERT_HINT(false, malformed);
+        }
+        catch (const invalid_argument &e)
+        {
+            ASSERT_HINT(string(e.what()).find("Line 2"s) == 0, e.what());
+        }
+    }
+}
+
+void TestReadQueryLog()
+{
+    istringstream input("curly cat\n"
+                        "BANNED\tnasty dog\n"
+                        "\n"
+                        "rating>=5\tcat -dog\n"
+                        "even\tcat\n"s);
+    const vector<LoggedQuery> queries = ReadQueryLog(input);
+    ASSERT_EQUAL(queries.size(), 4u);
+    ASSERT(queries[0].filter == QueryFilter::STATUS && queries[0].status == DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(queries[0].text, "curly cat"s);
+    ASSERT(queries[1].filter == QueryFilter::STATUS && queries[1].status == DocumentStatus::BANNED);
+    ASSERT(queries[2].filter == QueryFilter::MIN_RATING && queries[2].min_rating == 5);
+    ASSERT_EQUAL(queries[2].text, "cat -dog"s);
+    ASSERT(queries[3].filter == QueryFilter::EVEN_ID);
+    ASSERT_THROWS(ParseLoggedQuery("SOMETIMES\tcat"sv), invalid_argument);
+}
+
+void TestGeneratedWorkloadIsReproducible()
+{
+    const Corpus first = GenerateCorpus(50, 5, 100, 7);
+    const Corpus second = GenerateCorpus(50, 5, 100, 7);
+    ASSERT(first.texts == second.texts);
+    ASSERT_EQUAL(first.documents.size(), 50u);
+    ASSERT_EQUAL(first.documents[49].id, 49);
+    ASSERT_EQUAL(first.documents[10].text, first.texts[10]);
+
+    const auto queries = GenerateQueryLog(20, 3, 100, 8);
+    const auto same_queries = GenerateQueryLog(20, 3, 100, 8);
+    ASSERT_EQUAL(queries.size(), 20u);
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+        ASSERT_EQUAL(queries[i].text, same_queries[i].text);
+    }
+    // Every filter kind is in the mix
+    for (QueryFilter filter : {QueryFilter::STATUS, QueryFilter::MIN_RATING, QueryFilter::EVEN_ID})
+    {
+        ASSERT(any_of(queries.begin(), queries.end(), [filter](const LoggedQuery &query)
+                      {
+                          return query.filter == filter;
+                      }));
+    }
+}
+
+void TestPercentile()
+{
+    ASSERT_EQUAL(Percentile({}, 0.5), 0.0);
+    vector<double> sorted;
+    for (int i = 1; i <= 1000; ++i)
+    {
+        sorted.push_back(i);
+    }
+    ASSERT_EQUAL(Percentile(sorted, 0.0), 1.0);
+    ASSERT_EQUAL(Percentile(sorted, 0.5), 501.0);
+    ASSERT_EQUAL(Percentile(sorted, 0.999), 1000.0);
+    ASSERT_EQUAL(Percentile(sorted, 1.0), 1000.0);
+}
+
+void TestLoadOptionsAreChecked()
+{
+    LoadOptions options;
+    options.threads = 0;
+    ASSERT_THROWS(CheckLoadOptions(options), invalid_argument);
+    options.threads = 1;
+    options.duration = chrono::seconds(0);
+    ASSERT_THROWS(CheckLoadOptions(options), invalid_argument);
+    options.duration = chrono::seconds(1);
+    options.mode = LoopMode::OPEN;
+    ASSERT_THROWS(CheckLoadOptions(options), invalid_argument);
+    options.target_qps = 10.0;
+    CheckLoadOptions(options);
+
+    const SearchServer search_server(""s);
+    ASSERT_THROWS(RunLoad(search_server, {}, options), invalid_argument);
+}
+
+void TestClosedLoop()
+{
+    Corpus corpus = GenerateCorpus(500, 5, 50, 1);
+    SearchServer search_server(""s);
+    search_server.AddDocuments(corpus.documents);
+    vector<LoggedQuery> queries = GenerateQueryLog(10, 2, 50, 2);
+    queries.push_back(ParseLoggedQuery("w1 --w2"sv));
+
+    LoadOptions options;
+    options.threads = 2;
+    options.duration = chrono::milliseconds(200);
+    for (PolicyKind policy : {PolicyKind::SEQ, PolicyKind::PAR})
+    {
+        options.policy = policy;
+        const LoadReport report = RunLoad(search_server, queries, options);
+        ASSERT(report.requests > queries.size());
+        ASSERT_EQUAL(report.latencies.size(), report.requests);
+        ASSERT(is_sorted(report.latencies.begin(), report.latencies.end()));
+        ASSERT(report.service_times.empty());
+        // One query of the log is malformed
+        ASSERT(report.errors > 0 && report.errors <= report.requests / queries.size() + options.threads);
+        ASSERT(report.documents_found > 0);
+        ASSERT(report.elapsed_seconds >= 0.2);
+        ASSERT_EQUAL(report.unsent, 0u);
+    }
+}
+
+void TestOpenLoop()
+{
+    Corpus corpus = GenerateCorpus(200, 5, 50, 3);
+    SearchServer search_server(""s);
+    search_server.AddDocuments(corpus.documents);
+    const vector<LoggedQuery> queries = GenerateQueryLog(10, 2, 50, 4);
+
+    LoadOptions options;
+    options.mode = LoopMode::OPEN;
+    options.threads = 2;
+    options.target_qps = 200.0;
+    options.duration = chrono::milliseconds(300);
+    const LoadReport report = RunLoad(search_server, queries, options);
+    // Queries are sent on schedule, not as fast as possible; the last due time may round below the deadline
+    const size_t due = static_cast<size_t>(ceil(0.3 * 200.0));
+    ASSERT(report.requests <= due + 1);
+    ASSERT(report.requests + report.unsent >= due);
+    ASSERT_EQUAL(report.service_times.size(), report.requests);
+    ASSERT_EQUAL(report.latencies.size(), report.requests + report.unsent);
+    // A latency counts from the due time, so it is never shorter than the service time
+    ASSERT(Percentile(report.latencies, 0.5) >= Percentile(report.service_times, 0.5));
+    ASSERT(report.GetThroughput() <= options.target_qps * 1.5);
+}
+
+void TestOverloadedOpenLoopKeepsTheTail()
+{
+    // Every query matches most of the corpus, far slower than the target rate
+    Corpus corpus = GenerateCorpus(20000, 20, 30, 5);
+    SearchServer search_server(""s);
+    search_server.AddDocuments(corpus.documents);
+    const vector<LoggedQuery> queries = GenerateQueryLog(10, 3, 30, 6);
+
+    LoadOptions options;
+    options.mode = LoopMode::OPEN;
+    options.threads = 1;
+    options.target_qps = 1e6;
+    options.duration = chrono::milliseconds(200);
+    const LoadReport report = RunLoad(search_server, queries, options);
+    // Queries due before the deadline are sent after it, the rest get a lower bound, none are left out
+    ASSERT(report.late > 0);
+    ASSERT(report.unsent > 0);
+    ASSERT_EQUAL(report.service_times.size(), report.requests);
+    ASSERT_EQUAL(report.latencies.size(), report.requests + report.unsent);
+    // 0.2 s at 1e6 QPS, the last due time may round below the deadline
+    ASSERT(report.latencies.size() >= 200000u && report.latencies.size() <= 200001u);
+    ASSERT(report.elapsed_seconds >= 0.4);
+    // The queue keeps growing, so the tail is longer than the whole run, which no query sent before the
+    // deadline could show
+    ASSERT(Percentile(report.latencies, 0.99) > 200000.0);
+}
+
+int main()
+{
+    RUN_TEST(TestReadCorpus);
+    RUN_TEST(TestReadQueryLog);
+    RUN_TEST(TestGeneratedWorkloadIsReproducible);
+    RUN_TEST(TestPercentile);
+    RUN_TEST(TestLoadOptionsAreChecked);
+    RUN_TEST(TestClosedLoop);
+    RUN_TEST(TestOpenLoop);
+    RUN_TEST(TestOverloadedOpenLoopKeepsTheTail);
+    return 0;
+}
@@ -0,0 +1,234 @@
+#include "workload.h"
+
+#include <random>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+    vector<string_view> SplitByTab(string_view line)
+    {
+        vector<string_view> fields;
+        while (true)
+        {
+            const size_t tab = line.find('\t');
+            fields.push_back(line.substr(0, tab));
+            if (tab == string_view::npos)
+            {
+                return fields;
+            }
+            line.remove_prefix(tab + 1);
+        }
+    }
+
+    DocumentStatus ParseStatus(string_view name)
+    {
+        if (name == "ACTUAL"sv)
+        {
+            return DocumentStatus::ACTUAL;
+        }
+        if (name == "IRRELEVANT"sv)
+        {
+            return DocumentStatus::IRRELEVANT;
+        }
+        if (name == "BANNED"sv)
+        {
+            return DocumentStatus::BANNED;
+        }
+        if (name == "REMOVED"sv)
+        {
+            return DocumentStatus::REMOVED;
+        }
+        throw invalid_argument("Unknown status "s + string(name));
+    }
+
+    vector<int> ParseRatings(string_view text)
+    {
+        vector<int> ratings;
+        while (!text.empty())
+        {
+            const size_t space = text.find(' ');
+            const string_view rating = text.substr(0, space);
+            if (!rating.empty())
+            {
+                ratings.push_back(stoi(string(rating)));
+            }
+            text.remove_prefix(space == string_view::npos ? text.size() : space + 1);
+        }
+        return ratings;
+    }
+
+    string RandomText(mt19937 &generator, int word_count, int vocabulary_size)
+    {
+        uniform_int_distribution<int> word(0, vocabulary_size - 1);
+        string text;
+        for (int i = 0; i < word_count; ++i)
+        {
+            if (i > 0)
+            {
+                text += ' ';
+            }
+            text += "w"s + to_string(word(generator));
+        }
+        return text;
+    }
+
+    string LineError(size_t line_number, const exception &e)
+    {
+        return "Line "s + to_string(line_number) + ": "s + e.what();
+    }
+}
+
+Corpus ReadCorpus(istream &input)
+{
+    Corpus corpus;
+    vector<NewDocument> documents;
+    int next_id = 0;
+    size_t line_number = 0;
+    for (string line; getline(input, line);)
+    {
+        ++line_number;
+        if (line.empty())
+        {
+            continue;
+        }
+        try
+        {
+            const vector<string_view> fields = SplitByTab(line);
+            NewDocument document;
+            if (fields.size() == 1)
+            {
+                document.id = next_id;
+                corpus.texts.push_back(move(line));
+            }
+            else if (fields.size() == 4)
+            {
+                document.id = stoi(string(fields[0]));
+                document.status = ParseStatus(fields[1]);
+                document.ratings = ParseRatings(fields[2]);
+                corpus.texts.emplace_back(fields[3]);
+            }
+            else
+            {
+                throw invalid_argument("Expected 1 or 4 tab-separated fields"s);
+            }
+            next_id = document.id + 1;
+            documents.push_back(move(document));
+        }
+        catch (const exception &e)
+        {
+            throw invalid_argument(LineError(line_number, e));
+        }
+    }
+    // The texts are not moved any more, so the views can be taken
+    for (size_t i = 0; i < documents.size(); ++i)
+    {
+        documents[i].text = corpus.texts[i];
+    }
+    corpus.documents = move(documents);
+    return corpus;
+}
+
+Corpus GenerateCorpus(int document_count, int words_in_document, int vocabulary_size, unsigned seed)
+{
+    static const DocumentStatus statuses[] = {DocumentStatus::ACTUAL, DocumentStatus::ACTUAL, DocumentStatus::ACTUAL,
+                                              DocumentStatus::IRRELEVANT, DocumentStatus::BANNED};
+    Corpus corpus;
+    mt19937 generator(seed);
+    corpus.texts.reserve(document_count);
+    for (int id = 0; id < document_count; ++id)
+    {
+        corpus.texts.push_back(RandomText(generator, words_in_document, vocabulary_size));
+    }
+    corpus.documents.reserve(document_count);
+    for (int id = 0; id < document_count; ++id)
+    {
+        corpus.documents.push_back({id, corpus.texts[id], statuses[id % 5], {id % 10, -(id % 3)}});
+    }
+    return corpus;
+}
+
+LoggedQuery ParseLoggedQuery(string_view line)
+{
+    LoggedQuery query;
+    const size_t tab = line.find('\t');
+    if (tab == string_view::npos)
+    {
+        query.text = string(line);
+        return query;
+    }
+    const string_view filter = line.substr(0, tab);
+    query.text = string(line.substr(tab + 1));
+    if (filter == "even"sv)
+    {
+        query.filter = QueryFilter::EVEN_ID;
+    }
+    else if (filter.substr(0, 8) == "rating>="sv)
+    {
+        query.filter = QueryFilter::MIN_RATING;
+        query.min_rating = stoi(string(filter.substr(8)));
+    }
+    else
+    {
+        query.status = ParseStatus(filter);
+    }
+    return query;
+}
+
+vector<LoggedQuery> ReadQueryLog(istream &input)
+{
+    vector<LoggedQuery> queries;
+    size_t line_number = 0;
+    for (string line; getline(input, line);)
+    {
+        ++line_number;
+        if (line.empty())
+        {
+            continue;
+        }
+        try
+        {
+            queries.push_back(ParseLoggedQuery(line));
+        }
+        catch (const exception &e)
+        {
+            throw invalid_argument(LineError(line_number, e));
+        }
+    }
+    return queries;
+}
+
+vector<LoggedQuery> GenerateQueryLog(int query_count, int words_in_query, int vocabulary_size, unsigned seed)
+{
+    mt19937 generator(seed);
+    uniform_int_distribution<int> word(0, vocabulary_size - 1);
+    vector<LoggedQuery> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i)
+    {
+        LoggedQuery query;
+        query.text = RandomText(generator, words_in_query, vocabulary_size);
+        if (i % 4 == 3)
+        {
+            query.text += " -w"s + to_string(word(generator));
+        }
+        switch (i % 5)
+        {
+        case 0:
+        case 1:
+            break;
+        case 2:
+            query.status = DocumentStatus::BANNED;
+            break;
+        case 3:
+            query.filter = QueryFilter::MIN_RATING;
+            query.min_rating = 5;
+            break;
+        default:
+            query.filter = QueryFilter::EVEN_ID;
+        }
+        queries.push_back(move(query));
+    }
+    return queries;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Documents to load into the server. The texts of `documents` point into `texts`, so a corpus is moved, never copied
+struct Corpus
+{
+    std::vector<std::string> texts;
+    std::vector<NewDocument> documents;
+
+    Corpus() = default;
+    Corpus(Corpus &&) = default;
+    Corpus &operator=(Corpus &&) = default;
+    Corpus(const Corpus &) = delete;
+    Corpus &operator=(const Corpus &) = delete;
+};
+
+enum class QueryFilter
+{
+    STATUS,     // FindTopDocuments(raw_query, status)
+    MIN_RATING, // predicate rating >= min_rating
+    EVEN_ID,    // predicate document_id % 2 == 0
+};
+
+struct LoggedQuery
+{
+    std::string text;
+    QueryFilter filter = QueryFilter::STATUS;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    int min_rating = 0;
+};
+
+// One document per line: "id<TAB>status<TAB>ratings<TAB>text" with space-separated ratings, status as in
+// DocumentStatus (ACTUAL, IRRELEVANT, BANNED, REMOVED). A line without tabs is the text of an ACTUAL document with
+// the next id, no ratings mean rating 0. Empty lines are skipped. Throws std::invalid_argument with the line number
+Corpus ReadCorpus(std::istream &input);
+// Texts of `words_in_document` words from a vocabulary of w0..w{vocabulary_size-1}, statuses and ratings vary by id
+Corpus GenerateCorpus(int document_count, int words_in_document, int vocabulary_size, unsigned seed);
+
+// One query per line: "filter<TAB>query", where filter is a status name, "rating>=N" or "even".
+// A line without a tab is an ACTUAL status query. Empty lines are skipped. Throws std::invalid_argument
+std::vector<LoggedQuery> ReadQueryLog(std::istream &input);
+LoggedQuery ParseLoggedQuery(std::string_view line);
+// Mix of status and predicate queries over the vocabulary of GenerateCorpus, some with a minus-word
+std::vector<LoggedQuery> GenerateQueryLog(int query_count, int words_in_query, int vocabulary_size, unsigned seed);
@@ -0,0 +1,193 @@
+#include "query_client.h"
+#include "query_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    using Clock = chrono::steady_clock;
+
+    const int VOCABULARY_SIZE = 2000;
+    const int WORDS_IN_DOCUMENT = 10;
+    const int WORDS_IN_QUERY = 3;
+
+    string RandomText(mt19937 &generator, int word_count)
+    {
+        uniform_int_distribution<int> word(0, VOCABULARY_SIZE - 1);
+        string text;
+        for (int i = 0; i < word_count; ++i)
+        {
+            text += "w"s + to_string(word(generator)) + " "s;
+        }
+        return text;
+    }
+
+    void LoadDocuments(const string &address, uint16_t port, int document_count)
+    {
+        QueryClient client(address, port);
+        mt19937 generator(1);
+        for (int id = 0; id < document_count; ++id)
+        {
+            Request request;
+            request.operation = Operation::ADD_DOCUMENT;
+            request.document_id = id;
+            request.text = RandomText(generator, WORDS_IN_DOCUMENT);
+            request.ratings = {id % 10};
+            client.Send(move(request));
+        }
+        client.Flush();
+        for (int id = 0; id < document_count; ++id)
+        {
+            const Response response = client.Receive();
+            if (response.code == ResponseCode::ERROR)
+            {
+                throw runtime_error("Loading failed: "s + response.error);
+            }
+        }
+    }
+
+    // Keeps `depth` requests in flight until the deadline, returns latencies in microseconds
+    vector<double> RunConnection(const string &address, uint16_t port, int depth, Clock::time_point deadline,
+                                 unsigned seed, int &errors)
+    {
+        QueryClient client(address, port);
+        mt19937 generator(seed);
+        unordered_map<uint32_t, Clock::time_point> sent_at;
+        vector<double> latencies;
+
+        auto send_query = [&]
+        {
+            Request request;
+            request.operation = Operation::FIND_TOP_DOCUMENTS;
+            request.text = RandomText(generator, WORDS_IN_QUERY);
+            sent_at[client.Send(move(request))] = Clock::now();
+        };
+
+        for (int i = 0; i < depth; ++i)
+        {
+            send_query();
+        }
+        client.Flush();
+        while (!sent_at.empty())
+        {
+            const Response response = client.Receive();
+            const auto now = Clock::now();
+            auto it = sent_at.find(response.request_id);
+            if (it != sent_at.end())
+            {
+                latencies.push_back(chrono::duration<double, micro>(now - it->second).count());
+                sent_at.erase(it);
+            }
+            if (response.code == ResponseCode::ERROR)
+            {
+                ++errors;
+            }
+            if (now < deadline)
+            {
+                send_query();
+                client.Flush();
+            }
+        }
+        return latencies;
+    }
+
+    double Percentile(const vector<double> &sorted, double fraction)
+    {
+        if (sorted.empty())
+        {
+            return 0.0;
+        }
+        const size_t index = min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+        return sorted[index];
+    }
+}
+
+// query_load_test [connections] [depth] [seconds] [documents] [address port]
+// Without address an in-process server is started on an ephemeral 127.0.0.1 port.
+int main(int argc, char *argv[])
+{
+    const int connections = argc > 1 ? stoi(argv[1]) : 8;
+    const int depth = argc > 2 ? stoi(argv[2]) : 16;
+    const int seconds = argc > 3 ? stoi(argv[3]) : 5;
+    const int documents = argc > 4 ? stoi(argv[4]) : 100000;
+
+    try
+    {
+        string address = "127.0.0.1"s;
+        uint16_t port = 0;
+        unique_ptr<ShardedSearchServer> search_server;
+        unique_ptr<QueryServer> server;
+        thread server_thread;
+        if (argc > 6)
+        {
+            address = argv[5];
+            port = static_cast<uint16_t>(stoi(argv[6]));
+        }
+        else
+        {
+            const size_t workers = max(1u, thread::hardware_concurrency());
+            search_server = make_unique<ShardedSearchServer>(workers, ""s);
+            server = make_unique<QueryServer>(*search_server, workers);
+            port = server->Listen(address, 0);
+            server_thread = thread([&server]
+                                   { server->Run(); });
+        }
+
+        LoadDocuments(address, port, documents);
+
+        const auto start = Clock::now();
+        const auto deadline = start + chrono::seconds(seconds);
+        vector<vector<double>> latencies(connections);
+        vector<int> errors(connections);
+        vector<thread> threads;
+        for (int i = 0; i < connections; ++i)
+        {
+            threads.emplace_back([&, i]
+                                 { latencies[i] = RunConnection(address, port, depth, deadline, 100 + i, errors[i]); });
+        }
+        for (thread &t : threads)
+        {
+            t.join();
+        }
+        const double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+        vector<double> all_latencies;
+        for (const auto &connection_latencies : latencies)
+        {
+            all_latencies.insert(all_latencies.end(), connection_latencies.begin(), connection_latencies.end());
+        }
+        sort(all_latencies.begin(), all_latencies.end());
+        int error_count = 0;
+        for (const int connection_errors : errors)
+        {
+            error_count += connection_errors;
+        }
+
+        cout << "Requests: "s << all_latencies.size() << ", errors: "s << error_count << endl;
+        cout << "Throughput: "s << static_cast<int>(all_latencies.size() / elapsed) << " QPS"s << endl;
+        cout << "Latency, us: p50 = "s << Percentile(all_latencies, 0.5)
+             << ", p99 = "s << Percentile(all_latencies, 0.99)
+             << ", p999 = "s << Percentile(all_latencies, 0.999) << endl;
+
+        if (server)
+        {
+            server->Stop();
+            server_thread.join();
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << "Load test failed: "s << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include "protocol.h"
+
+#include <stdexcept>
+
+#include "binary_io.h"
+
+using namespace std;
+
+namespace
+{
+    // Appends the length prefix of a frame, patched by FinishFrame, and returns the position of the frame
+    size_t BeginFrame(string &out)
+    {
+        const size_t frame_begin = out.size();
+        ByteWriter(out).PutU32(0);
+        return frame_begin;
+    }
+
+    void FinishFrame(string &out, size_t frame_begin)
+    {
+        const uint32_t payload_size = static_cast<uint32_t>(out.size() - frame_begin - 4);
+        for (int i = 0; i < 4; ++i)
+        {
+            out[frame_begin + i] = static_cast<char>((payload_size >> (8 * i)) & 0xFF);
+        }
+    }
+
+    Operation ToOperation(uint8_t value)
+    {
+        if (value < static_cast<uint8_t>(Operation::FIND_TOP_DOCUMENTS) || value > static_cast<uint8_t>(Operation::REMOVE_DOCUMENT))
+        {
+            throw invalid_argument("Unknown operation "s + to_string(value));
+        }
+        return static_cast<Operation>(value);
+    }
+
+    DocumentStatus ToStatus(uint8_t value)
+    {
+        if (value > static_cast<uint8_t>(DocumentStatus::REMOVED))
+        {
+            throw invalid_argument("Unknown document status "s + to_string(value));
+        }
+        return static_cast<DocumentStatus>(value);
+    }
+}
+
+void EncodeRequest(const Request &request, string &out)
+{
+    const size_t frame_begin = BeginFrame(out);
+    ByteWriter writer(out);
+    writer.PutU32(request.request_id);
+    writer.PutU8(static_cast<uint8_t>(request.operation));
+    switch (request.operation)
+    {
+    case Operation::FIND_TOP_DOCUMENTS:
+        writer.PutU8(static_cast<uint8_t>(request.status));
+        writer.PutString(request.text);
+        break;
+    case Operation::MATCH_DOCUMENT:
+        writer.PutI32(request.document_id);
+        writer.PutString(request.text);
+        break;
+    case Operation::ADD_DOCUMENT:
+        writer.PutI32(request.document_id);
+        writer.PutU8(static_cast<uint8_t>(request.status));
+        writer.PutString(request.text);
+        writer.PutU32(static_cast<uint32_t>(request.ratings.size()));
+        for (const int rating : request.ratings)
+        {
+            writer.PutI32(rating);
+        }
+        break;
+    case Operation::REMOVE_DOCUMENT:
+        writer.PutI32(request.document_id);
+        break;
+    }
+    FinishFrame(out, frame_begin);
+}
+
+Request DecodeRequest(string_view payload)
+{
+    ByteReader reader(payload);
+    Request request;
+    request.request_id = reader.GetU32();
+    request.operation = ToOperation(reader.GetU8());
+    switch (request.operation)
+    {
+    case Operation::FIND_TOP_DOCUMENTS:
+        request.status = ToStatus(reader.GetU8());
+        request.text = reader.GetString();
+        break;
+    case Operation::MATCH_DOCUMENT:
+        request.document_id = reader.GetI32();
+        request.text = reader.GetString();
+        break;
+    case Operation::ADD_DOCUMENT:
+    {
+        request.document_id = reader.GetI32();
+        request.status = ToStatus(reader.GetU8());
+        request.text = reader.GetString();
+        const uint32_t rating_count = reader.GetCount(4);
+        request.ratings.reserve(rating_count);
+        for (uint32_t i = 0; i < rating_count; ++i)
+        {
+            request.ratings.push_back(reader.GetI32());
+        }
+        break;
+    }
+    case Operation::REMOVE_DOCUMENT:
+        request.document_id = reader.GetI32();
+        break;
+    }
+    reader.ExpectEnd();
+    return request;
+}
+
+void EncodeResponse(const Response &response, string &out)
+{
+    const size_t frame_begin = BeginFrame(out);
+    ByteWriter writer(out);
+    writer.PutU32(response.request_id);
+    writer.PutU8(static_cast<uint8_t>(response.operation));
+    writer.PutU8(static_cast<uint8_t>(response.code));
+    if (response.code == ResponseCode::ERROR)
+    {
+        writer.PutString(response.error);
+    }
+    else if (response.operation == Operation::FIND_TOP_DOCUMENTS)
+    {
+        writer.PutU32(static_cast<uint32_t>(response.documents.size()));
+        for (const Document &document : response.documents)
+        {
+            writer.PutI32(document.id);
+            writer.PutDouble(document.relevance);
+            writer.PutI32(document.rating);
+        }
+    }
+    else if (response.operation == Operation::MATCH_DOCUMENT)
+    {
+        writer.PutU8(static_cast<uint8_t>(response.status));
+        writer.PutU32(static_cast<uint32_t>(response.words.size()));
+        for (const string &word : response.words)
+        {
+            writer.PutString(word);
+        }
+    }
+    FinishFrame(out, frame_begin);
+}
+
+uint32_t DecodeRequestId(string_view payload)
+{
+    return ByteReader(payload).GetU32();
+}
+
+Response DecodeResponse(string_view payload)
+{
+    ByteReader reader(payload);
+    Response response;
+    response.request_id = reader.GetU32();
+    response.operation = ToOperation(reader.GetU8());
+    response.code = static_cast<ResponseCode>(reader.GetU8());
+    if (response.code == ResponseCode::ERROR)
+    {
+        response.error = reader.GetString();
+    }
+    else if (response.operation == Operation::FIND_TOP_DOCUMENTS)
+    {
+        const uint32_t document_count = reader.GetCount(2 * 4 + 8);
+        for (uint32_t i = 0; i < document_count; ++i)
+        {
+            const int id = reader.GetI32();
+            const double relevance = reader.GetDouble();
+            const int rating = reader.GetI32();
+            response.documents.push_back({id, relevance, rating});
+        }
+    }
+    else if (response.operation == Operation::MATCH_DOCUMENT)
+    {
+        response.status = ToStatus(reader.GetU8());
+        const uint32_t word_count = reader.GetCount(4);
+        for (uint32_t i = 0; i < word_count; ++i)
+        {
+            response.words.emplace_back(reader.GetString());
+        }
+    }
+    reader.ExpectEnd();
+    return response;
+}
+
+optional<string_view> ExtractFrame(string_view buffer, size_t &frame_size)
+{
+    if (buffer.size() < 4)
+    {
+        return nullopt;
+    }
+    uint32_t payload_size = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        payload_size |= static_cast<uint32_t>(static_cast<uint8_t>(buffer[i])) << (8 * i);
+    }
+    if (payload_size > MAX_FRAME_SIZE)
+    {
+        throw invalid_argument("Frame is too large"s);
+    }
+    if (buffer.size() - 4 < payload_size)
+    {
+        return nullopt;
+    }
+    frame_size = 4 + payload_size;
+    return buffer.substr(4, payload_size);
+}
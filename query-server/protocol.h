@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+// Every message is a frame: uint32 payload length followed by the payload, integers are little-endian.
+// Request payload:  uint32 request_id, uint8 operation, operation fields.
+// Response payload: uint32 request_id, uint8 operation, uint8 code, operation fields or error text.
+// Responses of one connection may come out of order, request_id matches them with requests.
+
+const uint32_t MAX_FRAME_SIZE = 16 * 1024 * 1024;
+
+enum class Operation : uint8_t
+{
+    FIND_TOP_DOCUMENTS = 1, // status, query        -> documents
+    MATCH_DOCUMENT = 2,     // document_id, query   -> status, words
+    ADD_DOCUMENT = 3,       // document_id, status, text, ratings
+    REMOVE_DOCUMENT = 4,    // document_id
+};
+
+enum class ResponseCode : uint8_t
+{
+    OK = 0,
+    ERROR = 1,
+};
+
+struct Request
+{
+    uint32_t request_id = 0;
+    Operation operation = Operation::FIND_TOP_DOCUMENTS;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::string text; // query or document text
+    std::vector<int> ratings;
+};
+
+struct Response
+{
+    uint32_t request_id = 0;
+    Operation operation = Operation::FIND_TOP_DOCUMENTS;
+    ResponseCode code = ResponseCode::OK;
+    std::string error;
+    std::vector<Document> documents;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<std::string> words;
+};
+
+// Append a whole frame to out
+void EncodeRequest(const Request &request, std::string &out);
+void EncodeResponse(const Response &response, std::string &out);
+
+// Payload without the length prefix; throws std::invalid_argument on malformed data
+Request DecodeRequest(std::string_view payload);
+// The id alone, so a request whose body cannot be decoded can still be answered.
+// Throws std::invalid_argument if the payload is too short to hold it
+uint32_t DecodeRequestId(std::string_view payload);
+Response DecodeResponse(std::string_view payload);
+
+// Payload of the first frame in buffer if it has been received completely; frame_size is set to its full size
+std::optional<std::string_view> ExtractFrame(std::string_view buffer, size_t &frame_size);
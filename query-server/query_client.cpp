@@ -0,0 +1,180 @@
+#include "query_client.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+    [[noreturn]] void ThrowSystemError(const string &what)
+    {
+        throw runtime_error(what + ": "s + strerror(errno));
+    }
+}
+
+QueryClient::QueryClient(const string &address, uint16_t port)
+{
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+    {
+        throw invalid_argument("Invalid address "s + address);
+    }
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0)
+    {
+        ThrowSystemError("socket"s);
+    }
+    if (connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        close(fd_);
+        ThrowSystemError("connect"s);
+    }
+    const int enable = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+}
+
+QueryClient::~QueryClient()
+{
+    close(fd_);
+}
+
+uint32_t QueryClient::Send(Request request)
+{
+    request.request_id = next_request_id_++;
+    EncodeRequest(request, output_);
+    return request.request_id;
+}
+
+void QueryClient::Flush()
+{
+    size_t written = 0;
+    while (written < output_.size())
+    {
+        const ssize_t size = send(fd_, output_.data() + written, output_.size() - written, MSG_NOSIGNAL);
+        if (size < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ThrowSystemError("send"s);
+        }
+        written += size;
+    }
+    output_.clear();
+}
+
+Response QueryClient::Receive()
+{
+    if (!received_.empty())
+    {
+        Response response = move(received_.front());
+        received_.pop_front();
+        return response;
+    }
+    return ReadResponse();
+}
+
+vector<Document> QueryClient::FindTopDocuments(string_view raw_query, DocumentStatus status)
+{
+    Request request;
+    request.operation = Operation::FIND_TOP_DOCUMENTS;
+    request.status = status;
+    request.text = raw_query;
+    return Call(move(request)).documents;
+}
+
+tuple<vector<string>, DocumentStatus> QueryClient::MatchDocument(string_view raw_query, int document_id)
+{
+    Request request;
+    request.operation = Operation::MATCH_DOCUMENT;
+    request.document_id = document_id;
+    request.text = raw_query;
+    Response response = Call(move(request));
+    return {move(response.words), response.status};
+}
+
+void QueryClient::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int> &ratings)
+{
+    Request request;
+    request.operation = Operation::ADD_DOCUMENT;
+    request.document_id = document_id;
+    request.status = status;
+    request.text = document;
+    request.ratings = ratings;
+    Call(move(request));
+}
+
+void QueryClient::RemoveDocument(int document_id)
+{
+    Request request;
+    request.operation = Operation::REMOVE_DOCUMENT;
+    request.document_id = document_id;
+    Call(move(request));
+}
+
+Response QueryClient::Call(Request request)
+{
+    const uint32_t request_id = Send(move(request));
+    Flush();
+    while (true)
+    {
+        Response response = ReadResponse();
+        if (response.request_id != request_id)
+        {
+            received_.push_back(move(response));
+            continue;
+        }
+        if (response.code == ResponseCode::ERROR)
+        {
+            throw runtime_error(response.error);
+        }
+        return response;
+    }
+}
+
+Response QueryClient::ReadResponse()
+{
+    char buffer[64 * 1024];
+    while (true)
+    {
+        size_t frame_size = 0;
+        if (auto payload = ExtractFrame(string_view(input_).substr(input_offset_), frame_size))
+        {
+            Response response = DecodeResponse(*payload);
+            input_offset_ += frame_size;
+            if (input_offset_ == input_.size())
+            {
+                input_.clear();
+                input_offset_ = 0;
+            }
+            return response;
+        }
+        input_.erase(0, input_offset_);
+        input_offset_ = 0;
+
+        const ssize_t size = recv(fd_, buffer, sizeof(buffer), 0);
+        if (size == 0)
+        {
+            throw runtime_error("Connection closed by server"s);
+        }
+        if (size < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ThrowSystemError("recv"s);
+        }
+        input_.append(buffer, size);
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "protocol.h"
+
+// Blocking client of QueryServer. Send/Flush/Receive allow to keep many requests in flight,
+// the other methods wait for their own response and throw std::runtime_error on server errors.
+class QueryClient
+{
+public:
+    QueryClient(const std::string &address, uint16_t port);
+    ~QueryClient();
+
+    QueryClient(const QueryClient &) = delete;
+    QueryClient &operator=(const QueryClient &) = delete;
+
+    // Buffers the request and returns its id, nothing is sent before Flush
+    uint32_t Send(Request request);
+    void Flush();
+    // Next response in arrival order
+    Response Receive();
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id);
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings);
+    void RemoveDocument(int document_id);
+
+private:
+    int fd_ = -1;
+    uint32_t next_request_id_ = 1;
+    std::string output_;
+    std::string input_;
+    size_t input_offset_ = 0;
+    std::deque<Response> received_; // responses skipped while waiting for another one
+
+    Response Call(Request request);
+    Response ReadResponse();
+};
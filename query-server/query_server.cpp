@@ -0,0 +1,523 @@
+#include "query_server.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+    [[noreturn]] void ThrowSystemError(const string &what)
+    {
+        throw runtime_error(what + ": "s + strerror(errno));
+    }
+
+    const size_t READ_CHUNK_SIZE = 64 * 1024;
+    const int MAX_EVENTS = 256;
+
+    // Per connection, past these the connection is not read until responses are sent
+    const size_t MAX_IN_FLIGHT = 128;
+    const size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+}
+
+bool QueryServer::Connection::IsOverLimits() const
+{
+    return in_flight >= MAX_IN_FLIGHT || output.size() >= MAX_PENDING_OUTPUT;
+}
+
+QueryServer::QueryServer(ShardedSearchServer &search_server, size_t worker_count)
+    : search_server_(search_server)
+{
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0)
+    {
+        ThrowSystemError("epoll_create1"s);
+    }
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0)
+    {
+        close(epoll_fd_);
+        ThrowSystemError("eventfd"s);
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+
+    if (worker_count == 0)
+    {
+        worker_count = 1;
+    }
+    for (size_t i = 0; i < worker_count; ++i)
+    {
+        workers_.emplace_back([this]
+                              { WorkerLoop(); });
+    }
+}
+
+QueryServer::~QueryServer()
+{
+    Stop();
+    {
+        lock_guard guard(tasks_mutex_);
+        workers_stopping_ = true;
+    }
+    tasks_cv_.notify_all();
+    for (thread &worker : workers_)
+    {
+        worker.join();
+    }
+    for (auto &[fd, connection] : connections_)
+    {
+        close(fd);
+    }
+    if (listen_fd_ >= 0)
+    {
+        close(listen_fd_);
+    }
+    close(wake_fd_);
+    close(epoll_fd_);
+}
+
+uint16_t QueryServer::Listen(const string &address, uint16_t port)
+{
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+    {
+        throw invalid_argument("Invalid address "s + address);
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0)
+    {
+        ThrowSystemError("socket"s);
+    }
+    const int enable = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        ThrowSystemError("bind"s);
+    }
+    if (listen(listen_fd_, SOMAXCONN) < 0)
+    {
+        ThrowSystemError("listen"s);
+    }
+    socklen_t addr_size = sizeof(addr);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&addr), &addr_size);
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+    return ntohs(addr.sin_port);
+}
+
+void QueryServer::Run()
+{
+    epoll_event events[MAX_EVENTS];
+    while (!stopping_)
+    {
+        const int event_count = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+        if (event_count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ThrowSystemError("epoll_wait"s);
+        }
+        for (int i = 0; i < event_count; ++i)
+        {
+            const int fd = events[i].data.fd;
+            if (fd == listen_fd_)
+            {
+                AcceptConnections();
+                continue;
+            }
+            if (fd == wake_fd_)
+            {
+                uint64_t counter;
+                [[maybe_unused]] auto _ = read(wake_fd_, &counter, sizeof(counter));
+                FlushReadyConnections();
+                continue;
+            }
+            auto it = connections_.find(fd);
+            if (it == connections_.end())
+            {
+                continue;
+            }
+            const auto connection = it->second;
+            if (events[i].events & EPOLLERR)
+            {
+                CloseConnection(connection);
+                continue;
+            }
+            // Data that arrived with the hang-up is read first
+            if (events[i].events & EPOLLIN)
+            {
+                ReadConnection(connection);
+            }
+            if (connection->fd >= 0 && (events[i].events & EPOLLHUP))
+            {
+                HangUpConnection(connection);
+                continue;
+            }
+            if (connection->fd >= 0 && (events[i].events & EPOLLOUT))
+            {
+                WriteConnection(connection);
+            }
+        }
+    }
+}
+
+void QueryServer::Stop()
+{
+    stopping_ = true;
+    const uint64_t one = 1;
+    [[maybe_unused]] auto _ = write(wake_fd_, &one, sizeof(one));
+}
+
+void QueryServer::AcceptConnections()
+{
+    while (true)
+    {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            // EAGAIN: nothing left; other errors belong to the half-open connection only
+            return;
+        }
+        const int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        auto connection = make_shared<Connection>();
+        connection->fd = fd;
+        connections_[fd] = connection;
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+void QueryServer::ReadConnection(const shared_ptr<Connection> &connection)
+{
+    char buffer[READ_CHUNK_SIZE];
+    while (!connection->peer_closed && !connection->IsOverLimits())
+    {
+        const ssize_t size = read(connection->fd, buffer, sizeof(buffer));
+        if (size > 0)
+        {
+            connection->input.append(buffer, size);
+            if (!DispatchFrames(connection))
+            {
+                return;
+            }
+            continue;
+        }
+        if (size == 0)
+        {
+            // The client has shut down its sending side and may still wait for the responses
+            connection->peer_closed = true;
+            break;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            break;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        CloseConnection(connection);
+        return;
+    }
+    UpdateEvents(connection);
+}
+
+void QueryServer::HangUpConnection(const shared_ptr<Connection> &connection)
+{
+    // Nothing can be sent any more, but the requests the client did send are still executed
+    char buffer[READ_CHUNK_SIZE];
+    while (true)
+    {
+        const ssize_t size = read(connection->fd, buffer, sizeof(buffer));
+        if (size > 0)
+        {
+            connection->input.append(buffer, size);
+            continue;
+        }
+        if (size < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        break;
+    }
+    if (DispatchFrames(connection, false))
+    {
+        CloseConnection(connection);
+    }
+}
+
+bool QueryServer::DispatchFrames(const shared_ptr<Connection> &connection, bool limited)
+{
+    vector<Task> tasks;
+    size_t offset = 0;
+    try
+    {
+        size_t frame_size = 0;
+        while (!(limited && connection->IsOverLimits()))
+        {
+            const auto payload = ExtractFrame(string_view(connection->input).substr(offset), frame_size);
+            if (!payload)
+            {
+                break;
+            }
+            // A frame without a request id cannot be answered, so it breaks the connection like a framing error
+            tasks.push_back({connection, DecodeRequestId(*payload), string(*payload)});
+            offset += frame_size;
+            ++connection->in_flight;
+        }
+    }
+    catch (const invalid_argument &)
+    {
+        CloseConnection(connection);
+        return false;
+    }
+    connection->input.erase(0, offset);
+
+    if (tasks.empty())
+    {
+        return true;
+    }
+    {
+        lock_guard guard(tasks_mutex_);
+        for (Task &task : tasks)
+        {
+            tasks_.push_back(move(task));
+        }
+    }
+    if (tasks.size() == 1)
+    {
+        tasks_cv_.notify_one();
+    }
+    else
+    {
+        tasks_cv_.notify_all();
+    }
+    return true;
+}
+
+void QueryServer::WriteConnection(const shared_ptr<Connection> &connection)
+{
+    size_t written = 0;
+    while (written < connection->output.size())
+    {
+        const ssize_t size = send(connection->fd, connection->output.data() + written,
+                                  connection->output.size() - written, MSG_NOSIGNAL);
+        if (size > 0)
+        {
+            written += size;
+            continue;
+        }
+        if (size < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        CloseConnection(connection);
+        return;
+    }
+    connection->output.erase(0, written);
+    // Frames held back by the limits may fit now
+    if (DispatchFrames(connection))
+    {
+        UpdateEvents(connection);
+    }
+}
+
+void QueryServer::CloseConnection(const shared_ptr<Connection> &connection)
+{
+    if (connection->fd < 0)
+    {
+        return;
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection->fd, nullptr);
+    close(connection->fd);
+    connections_.erase(connection->fd);
+    connection->fd = -1;
+
+    lock_guard guard(connection->mutex);
+    connection->closed = true;
+    connection->completed.clear();
+    connection->completed_count = 0;
+}
+
+void QueryServer::FlushReadyConnections()
+{
+    vector<shared_ptr<Connection>> ready;
+    {
+        lock_guard guard(ready_mutex_);
+        ready.swap(ready_connections_);
+    }
+    for (const auto &connection : ready)
+    {
+        if (connection->fd < 0)
+        {
+            continue;
+        }
+        {
+            lock_guard guard(connection->mutex);
+            connection->output.append(connection->completed);
+            connection->completed.clear();
+            connection->in_flight -= connection->completed_count;
+            connection->completed_count = 0;
+        }
+        WriteConnection(connection);
+    }
+}
+
+void QueryServer::UpdateEvents(const shared_ptr<Connection> &connection)
+{
+    if (connection->peer_closed && connection->in_flight == 0 && connection->output.empty())
+    {
+        CloseConnection(connection);
+        return;
+    }
+    // A connection over its limits or without a peer to read from is not polled for input:
+    // epoll is level-triggered, so it would report the pending data or the end of input over and over
+    const bool want_read = !connection->peer_closed && !connection->IsOverLimits();
+    const bool want_write = !connection->output.empty();
+    if (connection->want_read == want_read && connection->want_write == want_write)
+    {
+        return;
+    }
+    connection->want_read = want_read;
+    connection->want_write = want_write;
+    epoll_event event{};
+    event.events = 0;
+    if (want_read)
+    {
+        event.events |= EPOLLIN;
+    }
+    if (want_write)
+    {
+        event.events |= EPOLLOUT;
+    }
+    event.data.fd = connection->fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection->fd, &event);
+}
+
+void QueryServer::WorkerLoop()
+{
+    string encoded_response;
+    while (true)
+    {
+        Task task;
+        {
+            unique_lock lock(tasks_mutex_);
+            tasks_cv_.wait(lock, [this]
+                           { return workers_stopping_ || !tasks_.empty(); });
+            if (tasks_.empty())
+            {
+                return;
+            }
+            task = move(tasks_.front());
+            tasks_.pop_front();
+        }
+
+        Response response;
+        try
+        {
+            response = Execute(DecodeRequest(task.payload));
+        }
+        catch (const exception &e)
+        {
+            response.request_id = task.request_id;
+            response.code = ResponseCode::ERROR;
+            response.error = e.what();
+        }
+        encoded_response.clear();
+        EncodeResponse(response, encoded_response);
+        Complete(task.connection, encoded_response);
+    }
+}
+
+Response QueryServer::Execute(const Request &request)
+{
+    Response response;
+    response.request_id = request.request_id;
+    response.operation = request.operation;
+    try
+    {
+        switch (request.operation)
+        {
+        case Operation::FIND_TOP_DOCUMENTS:
+            response.documents = search_server_.FindTopDocuments(request.text, request.status);
+            break;
+        case Operation::MATCH_DOCUMENT:
+        {
+            const auto [words, status] = search_server_.MatchDocument(request.text, request.document_id);
+            response.words.assign(words.begin(), words.end());
+            response.status = status;
+            break;
+        }
+        case Operation::ADD_DOCUMENT:
+            search_server_.AddDocument(request.document_id, request.text, request.status, request.ratings);
+            break;
+        case Operation::REMOVE_DOCUMENT:
+            search_server_.RemoveDocument(request.document_id);
+            break;
+        }
+    }
+    catch (const exception &e)
+    {
+        response.code = ResponseCode::ERROR;
+        response.error = e.what();
+    }
+    return response;
+}
+
+void QueryServer::Complete(const shared_ptr<Connection> &connection, const string &encoded_response)
+{
+    {
+        lock_guard guard(connection->mutex);
+        if (connection->closed)
+        {
+            return;
+        }
+        const bool already_ready = !connection->completed.empty();
+        connection->completed.append(encoded_response);
+        ++connection->completed_count;
+        if (already_ready)
+        {
+            return;
+        }
+    }
+    bool wake = false;
+    {
+        lock_guard guard(ready_mutex_);
+        wake = ready_connections_.empty();
+        ready_connections_.push_back(connection);
+    }
+    if (wake)
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] auto _ = write(wake_fd_, &one, sizeof(one));
+    }
+}
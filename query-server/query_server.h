@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "protocol.h"
+#include "sharded_search_server.h"
+
+// Serves the binary protocol from protocol.h over TCP.
+// One epoll thread does all socket I/O and splits input into frames, requests are executed
+// by a pool of workers. A connection that has too many requests in flight or too many response bytes
+// waiting to be sent is not read until it catches up. After the client shuts down its sending side,
+// the requests already sent are still answered before the connection is closed.
+class QueryServer
+{
+public:
+    QueryServer(ShardedSearchServer &search_server, size_t worker_count);
+    ~QueryServer();
+
+    QueryServer(const QueryServer &) = delete;
+    QueryServer &operator=(const QueryServer &) = delete;
+
+    // Returns the bound port, useful with port 0
+    uint16_t Listen(const std::string &address, uint16_t port);
+
+    // Blocks until Stop is called
+    void Run();
+    // May be called from any thread
+    void Stop();
+
+private:
+    struct Connection
+    {
+        int fd = -1;
+        std::string input;
+        std::string output;
+        size_t in_flight = 0;     // requests dispatched whose responses are not in output yet
+        bool peer_closed = false; // read returned 0, nothing more will come
+        bool want_read = true;
+        bool want_write = false;
+
+        std::mutex mutex;
+        std::string completed;      // responses encoded by workers, guarded by mutex
+        size_t completed_count = 0; // number of responses in completed, guarded by mutex
+        bool closed = false;
+
+        bool IsOverLimits() const;
+    };
+
+    struct Task
+    {
+        std::shared_ptr<Connection> connection;
+        uint32_t request_id; // read before the payload is decoded, for the error response
+        std::string payload;
+    };
+
+    ShardedSearchServer &search_server_;
+
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    std::atomic<bool> stopping_{false};
+
+    std::unordered_map<int, std::shared_ptr<Connection>> connections_;
+
+    std::mutex tasks_mutex_;
+    std::condition_variable tasks_cv_;
+    std::deque<Task> tasks_;
+    bool workers_stopping_ = false;
+    std::vector<std::thread> workers_;
+
+    std::mutex ready_mutex_;
+    std::vector<std::shared_ptr<Connection>> ready_connections_;
+
+    void AcceptConnections();
+    void ReadConnection(const std::shared_ptr<Connection> &connection);
+    void HangUpConnection(const std::shared_ptr<Connection> &connection);
+    // Queues the complete frames of the input, only while the connection is within its limits unless
+    // `limited` is false. Returns false if a malformed frame closed the connection
+    bool DispatchFrames(const std::shared_ptr<Connection> &connection, bool limited = true);
+    void WriteConnection(const std::shared_ptr<Connection> &connection);
+    void CloseConnection(const std::shared_ptr<Connection> &connection);
+    void FlushReadyConnections();
+    // Also closes a connection whose peer has closed once all its requests are answered and sent
+    void UpdateEvents(const std::shared_ptr<Connection> &connection);
+
+    void WorkerLoop();
+    Response Execute(const Request &request);
+    void Complete(const std::shared_ptr<Connection> &connection, const std::string &encoded_response);
+};
@@ -0,0 +1,242 @@
+#include "query_client.h"
+#include "query_server.h"
+#include "test_example_functions.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // QueryServer on a free port of 127.0.0.1, run by its own thread
+    struct TestServer
+    {
+        ShardedSearchServer search_server;
+        QueryServer query_server;
+        uint16_t port = 0;
+        thread runner;
+
+        TestServer()
+            : search_server(2, "and"s), query_server(search_server, 2)
+        {
+            search_server.AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, {1, 2});
+            search_server.AddDocument(2, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+            search_server.AddDocument(3, "nasty dog with big eyes"s, DocumentStatus::BANNED, {5});
+            port = query_server.Listen("127.0.0.1"s, 0);
+            runner = thread([this]
+                            {
+                                query_server.Run();
+                            });
+        }
+
+        ~TestServer()
+        {
+            query_server.Stop();
+            runner.join();
+        }
+    };
+
+    // Raw socket, so a test can send what QueryClient never would. Reads time out instead of hanging a failed test
+    int Connect(uint16_t port)
+    {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            throw runtime_error("Cannot connect"s);
+        }
+        timeval timeout{10, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return fd;
+    }
+
+    void WriteAll(int fd, const string &data)
+    {
+        size_t written = 0;
+        while (written < data.size())
+        {
+            const ssize_t size = write(fd, data.data() + written, data.size() - written);
+            ASSERT(size > 0);
+            written += size;
+        }
+    }
+
+    // Everything the server sends until it closes the connection; fails on a timeout
+    string ReadUntilClosed(int fd)
+    {
+        string input;
+        char buffer[64 * 1024];
+        while (true)
+        {
+            const ssize_t size = read(fd, buffer, sizeof(buffer));
+            ASSERT_HINT(size >= 0, "the server did not close the connection"s);
+            if (size == 0)
+            {
+                return input;
+            }
+            input.append(buffer, size);
+        }
+    }
+
+    vector<Response> DecodeResponses(string_view input)
+    {
+        vector<Response> responses;
+        size_t frame_size = 0;
+        while (const auto payload = ExtractFrame(input, frame_size))
+        {
+            responses.push_back(DecodeResponse(*payload));
+            input.remove_prefix(frame_size);
+        }
+        ASSERT(input.empty());
+        return responses;
+    }
+}
+
+void TestProtocolRoundTrip()
+{
+    Request request;
+    request.request_id = 7;
+    request.operation = Operation::ADD_DOCUMENT;
+    request.document_id = -3;
+    request.status = DocumentStatus::BANNED;
+    request.text = "cat dog"s;
+    request.ratings = {1, -2, 3};
+    string frame;
+    EncodeRequest(request, frame);
+
+    size_t frame_size = 0;
+    ASSERT(!ExtractFrame(string_view(frame).substr(0, frame.size() - 1), frame_size));
+    const auto payload = ExtractFrame(frame, frame_size);
+    ASSERT(payload);
+    ASSERT_EQUAL(frame_size, frame.size());
+    const Request decoded = DecodeRequest(*payload);
+    ASSERT_EQUAL(decoded.request_id, 7u);
+    ASSERT(decoded.operation == Operation::ADD_DOCUMENT);
+    ASSERT_EQUAL(decoded.document_id, -3);
+    ASSERT(decoded.status == DocumentStatus::BANNED);
+    ASSERT_EQUAL(decoded.text, "cat dog"s);
+    ASSERT(decoded.ratings == request.ratings);
+    ASSERT_THROWS(DecodeRequest(payload->substr(0, payload->size() - 1)), invalid_argument);
+
+    Response response;
+    response.request_id = 9;
+    response.documents = {{2, 0.5, 3}, {1, 0.25, -1}};
+    frame.clear();
+    EncodeResponse(response, frame);
+    const Response decoded_response = DecodeResponse(*ExtractFrame(frame, frame_size));
+    ASSERT_EQUAL(decoded_response.request_id, 9u);
+    ASSERT_EQUAL(decoded_response.documents.size(), 2u);
+    ASSERT_EQUAL(decoded_response.documents[1].id, 1);
+    ASSERT_EQUAL(decoded_response.documents[1].rating, -1);
+}
+
+void TestPipelinedRequestsAreMatchedById()
+{
+    TestServer server;
+    QueryClient client("127.0.0.1"s, server.port);
+    const vector<string> queries = {"cat"s, "curly -tail"s, "nasty dog"s, "hat tail"s};
+    map<uint32_t, string> sent;
+    for (int i = 0; i < 200; ++i)
+    {
+        Request request;
+        request.text = queries[i % queries.size()];
+        sent[client.Send(request)] = request.text;
+    }
+    client.Flush();
+    for (size_t i = 0; i < sent.size(); ++i)
+    {
+        const Response response = client.Receive();
+        ASSERT(response.code == ResponseCode::OK);
+        const auto expected = server.search_server.FindTopDocuments(sent.at(response.request_id));
+        ASSERT_EQUAL(response.documents.size(), expected.size());
+        for (size_t j = 0; j < expected.size(); ++j)
+        {
+            ASSERT_EQUAL(response.documents[j].id, expected[j].id);
+        }
+    }
+
+    const auto [words, status] = client.MatchDocument("dog eyes -cat"s, 3);
+    ASSERT(words.size() == 2 && status == DocumentStatus::BANNED);
+    client.AddDocument(4, "cat"s, DocumentStatus::ACTUAL, {});
+    ASSERT_EQUAL(client.FindTopDocuments("cat"s).size(), 3u);
+    client.RemoveDocument(4);
+    ASSERT_THROWS(client.MatchDocument("cat"s, 4), runtime_error);
+}
+
+void TestRequestsBeforeShutdownAreAnswered()
+{
+    TestServer server;
+    const int fd = Connect(server.port);
+    // More than the in-flight limit of a connection, so reading is paused and resumed
+    const int request_count = 1000;
+    string output;
+    for (int i = 0; i < request_count; ++i)
+    {
+        Request request;
+        request.request_id = i;
+        request.text = "curly"s;
+        EncodeRequest(request, output);
+    }
+    WriteAll(fd, output);
+    shutdown(fd, SHUT_WR);
+
+    const vector<Response> responses = DecodeResponses(ReadUntilClosed(fd));
+    close(fd);
+    ASSERT_EQUAL(responses.size(), static_cast<size_t>(request_count));
+    vector<bool> answered(request_count);
+    for (const Response &response : responses)
+    {
+        ASSERT(response.documents.size() == 1 && response.documents[0].id == 2);
+        answered.at(response.request_id) = true;
+    }
+    ASSERT(find(answered.begin(), answered.end(), false) == answered.end());
+}
+
+void TestMalformedInput()
+{
+    TestServer server;
+    // An undecodable body is answered with an error carrying the id of the request
+    int fd = Connect(server.port);
+    WriteAll(fd, string("\x06\x00\x00\x00\x2a\x01\x00\x00\x09\x00", 10));
+    shutdown(fd, SHUT_WR);
+    const vector<Response> responses = DecodeResponses(ReadUntilClosed(fd));
+    close(fd);
+    ASSERT_EQUAL(responses.size(), 1u);
+    ASSERT(responses[0].code == ResponseCode::ERROR);
+    ASSERT_EQUAL(responses[0].request_id, 0x12au);
+
+    // A frame too short to hold a request id closes the connection without an answer
+    fd = Connect(server.port);
+    WriteAll(fd, string("\x02\x00\x00\x00\x01\x02", 6));
+    ASSERT(ReadUntilClosed(fd).empty());
+    close(fd);
+
+    // A frame longer than MAX_FRAME_SIZE closes the connection at once
+    fd = Connect(server.port);
+    WriteAll(fd, string("\xff\xff\xff\xff", 4));
+    ASSERT(ReadUntilClosed(fd).empty());
+    close(fd);
+}
+
+int main()
+{
+    RUN_TEST(TestProtocolRoundTrip);
+    RUN_TEST(TestPipelinedRequestsAreMatchedById);
+    RUN_TEST(TestRequestsBeforeShutdownAreAnswered);
+    RUN_TEST(TestMalformedInput);
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include "query_server.h"
+
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    QueryServer *running_server = nullptr;
+
+    void HandleSignal(int)
+    {
+        // Stop only stores a flag and writes to an eventfd, both are async-signal-safe
+        running_server->Stop();
+    }
+}
+
+// query_server [address] [port] [workers] [shards] ["stop words"]
+int main(int argc, char *argv[])
+{
+    const string address = argc > 1 ? argv[1] : "127.0.0.1"s;
+    const uint16_t port = argc > 2 ? static_cast<uint16_t>(stoi(argv[2])) : 7070;
+    const size_t workers = argc > 3 ? stoul(argv[3]) : max(1u, thread::hardware_concurrency());
+    const size_t shards = argc > 4 ? stoul(argv[4]) : workers;
+    const string stop_words = argc > 5 ? argv[5] : ""s;
+
+    try
+    {
+        ShardedSearchServer search_server(shards, stop_words);
+        QueryServer server(search_server, workers);
+        const uint16_t bound_port = server.Listen(address, port);
+        cerr << "Listening on "s << address << ":"s << bound_port << " with "s << workers << " workers, "s
+             << shards << " shards"s << endl;
+
+        running_server = &server;
+        signal(SIGINT, HandleSignal);
+        signal(SIGTERM, HandleSignal);
+        server.Run();
+        running_server = nullptr;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Query server failed: "s << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
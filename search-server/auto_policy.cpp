@@ -0,0 +1,100 @@
+#include "auto_policy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <execution>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "search_server.h"
+
+using namespace std;
+
+namespace
+{
+    const size_t NOT_CALIBRATED = 0;
+    // Word k of the calibration index is in every 2^k-th document
+    const int CALIBRATION_WORD_COUNT = 14;
+    const int CALIBRATION_QUERY_WORDS = 4;
+    const int CALIBRATION_REPEATS = 5;
+
+    atomic<size_t> parallel_threshold{NOT_CALIBRATED};
+    once_flag calibration_flag;
+
+    template <class ExecutionPolicy>
+    double MeasureBestSeconds(ExecutionPolicy policy, const SearchServer &search_server, const string &query)
+    {
+        double best = numeric_limits<double>::max();
+        for (int i = 0; i < CALIBRATION_REPEATS; ++i)
+        {
+            const auto start = chrono::steady_clock::now();
+            search_server.FindTopDocuments(policy, query);
+            best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    }
+}
+
+size_t GetParallelThreshold()
+{
+    call_once(calibration_flag,
+              []
+              {
+                  if (parallel_threshold.load() == NOT_CALIBRATED)
+                  {
+                      CalibrateParallelThreshold();
+                  }
+              });
+    return parallel_threshold.load(memory_order_relaxed);
+}
+
+void SetParallelThreshold(size_t work)
+{
+    parallel_threshold.store(max(work, size_t(1)));
+}
+
+size_t CalibrateParallelThreshold()
+{
+    const int document_count = 1 << CALIBRATION_WORD_COUNT;
+    vector<string> texts(document_count);
+    vector<NewDocument> documents(document_count);
+    for (int id = 0; id < document_count; ++id)
+    {
+        for (int word = 0; word < CALIBRATION_WORD_COUNT && id % (1 << word) == 0; ++word)
+        {
+            texts[id] += "w"s + to_string(word) + " "s;
+        }
+        documents[id] = {id, texts[id], DocumentStatus::ACTUAL, {1}};
+    }
+    SearchServer search_server(""s);
+    search_server.AddDocuments(execution::seq, documents);
+
+    // From the heaviest query down: the threshold is the lightest work for which every heavier query
+    // was faster in parallel
+    size_t threshold = numeric_limits<size_t>::max();
+    for (int first = 0; first + CALIBRATION_QUERY_WORDS <= CALIBRATION_WORD_COUNT; ++first)
+    {
+        string query;
+        size_t work = 0;
+        for (int word = first; word < first + CALIBRATION_QUERY_WORDS; ++word)
+        {
+            query += "w"s + to_string(word) + " "s;
+            work += document_count >> word;
+        }
+        if (MeasureBestSeconds(execution::par, search_server, query) >= MeasureBestSeconds(execution::seq, search_server, query))
+        {
+            break;
+        }
+        threshold = work;
+    }
+    parallel_threshold.store(threshold);
+    return threshold;
+}
+
+bool IsParallelWorthwhile(size_t work, size_t tasks)
+{
+    return tasks > 1 && work >= GetParallelThreshold();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+// Execution policy for SearchServer calls that picks std::execution::seq or par on every call. The work of the call,
+// e.g. the postings of the query terms it has just looked up, is compared with a threshold measured on this machine
+struct AutoExecutionPolicy
+{
+};
+
+inline constexpr AutoExecutionPolicy auto_policy{};
+
+// Work from which the parallel versions are faster, in postings (or forward index entries) visited. SIZE_MAX when
+// they never are. If neither CalibrateParallelThreshold nor SetParallelThreshold ran before, the first call runs the
+// calibration, and so does the first auto call: it takes a fraction of a second and concurrent first calls wait for it
+size_t GetParallelThreshold();
+void SetParallelThreshold(size_t work);
+
+// Times the sequential and the parallel search on a synthetic index of a few thousand documents, a fraction of a second.
+// Services should call it at startup, before taking queries, to keep the calibration out of their latency
+size_t CalibrateParallelThreshold();
+
+// `work` split into `tasks` independent parts, only the parts can run in parallel
+bool IsParallelWorthwhile(size_t work, size_t tasks);
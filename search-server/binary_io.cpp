@@ -0,0 +1,160 @@
+#include "binary_io.h"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+ByteWriter::ByteWriter(string &out)
+    : out_(out)
+{
+}
+
+void ByteWriter::PutU8(uint8_t value)
+{
+    out_.push_back(static_cast<char>(value));
+}
+
+void ByteWriter::PutU32(uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        out_.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void ByteWriter::PutU64(uint64_t value)
+{
+    PutU32(static_cast<uint32_t>(value));
+    PutU32(static_cast<uint32_t>(value >> 32));
+}
+
+void ByteWriter::PutI32(int value)
+{
+    PutU32(static_cast<uint32_t>(value));
+}
+
+void ByteWriter::PutDouble(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    PutU64(bits);
+}
+
+void ByteWriter::PutString(string_view value)
+{
+    PutU32(static_cast<uint32_t>(value.size()));
+    out_.append(value);
+}
+
+ByteReader::ByteReader(string_view data)
+    : data_(data)
+{
+}
+
+uint8_t ByteReader::GetU8()
+{
+    Require(1);
+    return static_cast<uint8_t>(data_[pos_++]);
+}
+
+uint32_t ByteReader::GetU32()
+{
+    Require(4);
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(data_[pos_++])) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t ByteReader::GetU64()
+{
+    uint64_t value = GetU32();
+    value |= static_cast<uint64_t>(GetU32()) << 32;
+    return value;
+}
+
+int ByteReader::GetI32()
+{
+    return static_cast<int>(GetU32());
+}
+
+double ByteReader::GetDouble()
+{
+    const uint64_t bits = GetU64();
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+string_view ByteReader::GetString()
+{
+    const uint32_t size = GetU32();
+    Require(size);
+    const string_view value = data_.substr(pos_, size);
+    pos_ += size;
+    return value;
+}
+
+uint32_t ByteReader::GetCount(size_t min_element_size)
+{
+    const uint32_t count = GetU32();
+    if (min_element_size != 0 && (data_.size() - pos_) / min_element_size < count)
+    {
+        throw invalid_argument("Element count exceeds the data"s);
+    }
+    return count;
+}
+
+bool ByteReader::IsEnd() const
+{
+    return pos_ == data_.size();
+}
+
+void ByteReader::ExpectEnd() const
+{
+    if (!IsEnd())
+    {
+        throw invalid_argument("Unexpected trailing bytes"s);
+    }
+}
+
+void ByteReader::Require(size_t size) const
+{
+    if (data_.size() - pos_ < size)
+    {
+        throw invalid_argument("Data is truncated"s);
+    }
+}
+
+namespace
+{
+    array<uint32_t, 256> MakeCrc32Table()
+    {
+        array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+}
+
+uint32_t ComputeCrc32(string_view data, uint32_t crc)
+{
+    static const array<uint32_t, 256> table = MakeCrc32Table();
+    crc = ~crc;
+    for (const char c : data)
+    {
+        crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
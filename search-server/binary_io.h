@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Little-endian encoding of snapshots, log records and the messages of the query server protocol
+
+class ByteWriter
+{
+public:
+    // Appends to out
+    explicit ByteWriter(std::string &out);
+
+    void PutU8(uint8_t value);
+    void PutU32(uint32_t value);
+    void PutU64(uint64_t value);
+    void PutI32(int value);
+    void PutDouble(double value);
+    void PutString(std::string_view value);
+
+private:
+    std::string &out_;
+};
+
+// Throws std::invalid_argument when the data ends too early
+class ByteReader
+{
+public:
+    explicit ByteReader(std::string_view data);
+
+    uint8_t GetU8();
+    uint32_t GetU32();
+    uint64_t GetU64();
+    int GetI32();
+    double GetDouble();
+    // Points into the data
+    std::string_view GetString();
+    // Number of elements that follow, each taking at least min_element_size bytes. Checked against the rest
+    // of the data, so a corrupt count cannot make the caller allocate more than the data could hold
+    uint32_t GetCount(size_t min_element_size);
+
+    bool IsEnd() const;
+    void ExpectEnd() const;
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+
+    void Require(size_t size) const;
+};
+
+// CRC-32 (IEEE 802.3), continues from crc when a checksum is computed piece by piece
+uint32_t ComputeCrc32(std::string_view data, uint32_t crc = 0);
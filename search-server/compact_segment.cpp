@@ -0,0 +1,322 @@
+#include "compact_segment.h"
+
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+CompactSegment CompactSegment::Build(const SearchServer &search_server)
+{
+    CompactSegment segment;
+    const auto &terms = search_server.terms_;
+
+    vector<TermId> term_ids;
+    for (TermId term_id = 0; term_id < terms.size(); ++term_id)
+    {
+        if (!terms[term_id].word.empty())
+        {
+            term_ids.push_back(term_id);
+        }
+    }
+    sort(term_ids.begin(), term_ids.end(),
+         [&terms](TermId lhs, TermId rhs)
+         {
+             return terms[lhs].word < terms[rhs].word;
+         });
+    vector<uint32_t> words(terms.size(), NONE);
+    for (uint32_t word = 0; word < term_ids.size(); ++word)
+    {
+        words[term_ids[word]] = word;
+        segment.word_data_.append(terms[term_ids[word]].word);
+        segment.word_offsets_.push_back(static_cast<uint32_t>(segment.word_data_.size()));
+    }
+
+    // Postings are put into buckets by word from the forward indexes. Documents come in ascending order,
+    // so every bucket comes out sorted
+    segment.posting_offsets_.assign(term_ids.size() + 1, 0);
+    for (const auto &[_, document_data] : search_server.documents_)
+    {
+        for (const auto [term_id, _] : *document_data.words)
+        {
+            ++segment.posting_offsets_[words[term_id] + 1];
+        }
+    }
+    partial_sum(segment.posting_offsets_.begin(), segment.posting_offsets_.end(), segment.posting_offsets_.begin());
+    segment.posting_documents_.resize(segment.posting_offsets_.back());
+    segment.posting_term_freqs_.resize(segment.posting_offsets_.back());
+    vector<uint32_t> next(segment.posting_offsets_.begin(), segment.posting_offsets_.end() - 1);
+    for (const auto &[document_id, document_data] : search_server.documents_)
+    {
+        const auto document = static_cast<uint32_t>(segment.document_ids_.size());
+        segment.document_ids_.push_back(document_id);
+        segment.ratings_.push_back(document_data.rating);
+        segment.statuses_.push_back(document_data.status);
+        for (const auto [term_id, term_freq] : *document_data.words)
+        {
+            const uint32_t i = next[words[term_id]]++;
+            segment.posting_documents_[i] = document;
+            segment.posting_term_freqs_[i] = term_freq;
+        }
+    }
+    segment.Finish();
+    return segment;
+}
+
+CompactSegment CompactSegment::Merge(const vector<const CompactSegment *> &segments, const vector<vector<bool>> &removed)
+{
+    CompactSegment merged;
+
+    struct Source
+    {
+        int document_id;
+        size_t segment;
+        uint32_t document;
+    };
+    vector<Source> sources;
+    for (size_t segment = 0; segment < segments.size(); ++segment)
+    {
+        for (uint32_t document = 0; document < segments[segment]->document_ids_.size(); ++document)
+        {
+            if (!removed[segment][document])
+            {
+                sources.push_back({segments[segment]->document_ids_[document], segment, document});
+            }
+        }
+    }
+    sort(sources.begin(), sources.end(),
+         [](const Source &lhs, const Source &rhs)
+         {
+             return lhs.document_id < rhs.document_id;
+         });
+
+    // New numbers of the documents of every segment; they grow with the old ones, so posting runs stay sorted
+    vector<vector<uint32_t>> numbers(segments.size());
+    for (size_t segment = 0; segment < segments.size(); ++segment)
+    {
+        numbers[segment].assign(segments[segment]->document_ids_.size(), NONE);
+    }
+    for (const Source &source : sources)
+    {
+        numbers[source.segment][source.document] = static_cast<uint32_t>(merged.document_ids_.size());
+        merged.document_ids_.push_back(source.document_id);
+        merged.ratings_.push_back(segments[source.segment]->ratings_[source.document]);
+        merged.statuses_.push_back(segments[source.segment]->statuses_[source.document]);
+    }
+
+    // The dictionaries are merged word by word, there are only a few segments
+    vector<uint32_t> positions(segments.size(), 0);
+    vector<pair<uint32_t, double>> postings;
+    while (true)
+    {
+        string_view word;
+        bool is_found = false;
+        for (size_t segment = 0; segment < segments.size(); ++segment)
+        {
+            if (positions[segment] < segments[segment]->GetWordCount())
+            {
+                const string_view candidate = segments[segment]->GetWord(positions[segment]);
+                if (!is_found || candidate < word)
+                {
+                    word = candidate;
+                    is_found = true;
+                }
+            }
+        }
+        if (!is_found)
+        {
+            break;
+        }
+
+        postings.clear();
+        for (size_t segment = 0; segment < segments.size(); ++segment)
+        {
+            const CompactSegment &source = *segments[segment];
+            if (positions[segment] >= source.GetWordCount() || source.GetWord(positions[segment]) != word)
+            {
+                continue;
+            }
+            const uint32_t source_word = positions[segment]++;
+            const size_t run_begin = postings.size();
+            for (uint32_t i = source.posting_offsets_[source_word]; i < source.posting_offsets_[source_word + 1]; ++i)
+            {
+                const uint32_t number = numbers[segment][source.posting_documents_[i]];
+                if (number != NONE)
+                {
+                    postings.emplace_back(number, source.posting_term_freqs_[i]);
+                }
+            }
+            inplace_merge(postings.begin(), postings.begin() + run_begin, postings.end());
+        }
+        if (!postings.empty())
+        {
+            merged.AddWord(word, postings);
+        }
+    }
+    merged.Finish();
+    return merged;
+}
+
+int CompactSegment::GetDocumentCount() const
+{
+    return static_cast<int>(document_ids_.size()) - removed_count_;
+}
+
+bool CompactSegment::Contains(int document_id) const
+{
+    const uint32_t document = FindDocument(document_id);
+    return document != NONE && !removed_[document];
+}
+
+bool CompactSegment::RemoveDocument(int document_id)
+{
+    const uint32_t document = FindDocument(document_id);
+    if (document == NONE || removed_[document])
+    {
+        return false;
+    }
+    removed_[document] = true;
+    ++removed_count_;
+    for (uint32_t i = forward_offsets_[document]; i < forward_offsets_[document + 1]; ++i)
+    {
+        ++removed_document_freqs_[forward_words_[i]];
+    }
+    return true;
+}
+
+const vector<bool> &CompactSegment::GetRemovedMarks() const
+{
+    return removed_;
+}
+
+vector<int> CompactSegment::GetRemovedSince(const vector<bool> &removed) const
+{
+    vector<int> result;
+    for (size_t document = 0; document < removed_.size(); ++document)
+    {
+        if (removed_[document] && !removed[document])
+        {
+            result.push_back(document_ids_[document]);
+        }
+    }
+    return result;
+}
+
+size_t CompactSegment::GetDocumentFreq(string_view word) const
+{
+    const uint32_t index = FindWord(word);
+    if (index == NONE)
+    {
+        return 0;
+    }
+    return posting_offsets_[index + 1] - posting_offsets_[index] - removed_document_freqs_[index];
+}
+
+SearchServer::OwningMatchResult CompactSegment::MatchDocument(const PreparedQuery &query, int document_id) const
+{
+    const uint32_t document = FindDocument(document_id);
+    if (document == NONE || removed_[document])
+    {
+        throw out_of_range("Invalid document_id"s);
+    }
+    const auto first = forward_words_.begin() + forward_offsets_[document];
+    const auto last = forward_words_.begin() + forward_offsets_[document + 1];
+    auto has_word = [&](const string &word)
+    {
+        const uint32_t index = FindWord(word);
+        return index != NONE && binary_search(first, last, index);
+    };
+
+    if (any_of(query.GetMinusWords().begin(), query.GetMinusWords().end(), has_word))
+    {
+        return {vector<string>{}, statuses_[document]};
+    }
+    vector<string> matched_words;
+    for (const string &word : query.GetPlusWords())
+    {
+        if (has_word(word))
+        {
+            matched_words.push_back(word);
+        }
+    }
+    return {matched_words, statuses_[document]};
+}
+
+size_t CompactSegment::GetWordCount() const
+{
+    return word_offsets_.size() - 1;
+}
+
+string_view CompactSegment::GetWord(uint32_t word) const
+{
+    return string_view(word_data_).substr(word_offsets_[word], word_offsets_[word + 1] - word_offsets_[word]);
+}
+
+uint32_t CompactSegment::FindWord(string_view word) const
+{
+    uint32_t begin = 0;
+    uint32_t end = static_cast<uint32_t>(GetWordCount());
+    while (begin < end)
+    {
+        const uint32_t middle = begin + (end - begin) / 2;
+        if (GetWord(middle) < word)
+        {
+            begin = middle + 1;
+        }
+        else
+        {
+            end = middle;
+        }
+    }
+    return begin < GetWordCount() && GetWord(begin) == word ? begin : NONE;
+}
+
+uint32_t CompactSegment::FindDocument(int document_id) const
+{
+    const auto it = lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
+    return it != document_ids_.end() && *it == document_id ? static_cast<uint32_t>(it - document_ids_.begin()) : NONE;
+}
+
+void CompactSegment::AddWord(string_view word, const vector<pair<uint32_t, double>> &postings)
+{
+    word_data_.append(word);
+    word_offsets_.push_back(static_cast<uint32_t>(word_data_.size()));
+    for (const auto &[document, term_freq] : postings)
+    {
+        posting_documents_.push_back(document);
+        posting_term_freqs_.push_back(term_freq);
+    }
+    posting_offsets_.push_back(static_cast<uint32_t>(posting_documents_.size()));
+}
+
+void CompactSegment::Finish()
+{
+    forward_offsets_.assign(document_ids_.size() + 1, 0);
+    for (const uint32_t document : posting_documents_)
+    {
+        ++forward_offsets_[document + 1];
+    }
+    partial_sum(forward_offsets_.begin(), forward_offsets_.end(), forward_offsets_.begin());
+
+    // Words are visited in order, so every document gets its words sorted
+    forward_words_.resize(posting_documents_.size());
+    vector<uint32_t> next(forward_offsets_.begin(), forward_offsets_.end() - 1);
+    for (uint32_t word = 0; word < GetWordCount(); ++word)
+    {
+        for (uint32_t i = posting_offsets_[word]; i < posting_offsets_[word + 1]; ++i)
+        {
+            forward_words_[next[posting_documents_[i]]++] = word;
+        }
+    }
+
+    removed_.assign(document_ids_.size(), false);
+    removed_document_freqs_.assign(GetWordCount(), 0);
+
+    word_data_.shrink_to_fit();
+    word_offsets_.shrink_to_fit();
+    posting_offsets_.shrink_to_fit();
+    posting_documents_.shrink_to_fit();
+    posting_term_freqs_.shrink_to_fit();
+    document_ids_.shrink_to_fit();
+    ratings_.shrink_to_fit();
+    statuses_.shrink_to_fit();
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "prepared_query.h"
+#include "query_arena.h"
+#include "search_server.h"
+
+// Immutable index of a set of documents in flat arrays: a sorted dictionary, the postings of all words one after
+// another and a forward index. Documents are numbered locally in the order of their ids. Removing a document only
+// marks it, queries skip marked documents and merging drops them.
+class CompactSegment
+{
+public:
+    // All documents of the server, read straight from its term pool and forward indexes
+    static CompactSegment Build(const SearchServer &search_server);
+    // Documents of the segments that are not marked in `removed`, one set of marks per segment:
+    // the segments themselves may be changed while they are merged
+    static CompactSegment Merge(const std::vector<const CompactSegment *> &segments, const std::vector<std::vector<bool>> &removed);
+
+    // Documents that are not removed
+    int GetDocumentCount() const;
+    bool Contains(int document_id) const;
+    // Returns whether the document was here
+    bool RemoveDocument(int document_id);
+
+    const std::vector<bool> &GetRemovedMarks() const;
+    // Documents removed since the marks were taken
+    std::vector<int> GetRemovedSince(const std::vector<bool> &removed) const;
+
+    // Number of documents with the word that are not removed
+    size_t GetDocumentFreq(std::string_view word) const;
+
+    // Plus-words are scored with the given IDF, words missing from it are skipped
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const PreparedQuery &query, const std::map<std::string_view, double> &inverse_document_freqs,
+                                           DocumentPredicate document_predicate) const;
+
+    // Throws std::out_of_range if the document is not here
+    SearchServer::OwningMatchResult MatchDocument(const PreparedQuery &query, int document_id) const;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    std::string word_data_;
+    std::vector<uint32_t> word_offsets_{0}; // word i is word_data_[word_offsets_[i], word_offsets_[i + 1])
+
+    std::vector<uint32_t> posting_offsets_{0}; // postings of word i are [posting_offsets_[i], posting_offsets_[i + 1])
+    std::vector<uint32_t> posting_documents_; // local numbers, ascending within a word
+    std::vector<double> posting_term_freqs_;
+
+    std::vector<int> document_ids_; // ascending
+    std::vector<int> ratings_;
+    std::vector<DocumentStatus> statuses_;
+    std::vector<uint32_t> forward_offsets_;
+    std::vector<uint32_t> forward_words_; // ascending within a document
+
+    std::vector<bool> removed_;
+    int removed_count_ = 0;
+    std::vector<uint32_t> removed_document_freqs_; // per word
+
+    size_t GetWordCount() const;
+    std::string_view GetWord(uint32_t word) const;
+    uint32_t FindWord(std::string_view word) const;
+    uint32_t FindDocument(int document_id) const;
+
+    void AddWord(std::string_view word, const std::vector<std::pair<uint32_t, double>> &postings);
+    // Builds the forward index and empty removal marks once all words are added
+    void Finish();
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> CompactSegment::FindTopDocuments(const PreparedQuery &query, const std::map<std::string_view, double> &inverse_document_freqs,
+                                                       DocumentPredicate document_predicate) const
+{
+    QueryArenaScope arena;
+    std::pmr::memory_resource *resource = arena.GetResource();
+
+    // <document, relevance> of every matching posting, summed per document after sorting
+    std::pmr::vector<std::pair<uint32_t, double>> scores(resource);
+    for (const std::string &plus_word : query.GetPlusWords())
+    {
+        const uint32_t word = FindWord(plus_word);
+        const auto inverse_document_freq = inverse_document_freqs.find(plus_word);
+        if (word == NONE || inverse_document_freq == inverse_document_freqs.end())
+        {
+            continue;
+        }
+        for (uint32_t i = posting_offsets_[word]; i < posting_offsets_[word + 1]; ++i)
+        {
+            const uint32_t document = posting_documents_[i];
+            if (!removed_[document] && document_predicate(document_ids_[document], statuses_[document], ratings_[document]))
+            {
+                scores.emplace_back(document, posting_term_freqs_[i] * inverse_document_freq->second);
+            }
+        }
+    }
+    // Stable, so relevance is summed in the order of the plus-words, as SearchServer does
+    std::stable_sort(scores.begin(), scores.end(),
+                     [](const auto &lhs, const auto &rhs)
+                     {
+                         return lhs.first < rhs.first;
+                     });
+
+    std::pmr::vector<uint32_t> excluded(resource);
+    for (const std::string &minus_word : query.GetMinusWords())
+    {
+        const uint32_t word = FindWord(minus_word);
+        if (word != NONE)
+        {
+            excluded.insert(excluded.end(), posting_documents_.begin() + posting_offsets_[word],
+                            posting_documents_.begin() + posting_offsets_[word + 1]);
+        }
+    }
+    std::sort(excluded.begin(), excluded.end());
+
+    std::pmr::vector<Document> documents(resource);
+    auto excluded_it = excluded.begin();
+    for (size_t begin = 0; begin < scores.size();)
+    {
+        const uint32_t document = scores[begin].first;
+        double relevance = 0.0;
+        size_t end = begin;
+        for (; end < scores.size() && scores[end].first == document; ++end)
+        {
+            relevance += scores[end].second;
+        }
+        begin = end;
+        excluded_it = std::lower_bound(excluded_it, excluded.end(), document);
+        if (excluded_it == excluded.end() || *excluded_it != document)
+        {
+            documents.push_back({document_ids_[document], relevance, ratings_[document]});
+        }
+    }
+
+    const size_t count = std::min(documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    std::partial_sort(documents.begin(), documents.begin() + count, documents.end(), IsMoreRelevant<Document>);
+    return {documents.begin(), documents.begin() + count};
+}
@@ -2,16 +2,6 @@
 
 using namespace std;
 
-Document::Document(int id, double relevance, int rating)
-        : id(id), relevance(relevance), rating(rating) {}
-std::ostream &operator<<(std::ostream &out, const Document &document) {
-    out << "{ "s
-        << "document_id = "s << document.id << ", "s
-        << "relevance = "s << document.relevance << ", "s
-        << "rating = "s << document.rating << " }"s;
-    return out;
-}
-
 void PrintDocument(const Document &document) {
 
     cout << "{ "s
@@ -6,16 +6,21 @@
 #include <map>
 #include <iostream>
 
-struct Document {
-    Document() = default;
+// Search result of BasicSearchServer, the types of the id and the relevance come from its IndexTraits
+template <typename DocumentId, typename Score>
+struct BasicDocument {
+    BasicDocument() = default;
 
-    Document(int id, double relevance, int rating);
+    BasicDocument(DocumentId id, Score relevance, int rating)
+            : id(id), relevance(relevance), rating(rating) {}
 
-    int id = 0;
-    double relevance = 0.0;
+    DocumentId id = 0;
+    Score relevance = 0;
     int rating = 0;
 };
 
+using Document = BasicDocument<int, double>;
+
 enum class DocumentStatus {
     ACTUAL,
     IRRELEVANT,
@@ -23,7 +28,14 @@ enum class DocumentStatus {
     REMOVED,
 };
 
-std::ostream &operator<<(std::ostream &out, const Document &document);
+template <typename DocumentId, typename Score>
+std::ostream &operator<<(std::ostream &out, const BasicDocument<DocumentId, Score> &document) {
+    out << "{ "
+        << "document_id = " << document.id << ", "
+        << "relevance = " << document.relevance << ", "
+        << "rating = " << document.rating << " }";
+    return out;
+}
 
 void PrintDocument(const Document& document);
 
@@ -0,0 +1,107 @@
+#include "document_bitmap.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+    // A flat bitmap is used while it takes at most this many bits per id, about what sparse chunks take
+    const size_t FLAT_BITS_PER_ID = 32;
+    const int CHUNK_BITS = 16;
+    const uint64_t CHUNK_MASK = (uint64_t(1) << CHUNK_BITS) - 1;
+    const size_t CHUNK_WORDS = (size_t(1) << CHUNK_BITS) / 64;
+}
+
+DocumentBitmap::DocumentBitmap(pmr::memory_resource *resource)
+    : words_(resource), chunks_(resource), values_(resource)
+{
+}
+
+DocumentBitmap::DocumentBitmap(pmr::vector<uint64_t> &document_ids, pmr::memory_resource *resource)
+    : DocumentBitmap(resource)
+{
+    if (!is_sorted(document_ids.begin(), document_ids.end()))
+    {
+        sort(document_ids.begin(), document_ids.end());
+    }
+    document_ids.erase(unique(document_ids.begin(), document_ids.end()), document_ids.end());
+    size_ = document_ids.size();
+    if (document_ids.empty())
+    {
+        return;
+    }
+
+    const uint64_t range = document_ids.back() - document_ids.front() + 1;
+    if (range != 0 && range <= size_ * FLAT_BITS_PER_ID)
+    {
+        min_id_ = document_ids.front();
+        range_ = static_cast<uint32_t>(range);
+        words_.assign((range + 63) / 64, 0);
+        for (const uint64_t document_id : document_ids)
+        {
+            const uint64_t offset = document_id - min_id_;
+            words_[offset >> 6] |= uint64_t(1) << (offset & 63);
+        }
+        return;
+    }
+
+    is_flat_ = false;
+    for (auto begin = document_ids.begin(); begin != document_ids.end();)
+    {
+        const uint64_t key = *begin >> CHUNK_BITS;
+        const auto end = find_if(begin, document_ids.end(),
+                                 [key](uint64_t document_id)
+                                 {
+                                     return document_id >> CHUNK_BITS != key;
+                                 });
+        const auto size = static_cast<uint32_t>(end - begin);
+        Chunk chunk{key, 0, size, size > SPARSE_CHUNK_LIMIT};
+        if (chunk.is_bitmap)
+        {
+            chunk.begin = static_cast<uint32_t>(words_.size());
+            words_.resize(words_.size() + CHUNK_WORDS, 0);
+            for (auto it = begin; it != end; ++it)
+            {
+                const uint64_t low = *it & CHUNK_MASK;
+                words_[chunk.begin + (low >> 6)] |= uint64_t(1) << (low & 63);
+            }
+        }
+        else
+        {
+            chunk.begin = static_cast<uint32_t>(values_.size());
+            for (auto it = begin; it != end; ++it)
+            {
+                values_.push_back(static_cast<uint16_t>(*it & CHUNK_MASK));
+            }
+        }
+        chunks_.push_back(chunk);
+        begin = end;
+    }
+}
+
+size_t DocumentBitmap::GetSize() const
+{
+    return size_;
+}
+
+bool DocumentBitmap::ContainsSparse(uint64_t document_id) const
+{
+    const uint64_t key = document_id >> CHUNK_BITS;
+    const auto chunk = lower_bound(chunks_.begin(), chunks_.end(), key,
+                                   [](const Chunk &chunk, uint64_t key)
+                                   {
+                                       return chunk.key < key;
+                                   });
+    if (chunk == chunks_.end() || chunk->key != key)
+    {
+        return false;
+    }
+    const uint64_t low = document_id & CHUNK_MASK;
+    if (chunk->is_bitmap)
+    {
+        return (words_[chunk->begin + (low >> 6)] >> (low & 63)) & 1;
+    }
+    const auto first = values_.begin() + chunk->begin;
+    return binary_search(first, first + chunk->size, static_cast<uint16_t>(low));
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Set of document ids that is built once and then only tested. A dense set is one flat bitmap over its id range.
+// A sparse one is kept in the roaring way: ids are split into chunks by the upper 16 bits, and every chunk is
+// either a sorted array of the lower 16 bits or, when it has more than SPARSE_CHUNK_LIMIT ids, a bitmap of them.
+class DocumentBitmap
+{
+public:
+    static const size_t SPARSE_CHUNK_LIMIT = 4096;
+
+    explicit DocumentBitmap(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+    // Ids of any IndexTraits::DocumentId converted to unsigned, they are sorted and deduplicated in place
+    DocumentBitmap(std::pmr::vector<uint64_t> &document_ids, std::pmr::memory_resource *resource);
+
+    // A negative id converts to a value above every stored one
+    bool Contains(uint64_t document_id) const;
+    size_t GetSize() const;
+
+private:
+    struct Chunk
+    {
+        uint64_t key;   // upper bits of the ids
+        uint32_t begin; // first element in values_ or words_
+        uint32_t size;  // number of ids
+        bool is_bitmap;
+    };
+
+    size_t size_ = 0;
+    bool is_flat_ = true;
+    uint64_t min_id_ = 0;
+    uint32_t range_ = 0; // flat bitmap covers [min_id_, min_id_ + range_)
+    std::pmr::vector<uint64_t> words_;
+    std::pmr::vector<Chunk> chunks_;
+    std::pmr::vector<uint16_t> values_;
+
+    bool ContainsSparse(uint64_t document_id) const;
+};
+
+inline bool DocumentBitmap::Contains(uint64_t document_id) const
+{
+    if (is_flat_)
+    {
+        // Ids below min_id_ wrap around to large offsets
+        const uint64_t offset = document_id - min_id_;
+        return offset < range_ && ((words_[offset >> 6] >> (offset & 63)) & 1);
+    }
+    return ContainsSparse(document_id);
+}
@@ -0,0 +1,247 @@
+#include "durable_search_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <exception>
+#include <execution>
+#include <fstream>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "binary_io.h"
+
+using namespace std;
+
+namespace
+{
+    // Snapshot file: uint32 magic, uint64 lsn, uint32 CRC-32 of the rest, the SearchServer snapshot
+    const uint32_t SNAPSHOT_MAGIC = 0x504E5353; // "SSNP"
+
+    string SnapshotPath(const string &directory)
+    {
+        return directory + "/snapshot"s;
+    }
+
+    string LogPath(const string &directory)
+    {
+        return directory + "/wal"s;
+    }
+
+    void SyncPath(const string &path, int flags)
+    {
+        const int fd = open(path.c_str(), flags | O_CLOEXEC);
+        if (fd < 0 || fsync(fd) != 0)
+        {
+            const int error = errno;
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            throw system_error(error, generic_category(), "Cannot sync "s + path);
+        }
+        close(fd);
+    }
+
+    void WriteFileDurably(const string &path, string_view data)
+    {
+        const string temp_path = path + ".tmp"s;
+        {
+            ofstream output(temp_path, ios::binary | ios::trunc);
+            output.write(data.data(), data.size());
+            if (!output)
+            {
+                throw runtime_error("Cannot write "s + temp_path);
+            }
+        }
+        SyncPath(temp_path, O_RDONLY);
+        if (rename(temp_path.c_str(), path.c_str()) != 0)
+        {
+            throw system_error(errno, generic_category(), "Cannot rename "s + temp_path);
+        }
+    }
+}
+
+DurableSearchServer::DurableSearchServer(const string &directory, string_view stop_words_text, WriteAheadLogOptions options)
+    : directory_(directory),
+      search_server_(LoadSnapshot(SnapshotPath(directory), stop_words_text, snapshot_lsn_))
+{
+    if (mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        throw system_error(errno, generic_category(), "Cannot create "s + directory_);
+    }
+    struct stat snapshot_stat;
+    if (stat(SnapshotPath(directory_).c_str(), &snapshot_stat) != 0)
+    {
+        WriteSnapshot(0);
+    }
+    const uint64_t last_lsn = ReplayLog(WriteAheadLog::Recover(LogPath(directory_)));
+    log_ = make_unique<WriteAheadLog>(LogPath(directory_), last_lsn + 1, options);
+    // A newly created log must not disappear with its directory entry
+    SyncPath(directory_, O_RDONLY | O_DIRECTORY);
+}
+
+void DurableSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int> &ratings)
+{
+    unique_lock lock(mutex_);
+    search_server_.AddDocument(document_id, document, status, ratings);
+    const uint64_t lsn = log_->AppendAddDocument(document_id, document, status, ratings);
+    lock.unlock();
+    log_->Sync(lsn);
+}
+
+void DurableSearchServer::AddDocuments(const vector<NewDocument> &documents)
+{
+    // SearchServer checks a batch at a time, so the batches added before a failed one are logged
+    unique_lock lock(mutex_);
+    uint64_t lsn = 0;
+    exception_ptr error;
+    for (size_t begin = 0; begin < documents.size(); begin += ADD_BATCH_SIZE)
+    {
+        const vector<NewDocument> batch(documents.begin() + begin, documents.begin() + min(documents.size(), begin + ADD_BATCH_SIZE));
+        try
+        {
+            search_server_.AddDocuments(execution::par, batch);
+        }
+        catch (...)
+        {
+            error = current_exception();
+            break;
+        }
+        for (const NewDocument &document : batch)
+        {
+            lsn = log_->AppendAddDocument(document.id, document.text, document.status, document.ratings);
+        }
+    }
+    lock.unlock();
+    log_->Sync(lsn);
+    if (error)
+    {
+        rethrow_exception(error);
+    }
+}
+
+void DurableSearchServer::RemoveDocument(int document_id)
+{
+    RemoveDocuments({document_id});
+}
+
+void DurableSearchServer::RemoveDocuments(const vector<int> &document_ids)
+{
+    if (document_ids.empty())
+    {
+        return;
+    }
+    // Unknown ids are logged as well, replaying them changes nothing
+    unique_lock lock(mutex_);
+    search_server_.RemoveDocuments(execution::par, document_ids);
+    const uint64_t lsn = log_->AppendRemoveDocuments(document_ids);
+    lock.unlock();
+    log_->Sync(lsn);
+}
+
+void DurableSearchServer::Checkpoint()
+{
+    lock_guard lock(mutex_);
+    const uint64_t lsn = log_->GetLastLsn();
+    log_->Sync(lsn);
+    WriteSnapshot(lsn);
+
+    // A crash before this point leaves records that are in the snapshot already, recovery skips them by LSN
+    log_->Truncate();
+}
+
+DurableSearchServer::ReadAccess DurableSearchServer::Read() const
+{
+    return {shared_lock(mutex_), search_server_};
+}
+
+const WriteAheadLog &DurableSearchServer::GetLog() const
+{
+    return *log_;
+}
+
+void DurableSearchServer::WriteSnapshot(uint64_t lsn)
+{
+    string body;
+    search_server_.SaveSnapshot(body);
+    string snapshot;
+    ByteWriter writer(snapshot);
+    writer.PutU32(SNAPSHOT_MAGIC);
+    writer.PutU64(lsn);
+    writer.PutU32(ComputeCrc32(body));
+    snapshot.append(body);
+    WriteFileDurably(SnapshotPath(directory_), snapshot);
+    SyncPath(directory_, O_RDONLY | O_DIRECTORY);
+    snapshot_lsn_ = lsn;
+}
+
+SearchServer DurableSearchServer::LoadSnapshot(const string &path, string_view stop_words_text, uint64_t &snapshot_lsn)
+{
+    ifstream input(path, ios::binary);
+    if (!input)
+    {
+        snapshot_lsn = 0;
+        return SearchServer(stop_words_text);
+    }
+    const string data((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+
+    // Unlike a torn log record, a damaged snapshot cannot be skipped
+    ByteReader reader(data);
+    const size_t header_size = 16;
+    if (data.size() < header_size || reader.GetU32() != SNAPSHOT_MAGIC)
+    {
+        throw runtime_error("Snapshot "s + path + " is not a snapshot"s);
+    }
+    snapshot_lsn = reader.GetU64();
+    const string_view body = string_view(data).substr(header_size);
+    if (reader.GetU32() != ComputeCrc32(body))
+    {
+        throw runtime_error("Snapshot "s + path + " is damaged"s);
+    }
+    return SearchServer::LoadSnapshot(body);
+}
+
+uint64_t DurableSearchServer::ReplayLog(vector<LogRecord> records)
+{
+    uint64_t last_lsn = snapshot_lsn_;
+    auto begin = records.begin();
+    while (begin != records.end() && begin->lsn <= snapshot_lsn_)
+    {
+        ++begin;
+    }
+    while (begin != records.end())
+    {
+        const LogRecordType type = begin->type;
+        auto end = find_if(begin, records.end(),
+                           [type](const LogRecord &record)
+                           {
+                               return record.type != type;
+                           });
+        if (type == LogRecordType::ADD_DOCUMENT)
+        {
+            vector<NewDocument> documents;
+            documents.reserve(end - begin);
+            for (auto it = begin; it != end; ++it)
+            {
+                documents.push_back({it->document_id, it->text, it->status, move(it->ratings)});
+            }
+            search_server_.AddDocuments(execution::par, documents);
+        }
+        else
+        {
+            vector<int> document_ids;
+            for (auto it = begin; it != end; ++it)
+            {
+                document_ids.insert(document_ids.end(), it->document_ids.begin(), it->document_ids.end());
+            }
+            search_server_.RemoveDocuments(execution::par, document_ids);
+        }
+        last_lsn = prev(end)->lsn;
+        begin = end;
+    }
+    return last_lsn;
+}
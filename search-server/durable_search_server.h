@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+// SearchServer whose changes survive a crash. A change is applied to the index, appended to the write-ahead log
+// and returns once the log is synced; concurrent writers share fsyncs. Checkpoint saves a snapshot of the index
+// and empties the log. The directory holds two files: "snapshot" and "wal".
+class DurableSearchServer
+{
+public:
+    // Searches through it run concurrently with each other, changes wait until it is destroyed
+    struct ReadAccess
+    {
+        std::shared_lock<std::shared_mutex> guard;
+        const SearchServer &search_server;
+    };
+
+    // Loads the snapshot and replays the log after it. Stop words are used only when the directory is new,
+    // then they are saved in its first snapshot
+    DurableSearchServer(const std::string &directory, std::string_view stop_words_text, WriteAheadLogOptions options = {});
+
+    // Thread-safe with respect to each other, a failed change is not logged
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int> &ratings);
+    void AddDocuments(const std::vector<NewDocument> &documents);
+    void RemoveDocument(int document_id);
+    void RemoveDocuments(const std::vector<int> &document_ids);
+
+    // Blocks changes while the snapshot is written
+    void Checkpoint();
+
+    // The index under a shared lock. A change is visible as soon as it is applied, that is before its log record
+    // is synced: a reader may see a change that a crash at that moment would lose
+    ReadAccess Read() const;
+    const WriteAheadLog &GetLog() const;
+
+private:
+    std::string directory_;
+    uint64_t snapshot_lsn_ = 0; // the last change in the snapshot
+    SearchServer search_server_;
+    mutable std::shared_mutex mutex_; // changes are logged in the order they are applied
+    std::unique_ptr<WriteAheadLog> log_;
+
+    static SearchServer LoadSnapshot(const std::string &path, std::string_view stop_words_text, uint64_t &snapshot_lsn);
+    void WriteSnapshot(uint64_t lsn);
+    // Replays runs of adds and of removes with the parallel batch methods, returns the last LSN
+    uint64_t ReplayLog(std::vector<LogRecord> records);
+};
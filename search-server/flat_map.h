@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Map kept as a vector of pairs sorted by key. Lookups are binary searches over contiguous memory and scans touch no
+// node pointers, inserts and erases shift the tail. Inserting keys in ascending order, as document ids usually come,
+// appends to the end.
+template <typename Key, typename Value, typename Allocator = std::allocator<std::pair<Key, Value>>>
+class FlatMap
+{
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using allocator_type = Allocator;
+    using Storage = std::vector<value_type, Allocator>;
+    using iterator = typename Storage::iterator;
+    using const_iterator = typename Storage::const_iterator;
+
+    FlatMap() = default;
+
+    explicit FlatMap(const Allocator &allocator)
+        : items_(allocator)
+    {
+    }
+
+    iterator begin()
+    {
+        return items_.begin();
+    }
+
+    iterator end()
+    {
+        return items_.end();
+    }
+
+    const_iterator begin() const
+    {
+        return items_.begin();
+    }
+
+    const_iterator end() const
+    {
+        return items_.end();
+    }
+
+    size_t size() const
+    {
+        return items_.size();
+    }
+
+    bool empty() const
+    {
+        return items_.empty();
+    }
+
+    iterator find(const Key &key)
+    {
+        const auto it = LowerBound(key);
+        return it != items_.end() && it->first == key ? it : items_.end();
+    }
+
+    const_iterator find(const Key &key) const
+    {
+        return const_cast<FlatMap *>(this)->find(key);
+    }
+
+    std::pair<iterator, bool> emplace(const Key &key, Value value)
+    {
+        if (items_.empty() || items_.back().first < key)
+        {
+            items_.emplace_back(key, std::move(value));
+            return {std::prev(items_.end()), true};
+        }
+        const auto it = LowerBound(key);
+        if (it != items_.end() && it->first == key)
+        {
+            return {it, false};
+        }
+        return {items_.emplace(it, key, std::move(value)), true};
+    }
+
+    // The hint is ignored: the position is found by the key
+    iterator emplace_hint(const_iterator, const Key &key, Value value)
+    {
+        return emplace(key, std::move(value)).first;
+    }
+
+    size_t erase(const Key &key)
+    {
+        const auto it = find(key);
+        if (it == items_.end())
+        {
+            return 0;
+        }
+        items_.erase(it);
+        return 1;
+    }
+
+    void shrink_to_fit()
+    {
+        items_.shrink_to_fit();
+    }
+
+private:
+    Storage items_;
+
+    iterator LowerBound(const Key &key)
+    {
+        return std::lower_bound(items_.begin(), items_.end(), key,
+                                [](const value_type &item, const Key &key)
+                                {
+                                    return item.first < key;
+                                });
+    }
+};
@@ -0,0 +1,82 @@
+#include "front_coded_dictionary.h"
+
+#include <algorithm>
+
+using namespace std;
+
+FrontCodedDictionary::FrontCodedDictionary(MemoryCounter &counter)
+    : data_(CountingAllocator<char>(&counter)),
+      block_offsets_(CountingAllocator<uint32_t>(&counter)),
+      term_ids_(CountingAllocator<TermId>(&counter))
+{
+}
+
+void FrontCodedDictionary::Append(string_view word, TermId term_id)
+{
+    if (term_ids_.size() % BLOCK_SIZE == 0)
+    {
+        block_offsets_.push_back(static_cast<uint32_t>(data_.size()));
+        PutLength(word.size());
+        data_.insert(data_.end(), word.begin(), word.end());
+    }
+    else
+    {
+        const size_t shared = mismatch(word.begin(), word.end(), last_word_.begin(), last_word_.end()).first - word.begin();
+        PutLength(shared);
+        PutLength(word.size() - shared);
+        data_.insert(data_.end(), word.begin() + shared, word.end());
+    }
+    term_ids_.push_back(term_id);
+    last_word_.assign(word);
+}
+
+void FrontCodedDictionary::ShrinkToFit()
+{
+    data_.shrink_to_fit();
+    block_offsets_.shrink_to_fit();
+    term_ids_.shrink_to_fit();
+    last_word_.clear();
+    last_word_.shrink_to_fit();
+}
+
+size_t FrontCodedDictionary::GetSize() const
+{
+    return term_ids_.size();
+}
+
+void FrontCodedDictionary::PutLength(size_t length)
+{
+    while (length >= 0x80)
+    {
+        data_.push_back(static_cast<char>((length & 0x7F) | 0x80));
+        length >>= 7;
+    }
+    data_.push_back(static_cast<char>(length));
+}
+
+size_t FrontCodedDictionary::GetLength(size_t &offset) const
+{
+    size_t length = 0;
+    for (int shift = 0;; shift += 7)
+    {
+        const auto byte = static_cast<unsigned char>(data_[offset++]);
+        length |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (byte < 0x80)
+        {
+            return length;
+        }
+    }
+}
+
+size_t FrontCodedDictionary::FindFirstBlock(string_view prefix) const
+{
+    // First words of blocks are stored in full, so they are compared in place
+    const auto block = partition_point(block_offsets_.begin(), block_offsets_.end(),
+                                       [this, prefix](uint32_t block_offset)
+                                       {
+                                           size_t offset = block_offset;
+                                           const size_t length = GetLength(offset);
+                                           return string_view(data_.data() + offset, length) < prefix;
+                                       });
+    return block == block_offsets_.begin() ? 0 : block - block_offsets_.begin() - 1;
+}
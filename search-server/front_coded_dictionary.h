@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "memory_stats.h"
+#include "prepared_query.h"
+
+// Sorted words with their term ids, built once by appending in ascending order. Words are stored in blocks of
+// BLOCK_SIZE: the first word of a block in full, every next one as the length of the prefix it shares with
+// the word before it and the rest of it. Lengths are varints, so words with common prefixes take a few bytes.
+class FrontCodedDictionary
+{
+public:
+    static const size_t BLOCK_SIZE = 16;
+
+    explicit FrontCodedDictionary(MemoryCounter &counter);
+
+    // Words must come in ascending order without repeats
+    void Append(std::string_view word, TermId term_id);
+    void ShrinkToFit();
+
+    size_t GetSize() const;
+
+    // Calls visitor(word, term_id) for the words starting with the prefix in ascending order while it returns true.
+    // The word is valid only during the call
+    template <typename Visitor>
+    void ForEachWithPrefix(std::string_view prefix, Visitor visitor) const;
+
+private:
+    std::vector<char, CountingAllocator<char>> data_;
+    std::vector<uint32_t, CountingAllocator<uint32_t>> block_offsets_; // where every block starts in data_
+    std::vector<TermId, CountingAllocator<TermId>> term_ids_;          // in the order of the words
+    std::string last_word_;
+
+    void PutLength(size_t length);
+    size_t GetLength(size_t &offset) const;
+    // First word of the last block that starts below the prefix, the prefix itself may begin in that block
+    size_t FindFirstBlock(std::string_view prefix) const;
+};
+
+template <typename Visitor>
+void FrontCodedDictionary::ForEachWithPrefix(std::string_view prefix, Visitor visitor) const
+{
+    std::string word;
+    for (size_t block = FindFirstBlock(prefix); block < block_offsets_.size(); ++block)
+    {
+        size_t offset = block_offsets_[block];
+        const size_t block_end = block + 1 < block_offsets_.size() ? block_offsets_[block + 1] : data_.size();
+        for (size_t index = block * BLOCK_SIZE; offset < block_end; ++index)
+        {
+            const size_t shared = index % BLOCK_SIZE == 0 ? 0 : GetLength(offset);
+            const size_t suffix = GetLength(offset);
+            word.resize(shared);
+            word.append(data_.data() + offset, suffix);
+            offset += suffix;
+
+            if (word.compare(0, prefix.size(), prefix) > 0)
+            {
+                return;
+            }
+            if (std::string_view(word).substr(0, prefix.size()) == prefix && !visitor(std::string_view(word), term_ids_[index]))
+            {
+                return;
+            }
+        }
+    }
+}
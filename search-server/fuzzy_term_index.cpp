@@ -0,0 +1,127 @@
+#include "fuzzy_term_index.h"
+
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+FuzzyTermIndex::FuzzyTermIndex(const FuzzyOptions &options, MemoryCounter &counter)
+    : options_(options),
+      deletions_(Deletions::allocator_type(&counter))
+{
+    if (options.max_edit_distance < 1 || options.max_edit_distance > 2)
+    {
+        throw invalid_argument("Edit distance must be 1 or 2"s);
+    }
+    if (!(options.penalty > 0.0 && options.penalty <= 1.0))
+    {
+        throw invalid_argument("Penalty must be in (0, 1]"s);
+    }
+    if (options.prefix_length <= static_cast<size_t>(options.max_edit_distance))
+    {
+        throw invalid_argument("Prefix must be longer than the edit distance"s);
+    }
+    if (options.max_corrections == 0)
+    {
+        throw invalid_argument("At least one correction must be allowed"s);
+    }
+}
+
+const FuzzyOptions &FuzzyTermIndex::GetOptions() const
+{
+    return options_;
+}
+
+void FuzzyTermIndex::AddTerm(string_view word, TermId term_id)
+{
+    for (const uint64_t hash : ComputeDeletionHashes(word, pmr::get_default_resource()))
+    {
+        deletions_.emplace(hash, term_id);
+    }
+}
+
+void FuzzyTermIndex::RemoveTerm(string_view word, TermId term_id)
+{
+    for (const uint64_t hash : ComputeDeletionHashes(word, pmr::get_default_resource()))
+    {
+        const auto [first, last] = deletions_.equal_range(hash);
+        const auto it = find_if(first, last,
+                                [term_id](const auto &entry)
+                                {
+                                    return entry.second == term_id;
+                                });
+        if (it != last)
+        {
+            deletions_.erase(it);
+        }
+    }
+}
+
+int FuzzyTermIndex::ComputeEditDistance(string_view lhs, string_view rhs, int limit)
+{
+    const size_t lhs_size = lhs.size();
+    const size_t rhs_size = rhs.size();
+    if ((lhs_size > rhs_size ? lhs_size - rhs_size : rhs_size - lhs_size) > static_cast<size_t>(limit))
+    {
+        return limit + 1;
+    }
+
+    // Rows i - 2, i - 1 and i of the distances between prefixes of lhs and rhs
+    vector<int> before_previous(rhs_size + 1);
+    vector<int> previous(rhs_size + 1);
+    vector<int> current(rhs_size + 1);
+    for (size_t j = 0; j <= rhs_size; ++j)
+    {
+        previous[j] = static_cast<int>(j);
+    }
+    for (size_t i = 1; i <= lhs_size; ++i)
+    {
+        current[0] = static_cast<int>(i);
+        int row_min = current[0];
+        for (size_t j = 1; j <= rhs_size; ++j)
+        {
+            const int cost = lhs[i - 1] == rhs[j - 1] ? 0 : 1;
+            current[j] = min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+            if (i > 1 && j > 1 && lhs[i - 1] == rhs[j - 2] && lhs[i - 2] == rhs[j - 1])
+            {
+                current[j] = min(current[j], before_previous[j - 2] + 1);
+            }
+            row_min = min(row_min, current[j]);
+        }
+        if (row_min > limit)
+        {
+            return limit + 1;
+        }
+        swap(before_previous, previous);
+        swap(previous, current);
+    }
+    return min(previous[rhs_size], limit + 1);
+}
+
+pmr::vector<uint64_t> FuzzyTermIndex::ComputeDeletionHashes(string_view word, pmr::memory_resource *resource) const
+{
+    const string_view prefix = word.substr(0, options_.prefix_length);
+    pmr::vector<pmr::string> level(resource);
+    level.emplace_back(prefix);
+    pmr::vector<uint64_t> hashes(resource);
+    hashes.push_back(hash<string_view>()(prefix));
+
+    for (int deleted = 1; deleted <= options_.max_edit_distance; ++deleted)
+    {
+        pmr::vector<pmr::string> next_level(resource);
+        for (const auto &text : level)
+        {
+            for (size_t i = 0; i < text.size(); ++i)
+            {
+                pmr::string shorter(text, resource);
+                shorter.erase(i, 1);
+                hashes.push_back(hash<string_view>()(shorter));
+                next_level.push_back(move(shorter));
+            }
+        }
+        level = move(next_level);
+    }
+    sort(hashes.begin(), hashes.end());
+    hashes.erase(unique(hashes.begin(), hashes.end()), hashes.end());
+    return hashes;
+}
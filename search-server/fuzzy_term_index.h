@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "memory_stats.h"
+#include "prepared_query.h"
+
+struct FuzzyOptions
+{
+    int max_edit_distance = 1; // 1 or 2
+    // A correction at distance d adds penalty^d of what the word itself would add to the relevance
+    double penalty = 0.5;
+    // Deletions are taken from the first prefix_length characters of a word only, which bounds the entries
+    // of a word by the sum of C(prefix_length, k) for k up to max_edit_distance: 8 for 7 and 1, 29 for 7 and 2
+    size_t prefix_length = 7;
+    // Closest corrections kept for an unknown query word, the ones in more documents first
+    size_t max_corrections = 3;
+};
+
+// Symmetric deletion index of the dictionary, as in SymSpell. Every word is stored under the hashes of all
+// strings made by deleting up to max_edit_distance characters from its prefix. Deleting characters from a
+// query word the same way yields every word within that edit distance among its candidates, which are then
+// checked with the real distance. Hash collisions only add candidates.
+class FuzzyTermIndex
+{
+public:
+    struct Correction
+    {
+        TermId term_id;
+        int distance;
+    };
+
+    // Throws std::invalid_argument if the options are out of range
+    FuzzyTermIndex(const FuzzyOptions &options, MemoryCounter &counter);
+
+    const FuzzyOptions &GetOptions() const;
+
+    void AddTerm(std::string_view word, TermId term_id);
+    void RemoveTerm(std::string_view word, TermId term_id);
+
+    // Terms within max_edit_distance of the word, get_word(term_id) returns the word of a term
+    template <typename GetWord>
+    std::pmr::vector<Correction> FindCorrections(std::string_view word, GetWord get_word, std::pmr::memory_resource *resource) const;
+
+    // Optimal string alignment distance: insertions, deletions, substitutions and transpositions of adjacent
+    // characters. Anything above the limit is returned as limit + 1
+    static int ComputeEditDistance(std::string_view lhs, std::string_view rhs, int limit);
+
+private:
+    using Deletions = std::unordered_multimap<uint64_t, TermId, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                                              CountingAllocator<std::pair<const uint64_t, TermId>>>;
+
+    FuzzyOptions options_;
+    Deletions deletions_;
+
+    // Sorted and unique, the word itself with no deletions included
+    std::pmr::vector<uint64_t> ComputeDeletionHashes(std::string_view word, std::pmr::memory_resource *resource) const;
+};
+
+template <typename GetWord>
+std::pmr::vector<FuzzyTermIndex::Correction> FuzzyTermIndex::FindCorrections(std::string_view word, GetWord get_word,
+                                                                             std::pmr::memory_resource *resource) const
+{
+    std::pmr::vector<TermId> candidates(resource);
+    for (const uint64_t hash : ComputeDeletionHashes(word, resource))
+    {
+        const auto [first, last] = deletions_.equal_range(hash);
+        for (auto it = first; it != last; ++it)
+        {
+            candidates.push_back(it->second);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::pmr::vector<Correction> corrections(resource);
+    for (const TermId term_id : candidates)
+    {
+        const int distance = ComputeEditDistance(word, get_word(term_id), options_.max_edit_distance);
+        if (distance <= options_.max_edit_distance)
+        {
+            corrections.push_back({term_id, distance});
+        }
+    }
+    return corrections;
+}
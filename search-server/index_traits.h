@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+#include "flat_map.h"
+#include "memory_stats.h"
+
+// Posting container policies: Container<DocumentId, Posting> maps document ids to postings in ascending id order and
+// is constructed from a CountingAllocator, so the footprint of the postings is counted
+struct TreePostings
+{
+    template <typename Key, typename Value>
+    using Container = CountedMap<Key, Value>;
+};
+
+struct FlatPostings
+{
+    template <typename Key, typename Value>
+    using Container = FlatMap<Key, Value, CountingAllocator<std::pair<Key, Value>>>;
+};
+
+// Compile-time configuration of the inverted index: width of document ids, precision of term frequencies and
+// relevance, and the container of posting lists
+template <typename DocumentIdType, typename ScoreType, typename PostingsPolicy>
+struct IndexTraits
+{
+    using DocumentId = DocumentIdType;
+    using Score = ScoreType;
+    using Postings = PostingsPolicy;
+};
+
+// BasicSearchServer is instantiated in search_server.cpp for the three layouts below only.
+// Layout used by SearchServer
+using DefaultIndexTraits = IndexTraits<int, double, TreePostings>;
+// 12-byte postings in flat arrays for large collections that can afford single-precision relevance
+using CompactIndexTraits = IndexTraits<uint32_t, float, FlatPostings>;
+// Ids that do not fit into 32 bits, e.g. external keys used as document ids
+using WideIndexTraits = IndexTraits<int64_t, double, TreePostings>;
+
+template <typename Traits>
+struct BasicPosting
+{
+    typename Traits::Score term_freq;
+    // term_freq * IDF, kept only in the impact scoring mode
+    typename Traits::Score impact = 0;
+};
+
+// <doc_id, posting>
+template <typename Traits>
+using BasicPostingList =
+    typename Traits::Postings::template Container<typename Traits::DocumentId, BasicPosting<Traits>>;
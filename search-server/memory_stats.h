@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <scoped_allocator>
+#include <set>
+#include <string>
+
+// Size of the heap chunk glibc malloc hands out for a request: 8 bytes of header, 16-byte alignment, 32 bytes minimum
+inline size_t EstimateHeapChunkSize(size_t bytes)
+{
+    const size_t chunk = (bytes + 8 + 15) & ~static_cast<size_t>(15);
+    return chunk < 32 ? 32 : chunk;
+}
+
+struct MemoryCounter
+{
+    std::atomic<int64_t> bytes{0};
+};
+
+// Allocator that adds every allocation, including the estimated malloc overhead, to a MemoryCounter.
+// A default-constructed allocator counts nothing.
+template <typename T>
+class CountingAllocator
+{
+public:
+    using value_type = T;
+
+    CountingAllocator() noexcept = default;
+
+    explicit CountingAllocator(MemoryCounter *counter) noexcept
+        : counter_(counter)
+    {
+    }
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U> &other) noexcept
+        : counter_(other.GetCounter())
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        T *result = static_cast<T *>(::operator new(n * sizeof(T)));
+        if (counter_)
+        {
+            counter_->bytes.fetch_add(EstimateHeapChunkSize(n * sizeof(T)), std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    void deallocate(T *p, size_t n) noexcept
+    {
+        if (counter_)
+        {
+            counter_->bytes.fetch_sub(EstimateHeapChunkSize(n * sizeof(T)), std::memory_order_relaxed);
+        }
+        ::operator delete(p);
+    }
+
+    MemoryCounter *GetCounter() const noexcept
+    {
+        return counter_;
+    }
+
+private:
+    MemoryCounter *counter_ = nullptr;
+};
+
+template <typename T, typename U>
+bool operator==(const CountingAllocator<T> &lhs, const CountingAllocator<U> &rhs) noexcept
+{
+    return lhs.GetCounter() == rhs.GetCounter();
+}
+
+template <typename T, typename U>
+bool operator!=(const CountingAllocator<T> &lhs, const CountingAllocator<U> &rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+// Nested containers and strings receive the allocator of their parent and are counted with it
+template <typename T>
+using CountingAdaptor = std::scoped_allocator_adaptor<CountingAllocator<T>>;
+
+using CountedString = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
+
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+using CountedMap = std::map<Key, Value, Compare, CountingAdaptor<std::pair<const Key, Value>>>;
+
+template <typename Key, typename Compare = std::less<Key>>
+using CountedSet = std::set<Key, Compare, CountingAdaptor<Key>>;
+
+// Heap bytes used by the SearchServer structures
+struct MemoryStats
+{
+    size_t stop_words = 0;
+    size_t terms = 0;      // term pool: words and their posting lists
+    size_t dictionary = 0; // word -> term id
+    size_t documents = 0;  // document data with the forward index
+    size_t document_ids = 0;
+    size_t fuzzy = 0; // deletion index of the fuzzy search
+
+    size_t Total() const
+    {
+        return stop_words + terms + dictionary + documents + document_ids + fuzzy;
+    }
+};
+
+enum class MemoryBudgetPolicy
+{
+    FAIL_FAST, // AddDocument throws std::length_error when the budget would be exceeded
+    COMPACT,   // Compact first, throw only if that did not free enough
+};
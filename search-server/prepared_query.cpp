@@ -0,0 +1,81 @@
+#include "prepared_query.h"
+#include "search_server.h"
+
+using namespace std;
+
+template <typename Traits>
+BasicPreparedQuery<Traits>::BasicPreparedQuery(const BasicPreparedQuery &other)
+    : plus_words_(other.plus_words_), minus_words_(other.minus_words_),
+      plus_prefixes_(other.plus_prefixes_), minus_prefixes_(other.minus_prefixes_)
+{
+}
+
+template <typename Traits>
+BasicPreparedQuery<Traits> &BasicPreparedQuery<Traits>::operator=(const BasicPreparedQuery &other)
+{
+    if (this != &other)
+    {
+        plus_words_ = other.plus_words_;
+        minus_words_ = other.minus_words_;
+        plus_prefixes_ = other.plus_prefixes_;
+        minus_prefixes_ = other.minus_prefixes_;
+        terms_ = {};
+        search_server_id_ = 0;
+        generation_ = 0;
+    }
+    return *this;
+}
+
+template <typename Traits>
+const vector<string> &BasicPreparedQuery<Traits>::GetPlusWords() const
+{
+    return plus_words_;
+}
+
+template <typename Traits>
+const vector<string> &BasicPreparedQuery<Traits>::GetMinusWords() const
+{
+    return minus_words_;
+}
+
+template <typename Traits>
+const vector<string> &BasicPreparedQuery<Traits>::GetPlusPrefixes() const
+{
+    return plus_prefixes_;
+}
+
+template <typename Traits>
+const vector<string> &BasicPreparedQuery<Traits>::GetMinusPrefixes() const
+{
+    return minus_prefixes_;
+}
+
+template <typename Traits>
+const BasicResolvedQuery<Traits> &BasicPreparedQuery<Traits>::GetTerms() const
+{
+    return terms_;
+}
+
+template <typename Traits>
+bool BasicPreparedQuery<Traits>::IsResolvedFor(const BasicSearchServer<Traits> &search_server) const
+{
+    return search_server_id_ == search_server.GetInstanceId() && generation_ == search_server.GetGeneration();
+}
+
+template <typename Traits>
+void BasicPreparedQuery<Traits>::OverrideInverseDocumentFreqs(const map<string_view, double> &inverse_document_freqs)
+{
+    for (QueryTerm &term : terms_.plus_terms)
+    {
+        auto it = inverse_document_freqs.find(term.word);
+        if (it != inverse_document_freqs.end())
+        {
+            term.inverse_document_freq = it->second;
+            term.use_impacts = false;
+        }
+    }
+}
+
+template class BasicPreparedQuery<DefaultIndexTraits>;
+template class BasicPreparedQuery<CompactIndexTraits>;
+template class BasicPreparedQuery<WideIndexTraits>;
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "index_traits.h"
+#include "memory_stats.h"
+
+template <typename Traits>
+class BasicSearchServer;
+
+// Index of a word in the term pool of SearchServer
+using TermId = uint32_t;
+
+// Query word resolved against the index: points straight to its posting list
+template <typename Traits>
+struct BasicQueryTerm
+{
+    std::string_view word;
+    const BasicPostingList<Traits> *postings = nullptr;
+    double inverse_document_freq = 0.0;
+    TermId term_id = 0;
+    // Relevance is summed from the precomputed impacts of the postings
+    bool use_impacts = false;
+};
+
+// Vectors take the resource of the query, the terms of a PreparedQuery use the default one
+template <typename Traits>
+struct BasicResolvedQuery
+{
+    std::pmr::vector<BasicQueryTerm<Traits>> plus_terms;
+    std::pmr::vector<BasicQueryTerm<Traits>> minus_terms;
+};
+
+// Query parsed and validated once by SearchServer::PrepareQuery and executed many times.
+// Resolved terms are tied to the server instance and its generation and are re-resolved when either changes.
+template <typename Traits>
+class BasicPreparedQuery
+{
+public:
+    using QueryTerm = BasicQueryTerm<Traits>;
+    using ResolvedQuery = BasicResolvedQuery<Traits>;
+
+    BasicPreparedQuery() = default;
+    // Terms point into the words of the source object, so a copy is resolved again on first use
+    BasicPreparedQuery(const BasicPreparedQuery &other);
+    BasicPreparedQuery &operator=(const BasicPreparedQuery &other);
+    BasicPreparedQuery(BasicPreparedQuery &&other) = default;
+    BasicPreparedQuery &operator=(BasicPreparedQuery &&other) = default;
+
+    const std::vector<std::string> &GetPlusWords() const;
+    const std::vector<std::string> &GetMinusWords() const;
+    // Prefixes of the words ending with '*', without it
+    const std::vector<std::string> &GetPlusPrefixes() const;
+    const std::vector<std::string> &GetMinusPrefixes() const;
+
+    const ResolvedQuery &GetTerms() const;
+
+    bool IsResolvedFor(const BasicSearchServer<Traits> &search_server) const;
+
+    // Replaces the cached IDF of resolved plus-terms, e.g. with values computed over several indexes.
+    // Words missing in the map keep their own value. The override is lost when the query is re-resolved.
+    // Overridden terms are scored from term frequencies, precomputed impacts use the local IDF.
+    void OverrideInverseDocumentFreqs(const std::map<std::string_view, double> &inverse_document_freqs);
+
+private:
+    friend class BasicSearchServer<Traits>;
+
+    std::vector<std::string> plus_words_;
+    std::vector<std::string> minus_words_;
+    std::vector<std::string> plus_prefixes_;
+    std::vector<std::string> minus_prefixes_;
+
+    ResolvedQuery terms_;
+    uint64_t search_server_id_ = 0; // instance id of the server the terms point into, 0 - none
+    uint64_t generation_ = 0;
+};
+
+using QueryTerm = BasicQueryTerm<DefaultIndexTraits>;
+using ResolvedQuery = BasicResolvedQuery<DefaultIndexTraits>;
+using PreparedQuery = BasicPreparedQuery<DefaultIndexTraits>;
+
+// Instantiated in prepared_query.cpp for the traits of index_traits.h
+extern template class BasicPreparedQuery<DefaultIndexTraits>;
+extern template class BasicPreparedQuery<CompactIndexTraits>;
+extern template class BasicPreparedQuery<WideIndexTraits>;
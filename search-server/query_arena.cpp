@@ -0,0 +1,118 @@
+#include "query_arena.h"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+using namespace std;
+
+namespace
+{
+    const size_t INITIAL_ARENA_SIZE = 64 * 1024;
+    const size_t MAX_ARENA_SIZE = 16 * 1024 * 1024;
+
+    // Upstream of the arena: counts what did not fit into the buffer, so the next buffer can be large enough
+    class OverflowResource : public pmr::memory_resource
+    {
+    public:
+        size_t GetAllocatedBytes() const
+        {
+            return allocated_bytes_;
+        }
+
+        void ResetAllocatedBytes()
+        {
+            allocated_bytes_ = 0;
+        }
+
+    private:
+        size_t allocated_bytes_ = 0;
+
+        void *do_allocate(size_t bytes, size_t alignment) override
+        {
+            allocated_bytes_ += bytes;
+            return pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override
+        {
+            pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    class ThreadArena
+    {
+    public:
+        ThreadArena()
+        {
+            Allocate(INITIAL_ARENA_SIZE);
+        }
+
+        pmr::memory_resource *GetResource()
+        {
+            return &*resource_;
+        }
+
+        void Release()
+        {
+            resource_->release();
+            const size_t overflow = overflow_.GetAllocatedBytes();
+            overflow_.ResetAllocatedBytes();
+            if (overflow > 0 && buffer_size_ < MAX_ARENA_SIZE)
+            {
+                size_t size = buffer_size_;
+                while (size < buffer_size_ + overflow && size < MAX_ARENA_SIZE)
+                {
+                    size *= 2;
+                }
+                Allocate(size);
+            }
+        }
+
+        int depth = 0;
+
+    private:
+        OverflowResource overflow_;
+        unique_ptr<byte[]> buffer_;
+        size_t buffer_size_ = 0;
+        optional<pmr::monotonic_buffer_resource> resource_;
+
+        void Allocate(size_t size)
+        {
+            resource_.reset();
+            buffer_.reset(new byte[size]);
+            buffer_size_ = size;
+            resource_.emplace(buffer_.get(), buffer_size_, &overflow_);
+        }
+    };
+
+    ThreadArena &GetThreadArena()
+    {
+        thread_local ThreadArena arena;
+        return arena;
+    }
+}
+
+QueryArenaScope::QueryArenaScope()
+{
+    ++GetThreadArena().depth;
+}
+
+QueryArenaScope::~QueryArenaScope()
+{
+    ThreadArena &arena = GetThreadArena();
+    if (--arena.depth == 0)
+    {
+        arena.Release();
+    }
+}
+
+pmr::memory_resource *QueryArenaScope::GetResource() const
+{
+    return GetThreadArena().GetResource();
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <memory_resource>
+
+// Memory for the temporaries of one search. Every thread has its own monotonic arena, so an allocation is
+// a pointer bump without locks. The arena is released at once when the outermost scope on the thread ends,
+// nothing allocated from it may outlive that scope. The arena grows to fit the largest query it has seen.
+class QueryArenaScope
+{
+public:
+    QueryArenaScope();
+    ~QueryArenaScope();
+
+    QueryArenaScope(const QueryArenaScope &) = delete;
+    QueryArenaScope &operator=(const QueryArenaScope &) = delete;
+
+    std::pmr::memory_resource *GetResource() const;
+};
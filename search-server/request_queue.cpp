@@ -1,5 +1,7 @@
 #include "request_queue.h"
 
+#include <stdexcept>
+
 using namespace std;
 
 RequestQueue::RequestQueue(const SearchServer &search_server)
@@ -41,3 +43,74 @@ void RequestQueue::AddRequest(int results_num) {
     }
 }
 
+ConcurrentRequestQueue::ConcurrentRequestQueue(const SearchServer &search_server, size_t window_size)
+        : search_server_(search_server), no_result_ticks_(window_size) {
+    if (window_size == 0) {
+        throw invalid_argument("Window size must be positive"s);
+    }
+}
+
+ConcurrentRequestQueue::ConcurrentRequestQueue(const SearchServer &search_server, Clock::duration window,
+                                               size_t bucket_count)
+        : search_server_(search_server), no_result_buckets_(bucket_count), start_(Clock::now()) {
+    if (bucket_count == 0 || window < Clock::duration(bucket_count)) {
+        throw invalid_argument("Window must be positive and not shorter than one clock tick per bucket"s);
+    }
+    bucket_width_ = window / bucket_count;
+}
+
+vector<Document> ConcurrentRequestQueue::AddFindRequest(const string &raw_query, DocumentStatus status) {
+    const auto result = search_server_.FindTopDocuments(raw_query, status);
+    AddRequest(result.size());
+    return result;
+}
+
+vector<Document> ConcurrentRequestQueue::AddFindRequest(const string &raw_query) {
+    const auto result = search_server_.FindTopDocuments(raw_query);
+    AddRequest(result.size());
+    return result;
+}
+
+int ConcurrentRequestQueue::GetNoResultRequests() const {
+    if (no_result_buckets_.empty()) {
+        return no_results_requests_.load(memory_order_relaxed);
+    }
+    const uint32_t current_bucket = GetCurrentBucket();
+    int result = 0;
+    for (const auto &bucket : no_result_buckets_) {
+        const uint64_t value = bucket.load(memory_order_relaxed);
+        if (static_cast<uint32_t>(current_bucket - static_cast<uint32_t>(value >> 32)) < no_result_buckets_.size()) {
+            result += static_cast<uint32_t>(value);
+        }
+    }
+    return result;
+}
+
+void ConcurrentRequestQueue::AddRequest(size_t results_num) {
+    const uint8_t no_results = results_num == 0 ? 1 : 0;
+    if (no_result_buckets_.empty()) {
+        // the tick of the request replaces the one that leaves the window, the counter gets the difference
+        const uint64_t tick = current_tick_.fetch_add(1, memory_order_relaxed);
+        const uint8_t left = no_result_ticks_[tick % no_result_ticks_.size()].exchange(no_results, memory_order_relaxed);
+        if (no_results != left) {
+            no_results_requests_.fetch_add(no_results - left, memory_order_relaxed);
+        }
+        return;
+    }
+    // requests with results are not stored in the time window at all
+    if (!no_results) {
+        return;
+    }
+    const uint64_t current_bucket = GetCurrentBucket();
+    auto &bucket = no_result_buckets_[current_bucket % no_result_buckets_.size()];
+    uint64_t value = bucket.load(memory_order_relaxed);
+    uint64_t updated;
+    do {
+        // a bucket left from an older period starts counting again
+        updated = (value >> 32) == current_bucket ? value + 1 : (current_bucket << 32 | 1);
+    } while (!bucket.compare_exchange_weak(value, updated, memory_order_relaxed));
+}
+
+uint32_t ConcurrentRequestQueue::GetCurrentBucket() const {
+    return static_cast<uint32_t>((Clock::now() - start_) / bucket_width_);
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <vector>
 #include <string>
 
@@ -38,4 +40,46 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query,
     const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
     AddRequest(result.size());
     return result;
-}
\ No newline at end of file
+}
+
+// RequestQueue for many threads at once. Requests are counted with atomics only, in a window of either
+// the last requests or the last period of time. The server must not be modified while requests are added.
+class ConcurrentRequestQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Window of the last `window_size` requests, like in RequestQueue
+    explicit ConcurrentRequestQueue(const SearchServer &search_server, size_t window_size = default_window_size_);
+    // Window of the last `window` of time kept in `bucket_count` buckets, a request may leave it one bucket early
+    ConcurrentRequestQueue(const SearchServer &search_server, Clock::duration window, size_t bucket_count = 60);
+
+    template<typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(const std::string &raw_query, DocumentPredicate document_predicate);
+    std::vector<Document> AddFindRequest(const std::string &raw_query, DocumentStatus status);
+    std::vector<Document> AddFindRequest(const std::string &raw_query);
+
+    int GetNoResultRequests() const;
+
+private:
+    const static size_t default_window_size_ = 1440;
+
+    const SearchServer &search_server_;
+    // Request-count window: a ring with the no-result flag of every tick
+    std::vector<std::atomic<uint8_t>> no_result_ticks_;
+    alignas(64) std::atomic<uint64_t> current_tick_{0};
+    alignas(64) std::atomic<int> no_results_requests_{0};
+    // Time window: every bucket packs its number (upper 32 bits) and its no-result count (lower 32 bits)
+    std::vector<std::atomic<uint64_t>> no_result_buckets_;
+    Clock::duration bucket_width_{};
+    Clock::time_point start_;
+
+    void AddRequest(size_t results_num);
+    uint32_t GetCurrentBucket() const;
+};
+
+template<typename DocumentPredicate>
+std::vector<Document> ConcurrentRequestQueue::AddFindRequest(const std::string &raw_query, DocumentPredicate document_predicate) {
+    const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
+    AddRequest(result.size());
+    return result;
+}
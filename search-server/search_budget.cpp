@@ -0,0 +1,48 @@
+#include "search_budget.h"
+
+using namespace std;
+
+CancellationToken::CancellationToken()
+    : cancelled_(make_shared<atomic<bool>>(false))
+{
+}
+
+void CancellationToken::Cancel() const
+{
+    cancelled_->store(true, memory_order_relaxed);
+}
+
+bool CancellationToken::IsCancelled() const
+{
+    return cancelled_->load(memory_order_relaxed);
+}
+
+SearchBudget::SearchBudget(Clock::time_point deadline, CancellationToken token)
+    : deadline_(deadline), token_(move(token))
+{
+}
+
+SearchBudget::SearchBudget(Clock::duration timeout, CancellationToken token)
+    : SearchBudget(Clock::now() + timeout, move(token))
+{
+}
+
+bool SearchBudget::IsExhausted() const
+{
+    return token_.IsCancelled() || Clock::now() >= deadline_;
+}
+
+SearchBudget::Clock::time_point SearchBudget::GetDeadline() const
+{
+    return deadline_;
+}
+
+const CancellationToken &SearchBudget::GetToken() const
+{
+    return token_;
+}
+
+BudgetExhausted::BudgetExhausted()
+    : runtime_error("Search budget is exhausted"s)
+{
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "document.h"
+
+// How many postings are scored between two checks of the budget
+const int BUDGET_CHECK_INTERVAL = 256;
+
+// Copies share the state, so a token passed into an asynchronous search can be cancelled from outside
+class CancellationToken
+{
+public:
+    CancellationToken();
+
+    void Cancel() const;
+    bool IsCancelled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+// Deadline and cancellation token limiting a single search
+class SearchBudget
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit SearchBudget(Clock::time_point deadline, CancellationToken token = CancellationToken());
+    explicit SearchBudget(Clock::duration timeout, CancellationToken token = CancellationToken());
+
+    bool IsExhausted() const;
+
+    Clock::time_point GetDeadline() const;
+    const CancellationToken &GetToken() const;
+
+private:
+    Clock::time_point deadline_;
+    CancellationToken token_;
+};
+
+// Budget of the ordinary searches, checks of it are optimized away
+struct UnlimitedBudget
+{
+    bool IsExhausted() const
+    {
+        return false;
+    }
+};
+
+class BudgetExhausted : public std::runtime_error
+{
+public:
+    BudgetExhausted();
+};
+
+template <typename DocumentType>
+struct BasicSearchResult
+{
+    std::vector<DocumentType> documents;
+    // Scoring was interrupted by the budget: relevances may be underestimated and documents missing
+    bool is_partial = false;
+};
+
+using SearchResult = BasicSearchResult<Document>;
@@ -0,0 +1,48 @@
+#include "search_page.h"
+
+using namespace std;
+
+template <typename Traits>
+BasicSearchCursor<Traits>::BasicSearchCursor(shared_ptr<State> state, size_t offset)
+    : state_(move(state)), offset_(offset)
+{
+}
+
+template <typename Traits>
+size_t BasicSearchCursor<Traits>::GetOffset() const
+{
+    return offset_;
+}
+
+template <typename Traits>
+BasicSearchPage<Traits>::BasicSearchPage(shared_ptr<State> state, size_t offset, size_t size)
+    : BasicSearchPage::IteratorRange(state->documents.cbegin() + offset, state->documents.cbegin() + offset + size),
+      offset_(offset),
+      next_cursor_(move(state), offset + size)
+{
+}
+
+template <typename Traits>
+size_t BasicSearchPage<Traits>::GetOffset() const
+{
+    return offset_;
+}
+
+template <typename Traits>
+size_t BasicSearchPage<Traits>::GetTotalCount() const
+{
+    return next_cursor_.state_->documents.size();
+}
+
+template <typename Traits>
+const BasicSearchCursor<Traits> &BasicSearchPage<Traits>::GetNextCursor() const
+{
+    return next_cursor_;
+}
+
+template class BasicSearchCursor<DefaultIndexTraits>;
+template class BasicSearchCursor<CompactIndexTraits>;
+template class BasicSearchCursor<WideIndexTraits>;
+template class BasicSearchPage<DefaultIndexTraits>;
+template class BasicSearchPage<CompactIndexTraits>;
+template class BasicSearchPage<WideIndexTraits>;
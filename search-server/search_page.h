@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "document.h"
+#include "index_traits.h"
+#include "paginator.h"
+#include "prepared_query.h"
+
+template <typename Traits>
+class BasicSearchPage;
+
+// Opaque position in the ranking of a paged search. Copies share the scored documents,
+// so the next pages are cut from them without scoring the query again.
+// A cursor and the pages made from it must not be used from several threads at once.
+template <typename Traits>
+class BasicSearchCursor
+{
+public:
+    BasicSearchCursor() = default;
+
+    // Index of the first document of the page this cursor points to
+    size_t GetOffset() const;
+
+private:
+    friend class BasicSearchServer<Traits>;
+    friend class BasicSearchPage<Traits>;
+
+    using DocumentId = typename Traits::DocumentId;
+
+    struct State
+    {
+        BasicPreparedQuery<Traits> query;
+        std::function<bool(DocumentId, DocumentStatus, int)> document_predicate;
+        uint64_t search_server_id = 0; // instance id of the server that scored the documents, 0 - none
+        uint64_t generation = 0;
+        // All matched documents, only the first `ranked` of them are in result order
+        std::vector<BasicDocument<DocumentId, typename Traits::Score>> documents;
+        size_t ranked = 0;
+    };
+
+    BasicSearchCursor(std::shared_ptr<State> state, size_t offset);
+
+    std::shared_ptr<State> state_;
+    size_t offset_ = 0;
+};
+
+// Documents of one page in result order. The page owns them, its iterators stay valid while any copy of it
+// or of its cursors is alive.
+template <typename Traits>
+class BasicSearchPage
+    : public IteratorRange<typename std::vector<BasicDocument<typename Traits::DocumentId, typename Traits::Score>>::const_iterator>
+{
+public:
+    size_t GetOffset() const;
+    // Number of all matched documents, not only of the ones on this page
+    size_t GetTotalCount() const;
+    // Points to the document right after this page
+    const BasicSearchCursor<Traits> &GetNextCursor() const;
+
+private:
+    friend class BasicSearchServer<Traits>;
+
+    using State = typename BasicSearchCursor<Traits>::State;
+
+    BasicSearchPage(std::shared_ptr<State> state, size_t offset, size_t size);
+
+    size_t offset_;
+    BasicSearchCursor<Traits> next_cursor_;
+};
+
+using SearchCursor = BasicSearchCursor<DefaultIndexTraits>;
+using SearchPage = BasicSearchPage<DefaultIndexTraits>;
+
+// Instantiated in search_page.cpp for the traits of index_traits.h
+extern template class BasicSearchCursor<DefaultIndexTraits>;
+extern template class BasicSearchCursor<CompactIndexTraits>;
+extern template class BasicSearchCursor<WideIndexTraits>;
+extern template class BasicSearchPage<DefaultIndexTraits>;
+extern template class BasicSearchPage<CompactIndexTraits>;
+extern template class BasicSearchPage<WideIndexTraits>;
@@ -1,171 +1,695 @@
 #include "search_server.h"
 
+#include <atomic>
+#include <queue>
+
+#include "binary_io.h"
+
 using namespace std;
 
-SearchServer::SearchServer(const std::string &stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text)) // Invoke delegating constructor
+namespace
+{
+    const uint32_t SNAPSHOT_FORMAT_VERSION = 1;
+    // Words added or removed since the last rebuild of the front-coded dictionary that never trigger a rebuild
+    const size_t MIN_UNSORTED_WORD_COUNT = 1024;
+
+    // Entries a binary search or a descent of a balanced tree of `size` entries visits
+    size_t SearchSteps(size_t size)
+    {
+        size_t steps = 1;
+        for (; size > 1; size /= 2)
+        {
+            ++steps;
+        }
+        return steps;
+    }
+
+    // Ids of up to 32 bits keep the 4 bytes of the snapshot format, wider ones take 8
+    template <typename DocumentId>
+    void PutDocumentId(ByteWriter &writer, DocumentId document_id)
+    {
+        if constexpr (sizeof(DocumentId) > sizeof(uint32_t))
+        {
+            writer.PutU64(static_cast<uint64_t>(document_id));
+        }
+        else
+        {
+            writer.PutU32(static_cast<uint32_t>(document_id));
+        }
+    }
+
+    template <typename DocumentId>
+    DocumentId GetDocumentId(ByteReader &reader)
+    {
+        if constexpr (sizeof(DocumentId) > sizeof(uint32_t))
+        {
+            return static_cast<DocumentId>(reader.GetU64());
+        }
+        else
+        {
+            return static_cast<DocumentId>(reader.GetU32());
+        }
+    }
+}
+
+uint64_t GenerateSearchServerId()
+{
+    static atomic<uint64_t> next_id{1};
+    return next_id.fetch_add(1, memory_order_relaxed);
+}
+
+template <typename Traits>
+BasicSearchServer<Traits>::BasicSearchServer(const std::string &stop_words_text)
+    : BasicSearchServer(SplitIntoWords(stop_words_text)) // Invoke delegating constructor
 // from string container
 {
 }
 
-SearchServer::SearchServer(std::string_view stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text))
+template <typename Traits>
+BasicSearchServer<Traits>::BasicSearchServer(std::string_view stop_words_text)
+    : BasicSearchServer(SplitIntoWords(stop_words_text))
 {
 }
 
-void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+template <typename Traits>
+void BasicSearchServer<Traits>::AddDocument(DocumentId document_id, std::string_view document, DocumentStatus status,
                                const std::vector<int> &ratings)
 {
-    if ((document_id < 0) || (documents_.count(document_id) > 0))
+    if (IsNegative(document_id) || (documents_.count(document_id) > 0))
     {
         throw std::invalid_argument("Invalid document_id"s);
     }
     const auto words = SplitIntoWordsNoStop(document);
-    const double inv_word_count = 1.0 / words.size();
-    std::set<std::string, std::less<>> document_words;
+    if (memory_budget_ != 0)
+    {
+        CheckMemoryBudget(EstimateDocumentMemory(words));
+    }
 
-    for (const auto &word : words)
+    const Score inv_word_count = Score(1) / words.size();
+    DocumentWords document_words(CountingAllocator<WordFreq>(&memory_->documents));
+    document_words.reserve(words.size());
+    for (std::string_view word : words)
     {
-        string word_str(word);
-        document_words.insert(word_str);
+        document_words.push_back({AcquireTerm(word), inv_word_count});
+    }
+
+    MergeRepeatedWords(document_words);
 
-        word_to_document_freqs_[static_cast<string_view>(*document_words.find(word_str))][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][static_cast<string_view>(*document_words.find(word_str))] += inv_word_count;
+    for (const auto [term_id, term_freq] : document_words)
+    {
+        Term &term = terms_[term_id];
+        GetMutablePostings(term).emplace(document_id, Posting{term_freq, static_cast<Score>(term_freq * term.inverse_document_freq)});
     }
 
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, std::move(document_words)});
+    auto stored_words = std::allocate_shared<const DocumentWords>(CountingAllocator<DocumentWords>(&memory_->documents),
+                                                                  std::move(document_words));
+    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, stored_words});
     document_ids_.emplace(document_id);
+    UpdateImpacts(*stored_words);
+    ++generation_;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::AddDocuments(const std::vector<NewDocument> &documents)
+{
+    AddDocuments(std::execution::seq, documents);
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::AddDocuments(std::execution::sequenced_policy seq_police, const std::vector<NewDocument> &documents)
+{
+    for (size_t begin = 0; begin < documents.size(); begin += ADD_BATCH_SIZE)
+    {
+        const size_t end = min(documents.size(), begin + ADD_BATCH_SIZE);
+        AddDocumentBatch(seq_police, documents.begin() + begin, documents.begin() + end);
+    }
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::AddDocuments(std::execution::parallel_policy par_police, const std::vector<NewDocument> &documents)
+{
+    for (size_t begin = 0; begin < documents.size(); begin += ADD_BATCH_SIZE)
+    {
+        const size_t end = min(documents.size(), begin + ADD_BATCH_SIZE);
+        AddDocumentBatch(par_police, documents.begin() + begin, documents.begin() + end);
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const
+template <typename Traits>
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindTopDocuments(std::string_view raw_query) const
 {
     return FindTopDocuments(std::execution::seq, raw_query);
 }
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const
+template <typename Traits>
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const
 {
     return FindTopDocuments(std::execution::seq, raw_query, status);
 }
 
-int SearchServer::GetDocumentCount() const
+template <typename Traits>
+typename BasicSearchServer<Traits>::SearchResult BasicSearchServer<Traits>::FindTopDocumentsWithin(const SearchBudget &budget, std::string_view raw_query) const
+{
+    return FindTopDocumentsWithin(budget, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename Traits>
+typename BasicSearchServer<Traits>::SearchResult BasicSearchServer<Traits>::FindTopDocumentsWithin(const SearchBudget &budget, std::string_view raw_query, DocumentStatus status) const
+{
+    return FindTopDocumentsWithin(budget, raw_query,
+                                  [status](DocumentId, DocumentStatus document_status, int)
+                                  {
+                                      return document_status == status;
+                                  });
+}
+
+template <typename Traits>
+std::future<typename BasicSearchServer<Traits>::SearchResult> BasicSearchServer<Traits>::FindTopDocumentsAsync(SearchBudget budget, std::string raw_query) const
+{
+    return FindTopDocumentsAsync(std::move(budget), std::move(raw_query), DocumentStatus::ACTUAL);
+}
+
+template <typename Traits>
+std::future<typename BasicSearchServer<Traits>::SearchResult> BasicSearchServer<Traits>::FindTopDocumentsAsync(SearchBudget budget, std::string raw_query, DocumentStatus status) const
+{
+    return FindTopDocumentsAsync(std::move(budget), std::move(raw_query),
+                                 [status](DocumentId, DocumentStatus document_status, int)
+                                 {
+                                     return document_status == status;
+                                 });
+}
+
+template <typename Traits>
+typename BasicSearchServer<Traits>::PreparedQuery BasicSearchServer<Traits>::PrepareQuery(std::string_view raw_query) const
+{
+    QueryArenaScope arena;
+    const auto query = ParseQuery(raw_query, true, arena.GetResource());
+
+    PreparedQuery result;
+    result.plus_words_.assign(query.plus_words.begin(), query.plus_words.end());
+    result.minus_words_.assign(query.minus_words.begin(), query.minus_words.end());
+    result.plus_prefixes_.assign(query.plus_prefixes.begin(), query.plus_prefixes.end());
+    result.minus_prefixes_.assign(query.minus_prefixes.begin(), query.minus_prefixes.end());
+    RefreshQuery(result);
+    return result;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::RefreshQuery(PreparedQuery &query) const
+{
+    if (query.IsResolvedFor(*this))
+    {
+        return;
+    }
+    query.terms_ = ResolveQueryWords(query.plus_words_, query.minus_words_, query.plus_prefixes_, query.minus_prefixes_,
+                                     std::pmr::get_default_resource());
+    query.search_server_id_ = instance_id_;
+    query.generation_ = generation_;
+}
+
+template <typename Traits>
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindTopDocuments(const PreparedQuery &query) const
+{
+    return FindTopDocuments(query, DocumentStatus::ACTUAL);
+}
+
+template <typename Traits>
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindTopDocuments(const PreparedQuery &query, DocumentStatus status) const
+{
+    return FindTopDocuments(std::execution::seq, query,
+                            [status](DocumentId, DocumentStatus document_status, int)
+                            {
+                                return document_status == status;
+                            });
+}
+
+template <typename Traits>
+int BasicSearchServer<Traits>::GetDocumentCount() const
 {
     return documents_.size();
 }
 
-const std::map<std::string_view, double> &SearchServer::GetWordFrequencies(int document_id) const
+template <typename Traits>
+uint64_t BasicSearchServer<Traits>::GetGeneration() const
 {
+    return generation_;
+}
+
+template <typename Traits>
+uint64_t BasicSearchServer<Traits>::GetInstanceId() const
+{
+    return instance_id_;
+}
 
-    auto it = document_to_word_freqs_.find(document_id);
-    if (it != document_to_word_freqs_.end())
+template <typename Traits>
+typename BasicSearchServer<Traits>::WordFrequencies BasicSearchServer<Traits>::GetWordFrequencies(DocumentId document_id) const
+{
+    WordFrequencies result;
+    auto it = documents_.find(document_id);
+    if (it != documents_.end())
     {
-        return it->second;
+        for (const auto [term_id, term_freq] : *it->second.words)
+        {
+            result.emplace(terms_[term_id].word, term_freq);
+        }
+    }
+    return result;
+}
+
+template <typename Traits>
+MemoryStats BasicSearchServer<Traits>::GetMemoryStats() const
+{
+    MemoryStats stats;
+    stats.stop_words = memory_->stop_words.bytes.load();
+    stats.terms = memory_->terms.bytes.load();
+    stats.dictionary = memory_->dictionary.bytes.load();
+    stats.documents = memory_->documents.bytes.load();
+    stats.document_ids = memory_->document_ids.bytes.load();
+    stats.fuzzy = memory_->fuzzy.bytes.load();
+    return stats;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::SetMemoryBudget(size_t bytes, MemoryBudgetPolicy policy)
+{
+    memory_budget_ = bytes;
+    memory_budget_policy_ = policy;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::ResetMemoryBudget()
+{
+    memory_budget_ = 0;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::Compact()
+{
+    // Live terms keep their order, so the forward indexes stay sorted after their ids are remapped
+    std::vector<TermId> new_term_ids(terms_.size());
+    decltype(terms_) terms(terms_.get_allocator());
+    for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+    {
+        Term &term = terms_[term_id];
+        if (term.word.empty())
+        {
+            continue;
+        }
+        if constexpr (std::is_same_v<typename Traits::Postings, FlatPostings>)
+        {
+            // A list shared with a clone is left as it is, a copy would only add memory
+            if (term.postings.use_count() == 1)
+            {
+                term.postings->shrink_to_fit();
+            }
+        }
+        new_term_ids[term_id] = static_cast<TermId>(terms.size());
+        terms.push_back(std::move(term));
+    }
+    const bool ids_changed = terms.size() < terms_.size();
+    terms_ = std::move(terms);
+    free_term_ids_.clear();
+    free_term_ids_.shrink_to_fit();
+
+    // The words have moved, so has every key pointing into them
+    word_to_term_id_.clear();
+    for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+    {
+        word_to_term_id_.emplace(terms_[term_id].word, term_id);
     }
-    static std::map<std::string_view, double> empty;
-    return empty;
+    if (ids_changed)
+    {
+        for (auto &[document_id, document_data] : documents_)
+        {
+            // Forward indexes may be shared with clones, so they are replaced rather than changed
+            DocumentWords words(document_data.words->begin(), document_data.words->end(),
+                                CountingAllocator<WordFreq>(&memory_->documents));
+            for (WordFreq &word_freq : words)
+            {
+                word_freq.term_id = new_term_ids[word_freq.term_id];
+            }
+            document_data.words = std::allocate_shared<const DocumentWords>(CountingAllocator<DocumentWords>(&memory_->documents),
+                                                                            std::move(words));
+        }
+    }
+    if (sorted_words_)
+    {
+        RebuildSortedWords();
+    }
+    else
+    {
+        recent_words_.clear();
+    }
+    if (fuzzy_index_)
+    {
+        const FuzzyOptions options = fuzzy_index_->GetOptions();
+        EnableFuzzySearch(options);
+    }
+    ++generation_;
 }
 
-std::set<int>::iterator SearchServer::begin() const
+template <typename Traits>
+void BasicSearchServer<Traits>::SaveSnapshot(std::string &out) const
+{
+    ByteWriter writer(out);
+    writer.PutU32(SNAPSHOT_FORMAT_VERSION);
+    writer.PutU8(static_cast<uint8_t>(scoring_mode_));
+    writer.PutDouble(impact_tolerance_);
+
+    writer.PutU32(static_cast<uint32_t>(stop_words_->size()));
+    for (const auto &word : *stop_words_)
+    {
+        writer.PutString(word);
+    }
+
+    // Free slots are skipped and live words are renumbered in the same order, so forward indexes stay sorted
+    vector<TermId> saved_ids(terms_.size());
+    TermId saved_count = 0;
+    for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+    {
+        if (!terms_[term_id].word.empty())
+        {
+            saved_ids[term_id] = saved_count++;
+        }
+    }
+    writer.PutU32(saved_count);
+    for (const Term &term : terms_)
+    {
+        if (!term.word.empty())
+        {
+            writer.PutString(term.word);
+        }
+    }
+
+    writer.PutU32(static_cast<uint32_t>(documents_.size()));
+    for (const auto &[document_id, document_data] : documents_)
+    {
+        PutDocumentId(writer, document_id);
+        writer.PutI32(document_data.rating);
+        writer.PutU8(static_cast<uint8_t>(document_data.status));
+        writer.PutU32(static_cast<uint32_t>(document_data.words->size()));
+        for (const auto [term_id, term_freq] : *document_data.words)
+        {
+            writer.PutU32(saved_ids[term_id]);
+            writer.PutDouble(term_freq);
+        }
+    }
+}
+
+template <typename Traits>
+BasicSearchServer<Traits> BasicSearchServer<Traits>::LoadSnapshot(std::string_view snapshot)
+{
+    ByteReader reader(snapshot);
+    if (reader.GetU32() != SNAPSHOT_FORMAT_VERSION)
+    {
+        throw invalid_argument("Unsupported snapshot format"s);
+    }
+    const uint8_t scoring_mode = reader.GetU8();
+    if (scoring_mode > static_cast<uint8_t>(ScoringMode::IMPACT))
+    {
+        throw invalid_argument("Unknown scoring mode "s + to_string(scoring_mode));
+    }
+    const double impact_tolerance = reader.GetDouble();
+
+    // A string is at least its 4-byte length
+    vector<string_view> stop_words(reader.GetCount(4));
+    for (string_view &word : stop_words)
+    {
+        word = reader.GetString();
+    }
+    BasicSearchServer search_server(stop_words);
+
+    const uint32_t term_count = reader.GetCount(4);
+    for (TermId term_id = 0; term_id < term_count; ++term_id)
+    {
+        const string_view word = reader.GetString();
+        if (word.empty() || !IsValidWord(word) || search_server.AcquireTerm(word) != term_id)
+        {
+            throw invalid_argument("Invalid word in snapshot"s);
+        }
+    }
+
+    vector<NewPosting> postings;
+    // Id, rating, status and the number of words
+    const uint32_t document_count = reader.GetCount(sizeof(DocumentId) + sizeof(int32_t) + 1 + sizeof(uint32_t));
+    for (uint32_t i = 0; i < document_count; ++i)
+    {
+        const DocumentId document_id = GetDocumentId<DocumentId>(reader);
+        const int rating = reader.GetI32();
+        const uint8_t status = reader.GetU8();
+        if (IsNegative(document_id) || status > static_cast<uint8_t>(DocumentStatus::REMOVED) ||
+            search_server.documents_.count(document_id) > 0)
+        {
+            throw invalid_argument("Invalid document in snapshot"s);
+        }
+
+        DocumentWords words(CountingAllocator<WordFreq>(&search_server.memory_->documents));
+        words.resize(reader.GetCount(sizeof(uint32_t) + sizeof(double)));
+        for (WordFreq &word : words)
+        {
+            word.term_id = reader.GetU32();
+            word.term_freq = reader.GetDouble();
+            if (word.term_id >= term_count || (&word != words.data() && (&word - 1)->term_id >= word.term_id))
+            {
+                throw invalid_argument("Invalid document in snapshot"s);
+            }
+            postings.push_back({word.term_id, document_id, word.term_freq});
+        }
+        auto stored_words = std::allocate_shared<const DocumentWords>(CountingAllocator<DocumentWords>(&search_server.memory_->documents),
+                                                                      std::move(words));
+        search_server.documents_.emplace(document_id, DocumentData{rating, static_cast<DocumentStatus>(status), std::move(stored_words)});
+        search_server.document_ids_.emplace(document_id);
+    }
+    reader.ExpectEnd();
+
+    search_server.InsertPostings(std::execution::par, postings);
+    for (TermId term_id = 0; term_id < term_count; ++term_id)
+    {
+        search_server.ReleaseTermIfUnused(term_id);
+    }
+    search_server.SetScoringMode(static_cast<ScoringMode>(scoring_mode), impact_tolerance);
+    return search_server;
+}
+
+template <typename Traits>
+typename BasicSearchServer<Traits>::DocumentIds::const_iterator BasicSearchServer<Traits>::begin() const
 {
     return document_ids_.begin();
 }
 
-std::set<int>::iterator SearchServer::end() const
+template <typename Traits>
+typename BasicSearchServer<Traits>::DocumentIds::const_iterator BasicSearchServer<Traits>::end() const
 {
     return document_ids_.end();
 }
 
-void SearchServer::RemoveDocument(int document_id)
+template <typename Traits>
+void BasicSearchServer<Traits>::RemoveDocument(DocumentId document_id)
 {
     if (!document_ids_.count(document_id))
     {
         return;
     }
 
-    auto &words_for_erase = document_to_word_freqs_.at(document_id);
-    for (auto &[word, freq] : words_for_erase)
+    const auto document = documents_.extract(document_id);
+    const DocumentWords &words = *document.mapped().words;
+    for (const auto [term_id, _] : words)
     {
-        word_to_document_freqs_.at(word).erase(document_id);
+        GetMutablePostings(terms_[term_id]).erase(document_id);
     }
-
     document_ids_.erase(document_id);
-    documents_.erase(document_id);
-    document_to_word_freqs_.erase(document_id);
+
+    UpdateImpacts(words);
+    for (const auto [term_id, _] : words)
+    {
+        ReleaseTermIfUnused(term_id);
+    }
+    ++generation_;
 }
 
-void SearchServer::RemoveDocument(std::execution::sequenced_policy seq_police, int document_id)
+template <typename Traits>
+void BasicSearchServer<Traits>::RemoveDocument(std::execution::sequenced_policy, DocumentId document_id)
 {
     RemoveDocument(document_id);
 }
 
-void SearchServer::RemoveDocument(std::execution::parallel_policy par_police, int document_id)
+template <typename Traits>
+void BasicSearchServer<Traits>::RemoveDocument(std::execution::parallel_policy par_police, DocumentId document_id)
 {
     if (!document_ids_.count(document_id))
     {
         return;
     }
-    auto &words_for_erase = document_to_word_freqs_.at(document_id);
-
-    std::vector<std::string_view> words;
-    words.reserve(words_for_erase.size());
-    std::transform(par_police, words_for_erase.begin(), words_for_erase.end(), words.begin(), [](const auto &word)
-                   { return word.first; });
+    const auto document = documents_.extract(document_id);
+    const DocumentWords &words = *document.mapped().words;
 
+    // Every word has its own posting list, the dictionary is changed sequentially afterwards
     std::for_each(par_police, words.begin(), words.end(),
-                  [&](const auto &word)
+                  [&](const WordFreq &word)
                   {
-                      word_to_document_freqs_.at(word).erase(document_id);
+                      GetMutablePostings(terms_[word.term_id]).erase(document_id);
                   });
-
     document_ids_.erase(document_id);
-    documents_.erase(document_id);
-    document_to_word_freqs_.erase(document_id);
+
+    UpdateImpacts(words);
+    for (const auto [term_id, _] : words)
+    {
+        ReleaseTermIfUnused(term_id);
+    }
+    ++generation_;
 }
 
-SearchServer::MatchResult SearchServer::MatchDocument(std::string_view raw_query, int document_id) const
+template <typename Traits>
+void BasicSearchServer<Traits>::RemoveDocument(AutoExecutionPolicy, DocumentId document_id)
+{
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end())
+    {
+        return;
+    }
+    // The document is erased from the posting list of each of its words, a descent of the list
+    const DocumentWords &words = *document->second.words;
+    size_t work = 0;
+    for (const auto [term_id, _] : words)
+    {
+        work += SearchSteps(terms_[term_id].postings->size());
+    }
+    if (IsParallelWorthwhile(work, words.size()))
+    {
+        RemoveDocument(std::execution::par, document_id);
+    }
+    else
+    {
+        RemoveDocument(document_id);
+    }
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::RemoveDocuments(const std::vector<DocumentId> &document_ids)
+{
+    RemoveDocuments(std::execution::seq, document_ids);
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::RemoveDocuments(std::execution::sequenced_policy seq_police, const std::vector<DocumentId> &document_ids)
+{
+    for (size_t begin = 0; begin < document_ids.size(); begin += REMOVE_BATCH_SIZE)
+    {
+        const size_t end = min(document_ids.size(), begin + REMOVE_BATCH_SIZE);
+        RemoveDocumentBatch(seq_police, document_ids.begin() + begin, document_ids.begin() + end);
+    }
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::RemoveDocuments(std::execution::parallel_policy par_police, const std::vector<DocumentId> &document_ids)
+{
+    for (size_t begin = 0; begin < document_ids.size(); begin += REMOVE_BATCH_SIZE)
+    {
+        const size_t end = min(document_ids.size(), begin + REMOVE_BATCH_SIZE);
+        RemoveDocumentBatch(par_police, document_ids.begin() + begin, document_ids.begin() + end);
+    }
+}
+
+template <typename Traits>
+typename BasicSearchServer<Traits>::MatchResult BasicSearchServer<Traits>::MatchDocument(std::string_view raw_query, DocumentId document_id) const
 {
     return MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
-SearchServer::MatchResult SearchServer::MatchDocument(std::execution::sequenced_policy police,
-                                                      std::string_view raw_query, int document_id) const
+template <typename Traits>
+typename BasicSearchServer<Traits>::MatchResult BasicSearchServer<Traits>::MatchDocument(std::execution::sequenced_policy,
+                                                      std::string_view raw_query, DocumentId document_id) const
 {
-    const auto query = ParseQuery(raw_query, true);
+    QueryArenaScope arena;
+    const auto query = ParseQuery(raw_query, true, arena.GetResource());
+
+    return MatchResolvedDocument(ResolveQuery(query, arena.GetResource()), document_id);
+}
 
-    const auto status_doc = documents_.at(document_id).status;
+template <typename Traits>
+typename BasicSearchServer<Traits>::MatchResult BasicSearchServer<Traits>::MatchDocument(AutoExecutionPolicy,
+                                                      std::string_view raw_query, DocumentId document_id) const
+{
+    QueryArenaScope arena;
+    const auto query = ParseQuery(raw_query, true, arena.GetResource());
 
-    for (std::string_view word : query.minus_words)
+    // Every query word is a binary search in the forward index of the document. An unknown document is
+    // left to the sequential version, which throws
+    const size_t word_count = query.plus_words.size() + query.minus_words.size() + query.plus_prefixes.size() +
+                              query.minus_prefixes.size();
+    const auto document = documents_.find(document_id);
+    const size_t work = document == documents_.end() ? 0 : word_count * SearchSteps(document->second.words->size());
+    if (IsParallelWorthwhile(work, word_count))
     {
-        if (word_to_document_freqs_.count(word) == 0)
-        {
-            continue;
-        }
-        auto &map = word_to_document_freqs_.at(word);
-        if (map.count(document_id))
+        return MatchDocument(std::execution::par, raw_query, document_id);
+    }
+    return MatchResolvedDocument(ResolveQuery(query, arena.GetResource()), document_id);
+}
+
+template <typename Traits>
+typename BasicSearchServer<Traits>::MatchResult BasicSearchServer<Traits>::MatchDocument(const PreparedQuery &query, DocumentId document_id) const
+{
+    if (query.IsResolvedFor(*this))
+    {
+        return MatchResolvedDocument(query.terms_, document_id);
+    }
+    QueryArenaScope arena;
+    return MatchResolvedDocument(ResolveQueryWords(query.plus_words_, query.minus_words_, query.plus_prefixes_,
+                                                   query.minus_prefixes_, arena.GetResource()),
+                                 document_id);
+}
+
+template <typename Traits>
+std::future<typename BasicSearchServer<Traits>::OwningMatchResult> BasicSearchServer<Traits>::MatchDocumentAsync(SearchBudget budget, std::string raw_query, DocumentId document_id) const
+{
+    return SearchTaskPool::GetShared().Submit([this, budget = std::move(budget), raw_query = std::move(raw_query), document_id]
+                                              {
+                                                  // Matching a single document is cheap, so the budget is checked only before it
+                                                  if (budget.IsExhausted())
+                                                  {
+                                                      throw BudgetExhausted();
+                                                  }
+                                                  const auto [words, status] = MatchDocument(raw_query, document_id);
+                                                  return OwningMatchResult{{words.begin(), words.end()}, status};
+                                              });
+}
+
+template <typename Traits>
+typename BasicSearchServer<Traits>::MatchResult BasicSearchServer<Traits>::MatchResolvedDocument(const ResolvedQuery &query, DocumentId document_id) const
+{
+    const auto &doc_data = documents_.at(document_id);
+    const auto status_doc = doc_data.status;
+
+    for (const QueryTerm &term : query.minus_terms)
+    {
+        if (HasTerm(doc_data, term.term_id))
         {
-            return {{}, status_doc};
+            return {std::vector<std::string_view>{}, status_doc};
         }
     }
     std::vector<std::string_view> matched_words;
-    for (std::string_view word : query.plus_words)
+    for (const QueryTerm &term : query.plus_terms)
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        if (HasTerm(doc_data, term.term_id))
         {
-            continue;
-        }
-        auto &map = word_to_document_freqs_.at(word);
-        if (map.count(document_id))
-        {
-            matched_words.push_back(word);
+            matched_words.push_back(term.word);
         }
     }
 
-    return {matched_words, documents_.at(document_id).status};
+    return {matched_words, status_doc};
 }
 
-SearchServer::MatchResult SearchServer::MatchDocument(const std::execution::parallel_policy &police,
-                                                      std::string_view raw_query, int document_id) const
+template <typename Traits>
+typename BasicSearchServer<Traits>::MatchResult BasicSearchServer<Traits>::MatchDocument(const std::execution::parallel_policy &,
+                                                      std::string_view raw_query, DocumentId document_id) const
 {
-    auto query = ParseQuery(raw_query, false);
+    QueryArenaScope arena;
+    auto query = ParseQuery(raw_query, false, arena.GetResource());
+    if (fuzzy_index_ || !query.plus_prefixes.empty() || !query.minus_prefixes.empty())
+    {
+        // Corrections and expanded prefixes come from the resolved terms
+        return MatchDocument(std::execution::seq, raw_query, document_id);
+    }
 
     std::sort(query.minus_words.begin(), query.minus_words.end());
     auto minus_words_end = std::unique(query.minus_words.begin(), query.minus_words.end());
@@ -176,7 +700,7 @@ SearchServer::MatchResult SearchServer::MatchDocument(const std::execution::para
     if (std::any_of(query.minus_words.begin(), minus_words_end,
                     [&](const auto &word)
                     {
-                        return doc_data.words.count(word);
+                        return HasWord(doc_data, word);
                     }))
     {
         return {matched_words, documents_.at(document_id).status};
@@ -189,7 +713,7 @@ SearchServer::MatchResult SearchServer::MatchDocument(const std::execution::para
     std::for_each(query.plus_words.begin(), plus_words_end,
                   [&](const auto &word)
                   {
-                      if (doc_data.words.count(word))
+                      if (HasWord(doc_data, word))
                       {
                           matched_words.push_back(word);
                       }
@@ -198,19 +722,94 @@ SearchServer::MatchResult SearchServer::MatchDocument(const std::execution::para
     return {matched_words, documents_.at(document_id).status};
 }
 
-bool SearchServer::IsStopWord(std::string_view word) const
+template <typename Traits>
+typename BasicSearchServer<Traits>::SearchPage BasicSearchServer<Traits>::FindTopDocuments(std::string_view raw_query, size_t offset, size_t limit) const
+{
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL, offset, limit);
+}
+
+template <typename Traits>
+typename BasicSearchServer<Traits>::SearchPage BasicSearchServer<Traits>::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t offset, size_t limit) const
 {
-    return stop_words_.count(word) > 0;
+    return FindTopDocuments(
+        raw_query,
+        [status](DocumentId, DocumentStatus document_status, int)
+        {
+            return document_status == status;
+        },
+        offset, limit);
 }
 
-bool SearchServer::IsValidWord(std::string_view word)
+template <typename Traits>
+typename BasicSearchServer<Traits>::SearchPage BasicSearchServer<Traits>::FindTopDocuments(const SearchCursor &cursor, size_t limit) const
+{
+    if (!cursor.state_)
+    {
+        throw invalid_argument("Cursor is empty"s);
+    }
+    auto state = cursor.state_;
+    if (state->search_server_id != 0 && state->search_server_id != instance_id_)
+    {
+        throw invalid_argument("Cursor belongs to another search server"s);
+    }
+    if (state->search_server_id != instance_id_ || state->generation != generation_)
+    {
+        // Pages made from the old state keep its documents, so the new scores go to a new state
+        auto scored_state = make_shared<typename SearchCursor::State>();
+        scored_state->query = state->query;
+        scored_state->document_predicate = state->document_predicate;
+        ScoreCursor(*scored_state);
+        state = move(scored_state);
+    }
+
+    auto &documents = state->documents;
+    const size_t offset = min(cursor.offset_, documents.size());
+    const size_t page_end = offset + min(limit, documents.size() - offset);
+    if (page_end > state->ranked)
+    {
+        // Unranked documents are never more relevant than the ranked ones, so earlier pages stay in place
+        partial_sort(documents.begin() + state->ranked, documents.begin() + page_end, documents.end(), IsMoreRelevant<Document>);
+        state->ranked = page_end;
+    }
+    return SearchPage(move(state), offset, page_end - offset);
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::ScoreCursor(typename SearchCursor::State &state) const
+{
+    RefreshQuery(state.query);
+    QueryArenaScope arena;
+    const auto matched_documents = FindAllDocuments(execution::seq, state.query.terms_, state.document_predicate, arena.GetResource());
+    state.documents.assign(matched_documents.begin(), matched_documents.end());
+    state.ranked = 0;
+    state.search_server_id = instance_id_;
+    state.generation = generation_;
+}
+
+template <typename Traits>
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::SelectTopDocuments(std::pmr::vector<Document> &documents)
+{
+    const size_t count = min(documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    partial_sort(documents.begin(), documents.begin() + count, documents.end(), IsMoreRelevant<Document>);
+    return {documents.begin(), documents.begin() + count};
+}
+
+template <typename Traits>
+bool BasicSearchServer<Traits>::IsStopWord(std::string_view word) const
+{
+    return stop_words_->count(word) > 0;
+}
+
+template <typename Traits>
+bool BasicSearchServer<Traits>::IsValidWord(std::string_view word)
 {
     // A valid word must not contain special characters
     return none_of(word.begin(), word.end(), [](char c)
                    { return c >= '\0' && c < ' '; });
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const
+template <typename Traits>
+std::vector<std::string_view> BasicSearchServer<Traits>::SplitIntoWordsNoStop(std::string_view text) const
 {
     std::vector<std::string_view> words;
     for (const std::string_view &word : SplitIntoWords(text))
@@ -227,8 +826,13 @@ std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_vie
     return words;
 }
 
-int SearchServer::ComputeAverageRating(const std::vector<int> &ratings)
+template <typename Traits>
+int BasicSearchServer<Traits>::ComputeAverageRating(const std::vector<int> &ratings)
 {
+    if (ratings.empty())
+    {
+        return 0;
+    }
     int rating_sum = 0;
     for (const int rating : ratings)
     {
@@ -237,7 +841,286 @@ int SearchServer::ComputeAverageRating(const std::vector<int> &ratings)
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view &word) const
+template <typename Traits>
+bool BasicSearchServer<Traits>::IsNegative(DocumentId document_id)
+{
+    if constexpr (std::is_signed_v<DocumentId>)
+    {
+        return document_id < 0;
+    }
+    return false;
+}
+
+template <typename Traits>
+size_t BasicSearchServer<Traits>::EstimateDocumentMemory(const std::vector<std::string_view> &words)
+{
+    // Red-black tree node: three pointers and a color, then the value. A shared_ptr control block: two counters
+    // and a vtable pointer. Every word is assumed to be new and its posting list unshared, so the estimate
+    // is an upper bound
+    const size_t tree_node_header = 4 * sizeof(void *);
+    const size_t control_block = 2 * sizeof(int) + sizeof(void *);
+    const size_t per_word = EstimateHeapChunkSize(tree_node_header + sizeof(typename PostingList::value_type)) // posting
+                            + sizeof(WordFreq)                                                       // forward index
+                            + sizeof(Term)                                                           // term pool slot
+                            + EstimateHeapChunkSize(control_block + sizeof(PostingList))
+                            + EstimateHeapChunkSize(tree_node_header + sizeof(pair<const string_view, TermId>));
+    size_t result = EstimateHeapChunkSize(tree_node_header + sizeof(pair<const DocumentId, DocumentData>)) +
+                    EstimateHeapChunkSize(tree_node_header + sizeof(DocumentId)) +
+                    EstimateHeapChunkSize(control_block + sizeof(DocumentWords)) +
+                    EstimateHeapChunkSize(words.size() * sizeof(WordFreq)) - words.size() * sizeof(WordFreq);
+    for (string_view word : words)
+    {
+        result += per_word;
+        if (word.size() > 15) // does not fit into the small string buffer of libstdc++
+        {
+            result += EstimateHeapChunkSize(word.size() + 1);
+        }
+    }
+    return result;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::CheckMemoryBudget(size_t required)
+{
+    if (memory_budget_ == 0)
+    {
+        return;
+    }
+    if (GetMemoryStats().Total() + required <= memory_budget_)
+    {
+        return;
+    }
+    if (memory_budget_policy_ == MemoryBudgetPolicy::COMPACT)
+    {
+        Compact();
+        if (GetMemoryStats().Total() + required <= memory_budget_)
+        {
+            return;
+        }
+    }
+    throw length_error("Memory budget is exceeded"s);
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::MergeRepeatedWords(DocumentWords &words)
+{
+    sort(words.begin(), words.end(),
+         [](const WordFreq &lhs, const WordFreq &rhs)
+         {
+             return lhs.term_id < rhs.term_id;
+         });
+    size_t unique_count = 0;
+    for (const WordFreq &word_freq : words)
+    {
+        if (unique_count > 0 && words[unique_count - 1].term_id == word_freq.term_id)
+        {
+            words[unique_count - 1].term_freq += word_freq.term_freq;
+        }
+        else
+        {
+            words[unique_count++] = word_freq;
+        }
+    }
+    words.resize(unique_count);
+    words.shrink_to_fit();
+}
+
+template <typename Traits>
+BasicSearchServer<Traits>::BasicSearchServer(const BasicSearchServer &other)
+    : memory_(other.memory_),
+      stop_words_(other.stop_words_),
+      terms_(other.terms_),
+      word_to_term_id_(CountingAdaptor<int>(&memory_->dictionary)),
+      free_term_ids_(other.free_term_ids_),
+      sorted_words_(other.sorted_words_),
+      recent_words_(CountingAdaptor<int>(&memory_->dictionary)),
+      stale_word_count_(other.stale_word_count_),
+      prefix_expansion_limit_(other.prefix_expansion_limit_),
+      documents_(other.documents_),
+      document_ids_(other.document_ids_),
+      scoring_mode_(other.scoring_mode_),
+      impact_tolerance_(other.impact_tolerance_),
+      impact_document_count_(other.impact_document_count_),
+      fuzzy_index_(other.fuzzy_index_),
+      generation_(other.generation_),
+      memory_budget_(other.memory_budget_),
+      memory_budget_policy_(other.memory_budget_policy_)
+{
+    for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+    {
+        if (!terms_[term_id].word.empty())
+        {
+            word_to_term_id_.emplace(terms_[term_id].word, term_id);
+        }
+    }
+    for (const auto [_, term_id] : other.recent_words_)
+    {
+        recent_words_.emplace(terms_[term_id].word, term_id);
+    }
+}
+
+template <typename Traits>
+BasicSearchServer<Traits>::BasicSearchServer(BasicSearchServer &&other)
+    : memory_(other.memory_), // moved-from containers may still hold allocations counted here
+      stop_words_(other.stop_words_),
+      terms_(std::move(other.terms_)), // deque elements keep their addresses, so do the dictionary keys
+      word_to_term_id_(std::move(other.word_to_term_id_)),
+      free_term_ids_(std::move(other.free_term_ids_)),
+      sorted_words_(std::move(other.sorted_words_)),
+      recent_words_(std::move(other.recent_words_)),
+      stale_word_count_(other.stale_word_count_),
+      prefix_expansion_limit_(other.prefix_expansion_limit_),
+      documents_(std::move(other.documents_)),
+      document_ids_(std::move(other.document_ids_)),
+      scoring_mode_(other.scoring_mode_),
+      impact_tolerance_(other.impact_tolerance_),
+      impact_document_count_(other.impact_document_count_),
+      fuzzy_index_(std::move(other.fuzzy_index_)),
+      generation_(other.generation_),
+      memory_budget_(other.memory_budget_),
+      memory_budget_policy_(other.memory_budget_policy_)
+{
+}
+
+template <typename Traits>
+BasicSearchServer<Traits> BasicSearchServer<Traits>::Clone() const
+{
+    return BasicSearchServer(*this);
+}
+
+template <typename Traits>
+typename BasicSearchServer<Traits>::PostingList &BasicSearchServer<Traits>::GetMutablePostings(Term &term)
+{
+    // Another version still uses the list, so it must stay as it is. A version that has just
+    // released the list leaves it to this one and at worst causes a needless copy.
+    // Only safe while no other clone is being changed, see the declaration
+    if (term.postings.use_count() > 1)
+    {
+        term.postings = std::allocate_shared<PostingList>(CountingAllocator<PostingList>(&memory_->terms), *term.postings);
+    }
+    return *term.postings;
+}
+
+template <typename Traits>
+FuzzyTermIndex &BasicSearchServer<Traits>::GetMutableFuzzyIndex()
+{
+    // Same single-writer rule as GetMutablePostings
+    if (fuzzy_index_.use_count() > 1)
+    {
+        fuzzy_index_ = std::allocate_shared<FuzzyTermIndex>(CountingAllocator<FuzzyTermIndex>(&memory_->fuzzy), *fuzzy_index_);
+    }
+    return *fuzzy_index_;
+}
+
+template <typename Traits>
+TermId BasicSearchServer<Traits>::AcquireTerm(std::string_view word)
+{
+    auto it = word_to_term_id_.find(word);
+    if (it != word_to_term_id_.end())
+    {
+        return it->second;
+    }
+
+    TermId term_id;
+    if (!free_term_ids_.empty())
+    {
+        term_id = free_term_ids_.back();
+        free_term_ids_.pop_back();
+        terms_[term_id].word.assign(word.begin(), word.end());
+    }
+    else
+    {
+        term_id = static_cast<TermId>(terms_.size());
+        terms_.push_back(Term{CountedString(word, CountingAllocator<char>(&memory_->terms)),
+                              std::allocate_shared<PostingList>(CountingAllocator<PostingList>(&memory_->terms),
+                                                                CountingAdaptor<int>(&memory_->terms))});
+    }
+    word_to_term_id_.emplace(terms_[term_id].word, term_id);
+    if (fuzzy_index_)
+    {
+        GetMutableFuzzyIndex().AddTerm(word, term_id);
+    }
+    if (sorted_words_)
+    {
+        recent_words_.emplace(terms_[term_id].word, term_id);
+        UpdateSortedWords();
+    }
+    return term_id;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::ReleaseTermIfUnused(TermId term_id)
+{
+    Term &term = terms_[term_id];
+    if (!term.postings->empty() || term.word.empty())
+    {
+        return;
+    }
+    word_to_term_id_.erase(term.word);
+    if (fuzzy_index_)
+    {
+        GetMutableFuzzyIndex().RemoveTerm(term.word, term_id);
+    }
+    if (sorted_words_ && recent_words_.erase(term.word) == 0)
+    {
+        ++stale_word_count_;
+    }
+    term.word.clear();
+    term.word.shrink_to_fit();
+    term.inverse_document_freq = 0.0;
+    term.impact_document_freq = 0;
+    free_term_ids_.push_back(term_id);
+    if (sorted_words_)
+    {
+        UpdateSortedWords();
+    }
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::UpdateSortedWords()
+{
+    if (recent_words_.size() + stale_word_count_ > max(MIN_UNSORTED_WORD_COUNT, sorted_words_->GetSize() / 8))
+    {
+        RebuildSortedWords();
+    }
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::RebuildSortedWords()
+{
+    auto sorted_words = allocate_shared<FrontCodedDictionary>(CountingAllocator<FrontCodedDictionary>(&memory_->dictionary),
+                                                              memory_->dictionary);
+    for (const auto &[word, term_id] : word_to_term_id_)
+    {
+        sorted_words->Append(word, term_id);
+    }
+    sorted_words->ShrinkToFit();
+    sorted_words_ = move(sorted_words);
+    recent_words_.clear();
+    stale_word_count_ = 0;
+}
+
+template <typename Traits>
+bool BasicSearchServer<Traits>::HasTerm(const DocumentData &document_data, TermId term_id)
+{
+    const DocumentWords &words = *document_data.words;
+    auto it = lower_bound(words.begin(), words.end(), term_id,
+                          [](const WordFreq &word_freq, TermId id)
+                          {
+                              return word_freq.term_id < id;
+                          });
+    return it != words.end() && it->term_id == term_id;
+}
+
+template <typename Traits>
+bool BasicSearchServer<Traits>::HasWord(const DocumentData &document_data, std::string_view word) const
+{
+    auto it = word_to_term_id_.find(word);
+    return it != word_to_term_id_.end() && HasTerm(document_data, it->second);
+}
+
+template <typename Traits>
+typename BasicSearchServer<Traits>::QueryWord BasicSearchServer<Traits>::ParseQueryWord(std::string_view &word) const
 {
     if (word.empty())
     {
@@ -250,51 +1133,349 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view &word) con
         is_minus = true;
         word = word.substr(1);
     }
+    bool is_prefix = false;
+    if (sorted_words_ && !word.empty() && word.back() == '*')
+    {
+        is_prefix = true;
+        word.remove_suffix(1);
+    }
     if (word.empty() || word[0] == '-' || !IsValidWord(word))
     {
         throw std::invalid_argument("Query word "s + std::string(word) + " is invalid");
     }
-    return {word, is_minus, IsStopWord(word)};
+    return {word, is_minus, !is_prefix && IsStopWord(word), is_prefix};
 }
 
-SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool needUnique) const
+template <typename Traits>
+typename BasicSearchServer<Traits>::Query BasicSearchServer<Traits>::ParseQuery(std::string_view text, bool needUnique, std::pmr::memory_resource *resource) const
 {
-    auto words = SplitIntoWords(text);
-    Query result;
+    const auto words = SplitIntoWords(text, resource);
+    Query result{std::pmr::vector<std::string_view>(resource), std::pmr::vector<std::string_view>(resource),
+                 std::pmr::vector<std::string_view>(resource), std::pmr::vector<std::string_view>(resource)};
     result.minus_words.reserve(words.size());
     result.plus_words.reserve(words.size());
 
     for (string_view word : words)
     {
         auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop)
+        if (query_word.is_stop)
         {
-            if (query_word.is_minus)
-            {
-                result.minus_words.push_back(std::move(query_word.data));
-            }
-            else
-            {
-                result.plus_words.push_back(std::move(query_word.data));
-            }
+            continue;
+        }
+        if (query_word.is_prefix)
+        {
+            (query_word.is_minus ? result.minus_prefixes : result.plus_prefixes).push_back(query_word.data);
+        }
+        else if (query_word.is_minus)
+        {
+            result.minus_words.push_back(std::move(query_word.data));
+        }
+        else
+        {
+            result.plus_words.push_back(std::move(query_word.data));
         }
     }
     if (needUnique)
     {
-        std::sort(result.plus_words.begin(), result.plus_words.end());
-        auto plus_words_end = std::unique(result.plus_words.begin(), result.plus_words.end());
-        result.plus_words.erase(plus_words_end, result.plus_words.end());
-
-        std::sort(result.minus_words.begin(), result.minus_words.end());
-        auto minus_words_end = std::unique(result.minus_words.begin(), result.minus_words.end());
-        result.minus_words.erase(minus_words_end, result.minus_words.end());
+        for (auto *query_words : {&result.plus_words, &result.minus_words, &result.plus_prefixes, &result.minus_prefixes})
+        {
+            std::sort(query_words->begin(), query_words->end());
+            query_words->erase(std::unique(query_words->begin(), query_words->end()), query_words->end());
+        }
     }
     return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const
+template <typename Traits>
+double BasicSearchServer<Traits>::ComputeInverseDocumentFreq(size_t document_freq) const
+{
+    return log(GetDocumentCount() * 1.0 / document_freq);
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::SetScoringMode(ScoringMode mode, double tolerance)
+{
+    if (!(tolerance >= 0.0))
+    {
+        throw invalid_argument("Tolerance must not be negative"s);
+    }
+    scoring_mode_ = mode;
+    impact_tolerance_ = tolerance;
+    if (mode == ScoringMode::IMPACT)
+    {
+        for (Term &term : terms_)
+        {
+            RefreshImpacts(term);
+        }
+        impact_document_count_ = GetDocumentCount();
+    }
+    ++generation_;
+}
+
+template <typename Traits>
+ScoringMode BasicSearchServer<Traits>::GetScoringMode() const
+{
+    return scoring_mode_;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::EnableFuzzySearch(const FuzzyOptions &options)
+{
+    auto fuzzy_index = allocate_shared<FuzzyTermIndex>(CountingAllocator<FuzzyTermIndex>(&memory_->fuzzy), options, memory_->fuzzy);
+    for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+    {
+        if (!terms_[term_id].word.empty())
+        {
+            fuzzy_index->AddTerm(terms_[term_id].word, term_id);
+        }
+    }
+    fuzzy_index_ = move(fuzzy_index);
+    ++generation_;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::DisableFuzzySearch()
+{
+    fuzzy_index_.reset();
+    ++generation_;
+}
+
+template <typename Traits>
+bool BasicSearchServer<Traits>::IsFuzzySearchEnabled() const
+{
+    return fuzzy_index_ != nullptr;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::EnablePrefixSearch(size_t expansion_limit)
+{
+    if (expansion_limit == 0)
+    {
+        throw invalid_argument("Prefix expansion limit must be positive"s);
+    }
+    prefix_expansion_limit_ = expansion_limit;
+    RebuildSortedWords();
+    ++generation_;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::DisablePrefixSearch()
+{
+    sorted_words_.reset();
+    recent_words_.clear();
+    stale_word_count_ = 0;
+    ++generation_;
+}
+
+template <typename Traits>
+bool BasicSearchServer<Traits>::IsPrefixSearchEnabled() const
 {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+    return sorted_words_ != nullptr;
+}
+
+template <typename Traits>
+bool BasicSearchServer<Traits>::IsImpactDrifted(size_t current, size_t reference) const
+{
+    return current != reference && abs(static_cast<double>(current) - static_cast<double>(reference)) > impact_tolerance_ * reference;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::RefreshImpacts(Term &term)
+{
+    const size_t document_freq = term.postings->size();
+    const double inverse_document_freq = document_freq == 0 ? 0.0 : ComputeInverseDocumentFreq(document_freq);
+    term.impact_document_freq = document_freq;
+    if (inverse_document_freq == term.inverse_document_freq)
+    {
+        return;
+    }
+    term.inverse_document_freq = inverse_document_freq;
+    for (auto &[_, posting] : GetMutablePostings(term))
+    {
+        posting.impact = posting.term_freq * inverse_document_freq;
+    }
+}
+
+template <typename Traits>
+bool BasicSearchServer<Traits>::RefreshImpactsIfCountDrifted()
+{
+    if (!IsImpactDrifted(GetDocumentCount(), impact_document_count_))
+    {
+        return false;
+    }
+    // The document count is a part of every IDF
+    for (Term &term : terms_)
+    {
+        RefreshImpacts(term);
+    }
+    impact_document_count_ = GetDocumentCount();
+    return true;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::RefreshImpactsIfDrifted(Term &term)
+{
+    if (IsImpactDrifted(term.postings->size(), term.impact_document_freq))
+    {
+        RefreshImpacts(term);
+    }
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::UpdateImpacts(const DocumentWords &words)
+{
+    if (scoring_mode_ != ScoringMode::IMPACT || RefreshImpactsIfCountDrifted())
+    {
+        return;
+    }
+    for (const auto [term_id, _] : words)
+    {
+        RefreshImpactsIfDrifted(terms_[term_id]);
+    }
+}
+
+template <typename Traits>
+typename BasicSearchServer<Traits>::ResolvedQuery BasicSearchServer<Traits>::ResolveQuery(const Query &query, std::pmr::memory_resource *resource) const
+{
+    return ResolveQueryWords(query.plus_words, query.minus_words, query.plus_prefixes, query.minus_prefixes, resource);
+}
+
+template <typename Traits>
+std::pmr::vector<std::string_view> BasicSearchServer<Traits>::ExpandPrefix(std::string_view prefix, std::pmr::memory_resource *resource) const
+{
+    // A prepared query may still have prefixes after they are disabled, they match nothing then
+    std::pmr::vector<std::string_view> words(resource);
+    if (!sorted_words_)
+    {
+        return words;
+    }
+    // Slots of the words in the front-coded dictionary may have been freed or reused since it was built
+    std::pmr::vector<std::string_view> sorted_words(resource);
+    sorted_words_->ForEachWithPrefix(prefix,
+                                     [&](std::string_view word, TermId term_id)
+                                     {
+                                         if (term_id < terms_.size() && terms_[term_id].word == word)
+                                         {
+                                             sorted_words.push_back(terms_[term_id].word);
+                                         }
+                                         return sorted_words.size() < prefix_expansion_limit_;
+                                     });
+    std::pmr::vector<std::string_view> recent_words(resource);
+    for (auto it = recent_words_.lower_bound(prefix);
+         it != recent_words_.end() && it->first.substr(0, prefix.size()) == prefix && recent_words.size() < prefix_expansion_limit_;
+         ++it)
+    {
+        recent_words.push_back(it->first);
+    }
+
+    words.reserve(sorted_words.size() + recent_words.size());
+    std::merge(sorted_words.begin(), sorted_words.end(), recent_words.begin(), recent_words.end(), back_inserter(words));
+    // A word removed and added again may be in both
+    words.erase(unique(words.begin(), words.end()), words.end());
+    if (words.size() > prefix_expansion_limit_)
+    {
+        words.resize(prefix_expansion_limit_);
+    }
+    return words;
+}
+
+template <typename Traits>
+void BasicSearchServer<Traits>::AppendCorrections(std::string_view word, std::pmr::vector<QueryTerm> &terms) const
+{
+    auto corrections = fuzzy_index_->FindCorrections(
+        word,
+        [this](TermId term_id) -> std::string_view
+        {
+            return terms_[term_id].word;
+        },
+        terms.get_allocator().resource());
+
+    const FuzzyOptions &options = fuzzy_index_->GetOptions();
+    const size_t count = min(corrections.size(), options.max_corrections);
+    partial_sort(corrections.begin(), corrections.begin() + count, corrections.end(),
+                 [this](const FuzzyTermIndex::Correction &lhs, const FuzzyTermIndex::Correction &rhs)
+                 {
+                     const size_t lhs_freq = terms_[lhs.term_id].postings->size();
+                     const size_t rhs_freq = terms_[rhs.term_id].postings->size();
+                     return tie(lhs.distance, rhs_freq, lhs.term_id) < tie(rhs.distance, lhs_freq, rhs.term_id);
+                 });
+    for (size_t i = 0; i < count; ++i)
+    {
+        const TermId term_id = corrections[i].term_id;
+        // Another word of the query may be this word or have the same correction
+        if (any_of(terms.begin(), terms.end(),
+                   [term_id](const QueryTerm &term)
+                   {
+                       return term.term_id == term_id;
+                   }))
+        {
+            continue;
+        }
+        const Term &term = terms_[term_id];
+        const double inverse_document_freq = scoring_mode_ == ScoringMode::IMPACT ? term.inverse_document_freq
+                                                                                   : ComputeInverseDocumentFreq(term.postings->size());
+        // Impacts hold the full IDF, so a correction is always scored from term_freq
+        terms.push_back({term.word, term.postings.get(), inverse_document_freq * pow(options.penalty, corrections[i].distance), term_id});
+    }
+}
+
+template <typename Traits>
+DocumentBitmap BasicSearchServer<Traits>::BuildExcludedDocuments(const ResolvedQuery &query, std::pmr::memory_resource *resource)
+{
+    size_t posting_count = 0;
+    for (const QueryTerm &term : query.minus_terms)
+    {
+        posting_count += term.postings->size();
+    }
+    std::pmr::vector<uint64_t> document_ids(resource);
+    document_ids.reserve(posting_count);
+    for (const QueryTerm &term : query.minus_terms)
+    {
+        for (const auto &[document_id, _] : *term.postings)
+        {
+            document_ids.push_back(document_id);
+        }
+    }
+    return DocumentBitmap(document_ids, resource);
+}
+
+template class BasicSearchServer<DefaultIndexTraits>;
+template class BasicSearchServer<CompactIndexTraits>;
+template class BasicSearchServer<WideIndexTraits>;
+
+vector<Document> MergeTopDocuments(const vector<vector<Document>> &results)
+{
+    // Every result is already sorted, so the heap holds the current head of each of them
+    struct Head
+    {
+        size_t result;
+        size_t position;
+    };
+    auto less_relevant = [&results](const Head &lhs, const Head &rhs)
+    {
+        return IsMoreRelevant<Document>(results[rhs.result][rhs.position], results[lhs.result][lhs.position]);
+    };
+    priority_queue<Head, vector<Head>, decltype(less_relevant)> heads(less_relevant);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        if (!results[i].empty())
+        {
+            heads.push({i, 0});
+        }
+    }
+
+    vector<Document> result;
+    while (!heads.empty() && result.size() < MAX_RESULT_DOCUMENT_COUNT)
+    {
+        const Head head = heads.top();
+        heads.pop();
+        result.push_back(results[head.result][head.position]);
+        if (head.position + 1 < results[head.result].size())
+        {
+            heads.push({head.result, head.position + 1});
+        }
+    }
+    return result;
 }
 
 void AddDocument(SearchServer &search_server, int document_id, string_view document,
@@ -2,81 +2,316 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <deque>
+#include <future>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "auto_policy.h"
 #include "concurrent_map.h"
 #include "document.h"
+#include "document_bitmap.h"
+#include "front_coded_dictionary.h"
+#include "fuzzy_term_index.h"
+#include "memory_stats.h"
+#include "prepared_query.h"
+#include "query_arena.h"
+#include "search_budget.h"
+#include "search_page.h"
+#include "search_task_pool.h"
 #include "string_processing.h"
 #include <execution>
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double EPSILON = 1e-6;
+// Documents removed at once by RemoveDocuments, bounds the memory of grouping their words
+const size_t REMOVE_BATCH_SIZE = 64 * 1024;
+// Documents added at once by AddDocuments
+const size_t ADD_BATCH_SIZE = 64 * 1024;
+const size_t DEFAULT_PREFIX_EXPANSION_LIMIT = 64;
 
-class SearchServer
+enum class ScoringMode
+{
+    EXACT,  // IDF is computed for every query from the current document counts
+    IMPACT, // postings keep term_freq * IDF, refreshed when the counts drift past a tolerance
+};
+
+// A document of AddDocuments, the text is only read during the call
+template <typename DocumentId>
+struct BasicNewDocument
+{
+    DocumentId id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+using NewDocument = BasicNewDocument<int>;
+
+// Id of a new server instance, unique within the process. A new server may take the address of a destroyed one,
+// so prepared queries and cursors remember this id rather than the address
+uint64_t GenerateSearchServerId();
+
+// Result order of FindTopDocuments: by relevance, then by rating
+template <typename DocumentType>
+bool IsMoreRelevant(const DocumentType &lhs, const DocumentType &rhs)
+{
+    return lhs.relevance > rhs.relevance || (std::abs(lhs.relevance - rhs.relevance) < EPSILON && lhs.rating > rhs.rating);
+}
+
+// Keeps the policy overloads from matching other calls, e.g. FindTopDocuments(raw_query, 0, 20)
+template <typename ExecutionPolicy>
+using EnableIfExecutionPolicy = std::enable_if_t<std::is_execution_policy_v<std::decay_t<ExecutionPolicy>> ||
+                                                     std::is_same_v<std::decay_t<ExecutionPolicy>, AutoExecutionPolicy>,
+                                                 bool>;
+
+// Search server over the index layout of Traits, see index_traits.h. BasicSearchServer is the one with DefaultIndexTraits,
+// the other layouts of index_traits.h are instantiated too
+template <typename Traits>
+class BasicSearchServer
 {
 
 public:
+    using DocumentId = typename Traits::DocumentId;
+    using Score = typename Traits::Score;
+    using Document = BasicDocument<DocumentId, Score>;
+    using NewDocument = BasicNewDocument<DocumentId>;
+    using SearchResult = BasicSearchResult<Document>;
+    using PreparedQuery = BasicPreparedQuery<Traits>;
+    using SearchCursor = BasicSearchCursor<Traits>;
+    using SearchPage = BasicSearchPage<Traits>;
+    using Posting = BasicPosting<Traits>;
+    using PostingList = BasicPostingList<Traits>;
+    using QueryTerm = BasicQueryTerm<Traits>;
+    using ResolvedQuery = BasicResolvedQuery<Traits>;
+
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer &stop_words);
-    explicit SearchServer(const std::string &stop_words_text);
-    explicit SearchServer(std::string_view stop_words_text);
+    explicit BasicSearchServer(const StringContainer &stop_words);
+    explicit BasicSearchServer(const std::string &stop_words_text);
+    explicit BasicSearchServer(std::string_view stop_words_text);
+
+    BasicSearchServer(BasicSearchServer &&other);
+    BasicSearchServer &operator=(const BasicSearchServer &) = delete;
 
-    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+    // Copy-on-write copy: the stop words, posting lists and forward indexes are shared with this server and are
+    // copied only when changed. Memory counters and so the memory budget are shared too.
+    // This server must not be changed while it is being cloned, and of the servers sharing structures only one
+    // may be changed at a time, see GetMutablePostings.
+    BasicSearchServer Clone() const;
+
+    // The rating of a document is the average of its ratings, 0 if there are none
+    void AddDocument(DocumentId document_id, std::string_view document, DocumentStatus status,
                      const std::vector<int> &ratings);
+    // Adds the documents in chunks of ADD_BATCH_SIZE. A chunk is checked as a whole before any of it is added.
+    // The parallel version splits the texts in parallel and fills the postings of different words in parallel
+    void AddDocuments(const std::vector<NewDocument> &documents);
+    void AddDocuments(std::execution::sequenced_policy seq_police, const std::vector<NewDocument> &documents);
+    void AddDocuments(std::execution::parallel_policy par_police, const std::vector<NewDocument> &documents);
 
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
-    template <class ExecutionPolicy>
+    template <class ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy> = true>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query) const;
 
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
-    template <class ExecutionPolicy>
+    template <class ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy> = true>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status) const;
 
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
-    template <class ExecutionPolicy, typename DocumentPredicate>
+    template <class ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy> = true>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
 
-    //------------------------------------------------------------------------------------------------------------
+    PreparedQuery PrepareQuery(std::string_view raw_query) const;
+    void RefreshQuery(PreparedQuery &query) const;
 
-    int GetDocumentCount() const;
+    std::vector<Document> FindTopDocuments(const PreparedQuery &query) const;
+    std::vector<Document> FindTopDocuments(const PreparedQuery &query, DocumentStatus status) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const PreparedQuery &query, DocumentPredicate document_predicate) const;
+    template <class ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy> = true>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const PreparedQuery &query, DocumentPredicate document_predicate) const;
+
+    // Page of the full ranking: only the first offset + limit documents are sorted.
+    // Continue with page.GetNextCursor() so the following pages are not scored again
+    SearchPage FindTopDocuments(std::string_view raw_query, size_t offset, size_t limit) const;
+    SearchPage FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t offset, size_t limit) const;
+    template <typename DocumentPredicate>
+    SearchPage FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t offset, size_t limit) const;
+    // Next `limit` documents from the cursor. The query of a cursor made before the index changed is scored again
+    SearchPage FindTopDocuments(const SearchCursor &cursor, size_t limit) const;
+
+    // Sequential search that stops scoring once the budget is exhausted and returns what it has found so far
+    SearchResult FindTopDocumentsWithin(const SearchBudget &budget, std::string_view raw_query) const;
+    SearchResult FindTopDocumentsWithin(const SearchBudget &budget, std::string_view raw_query, DocumentStatus status) const;
+    template <typename DocumentPredicate>
+    SearchResult FindTopDocumentsWithin(const SearchBudget &budget, std::string_view raw_query, DocumentPredicate document_predicate) const;
 
-    std::set<int>::iterator begin() const;
-    std::set<int>::iterator end() const;
+    // Run on the shared SearchTaskPool, so a burst of calls queues up instead of starting a thread each.
+    // The server must outlive the futures and must not be modified until they are ready
+    std::future<SearchResult> FindTopDocumentsAsync(SearchBudget budget, std::string raw_query) const;
+    std::future<SearchResult> FindTopDocumentsAsync(SearchBudget budget, std::string raw_query, DocumentStatus status) const;
+    template <typename DocumentPredicate>
+    std::future<SearchResult> FindTopDocumentsAsync(SearchBudget budget, std::string raw_query, DocumentPredicate document_predicate) const;
 
-    void RemoveDocument(int document_id);
-    void RemoveDocument(std::execution::sequenced_policy seq_police, int document_id);
-    void RemoveDocument(std::execution::parallel_policy par_police, int document_id);
+    //------------------------------------------------------------------------------------------------------------
+
+    int GetDocumentCount() const;
 
-    const std::map<std::string_view, double> &GetWordFrequencies(int document_id) const;
+    // Changes on every AddDocument/RemoveDocument, prepared queries are re-resolved after that
+    uint64_t GetGeneration() const;
+    // Unique for every constructed server, copies and moved-to servers included
+    uint64_t GetInstanceId() const;
+
+    using DocumentIds = CountedSet<DocumentId>;
+    typename DocumentIds::const_iterator begin() const;
+    typename DocumentIds::const_iterator end() const;
+
+    void RemoveDocument(DocumentId document_id);
+    void RemoveDocument(std::execution::sequenced_policy seq_police, DocumentId document_id);
+    void RemoveDocument(std::execution::parallel_policy par_police, DocumentId document_id);
+    // Parallel when erasing the document from the posting lists of its words visits enough postings
+    void RemoveDocument(AutoExecutionPolicy auto_police, DocumentId document_id);
+
+    // Removes the documents in chunks of REMOVE_BATCH_SIZE, unknown ids are ignored. Within a chunk the postings
+    // of every word are edited once, the parallel version edits different words in parallel
+    void RemoveDocuments(const std::vector<DocumentId> &document_ids);
+    void RemoveDocuments(std::execution::sequenced_policy seq_police, const std::vector<DocumentId> &document_ids);
+    void RemoveDocuments(std::execution::parallel_policy par_police, const std::vector<DocumentId> &document_ids);
+
+    // Built from the forward index on every call
+    using WordFrequencies = std::map<std::string_view, double>;
+    WordFrequencies GetWordFrequencies(DocumentId document_id) const;
+
+    MemoryStats GetMemoryStats() const;
+
+    // AddDocument checks its estimated footprint against the budget before changing anything
+    void SetMemoryBudget(size_t bytes, MemoryBudgetPolicy policy = MemoryBudgetPolicy::FAIL_FAST);
+    void ResetMemoryBudget();
+
+    // Rebuilds the term pool without the slots of removed words, renumbering the terms, and rewrites the forward
+    // indexes, flat posting lists, dictionaries and fuzzy index to their exact size. Words returned before it as
+    // string_view no longer point into the index; prepared queries and cursors made before it are resolved again
+    void Compact();
+
+    // Binary image of the index: stop words, words, documents with their term frequencies and the scoring mode.
+    // The memory budget is not saved. LoadSnapshot throws std::invalid_argument on malformed data
+    void SaveSnapshot(std::string &out) const;
+    static BasicSearchServer LoadSnapshot(std::string_view snapshot);
+
+    // In the impact mode the impacts of a word are recomputed when the document count or the number of
+    // documents with the word differs from the one they were computed with by more than `tolerance` times.
+    // An IDF is then off by at most about 2 * log(1 + tolerance). Switching to the mode computes all impacts.
+    void SetScoringMode(ScoringMode mode, double tolerance = 0.05);
+    ScoringMode GetScoringMode() const;
+
+    // Plus-words missing from the index are replaced with the closest words of the index, see FuzzyOptions.
+    // The deletion index is updated by every change, counted in MemoryStats::fuzzy and not saved in snapshots
+    void EnableFuzzySearch(const FuzzyOptions &options = FuzzyOptions());
+    void DisableFuzzySearch();
+    bool IsFuzzySearchEnabled() const;
+
+    // While enabled, a query word ending with '*' stands for the words of the index starting with the rest of it,
+    // e.g. "cat*" or "-cat*"; otherwise '*' is an ordinary character. A prefix takes at most `expansion_limit` words,
+    // the first ones in lexicographic order, each scored as a query word. Not saved in snapshots
+    void EnablePrefixSearch(size_t expansion_limit = DEFAULT_PREFIX_EXPANSION_LIMIT);
+    void DisablePrefixSearch();
+    bool IsPrefixSearchEnabled() const;
 
     using MatchResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
-    MatchResult MatchDocument(std::string_view raw_query, int document_id) const;
-    MatchResult MatchDocument(std::execution::sequenced_policy seq_police, std::string_view raw_query, int document_id) const;
-    MatchResult MatchDocument(const std::execution::parallel_policy &par_police, std::string_view raw_query, int document_id) const;
+    MatchResult MatchDocument(std::string_view raw_query, DocumentId document_id) const;
+    MatchResult MatchDocument(std::execution::sequenced_policy seq_police, std::string_view raw_query, DocumentId document_id) const;
+    MatchResult MatchDocument(const std::execution::parallel_policy &par_police, std::string_view raw_query, DocumentId document_id) const;
+    MatchResult MatchDocument(AutoExecutionPolicy auto_police, std::string_view raw_query, DocumentId document_id) const;
+    MatchResult MatchDocument(const PreparedQuery &query, DocumentId document_id) const;
+
+    // The query is owned by the task, so matched words are returned as copies.
+    // Throws BudgetExhausted through the future if the budget ran out before the task started
+    using OwningMatchResult = std::tuple<std::vector<std::string>, DocumentStatus>;
+    std::future<OwningMatchResult> MatchDocumentAsync(SearchBudget budget, std::string raw_query, DocumentId document_id) const;
 
 private:
+    friend class CompactSegment; // seals the index into flat arrays
+
+    using WordSet = CountedSet<CountedString, std::less<>>;
+
+    struct WordFreq
+    {
+        TermId term_id;
+        Score term_freq;
+    };
+    // Forward index of a document, sorted by term_id
+    using DocumentWords = std::vector<WordFreq, CountingAllocator<WordFreq>>;
+
     struct DocumentData
     {
         int rating;
         DocumentStatus status;
-        std::set<std::string, std::less<>> words;
+        std::shared_ptr<const DocumentWords> words; // shared between clones
+    };
+
+    // Every distinct word is stored once; a slot with an empty word is free for reuse
+    struct Term
+    {
+        CountedString word;
+        std::shared_ptr<PostingList> postings; // shared between clones, changed through GetMutablePostings
+        // Impact mode: IDF in the impacts of the postings and the document frequency it was computed with
+        double inverse_document_freq = 0.0;
+        size_t impact_document_freq = 0;
     };
 
-    const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_; // <word<doc_id,freq>>
-    std::map<int, DocumentData> documents_;
+    struct MemoryCounters
+    {
+        MemoryCounter stop_words;
+        MemoryCounter terms;
+        MemoryCounter dictionary;
+        MemoryCounter documents;
+        MemoryCounter document_ids;
+        MemoryCounter fuzzy;
+    };
+
+    // Allocators of the containers below point here, so it lives on the heap and survives moves.
+    // Clones share it, shared posting lists may be freed by any of them
+    std::shared_ptr<MemoryCounters> memory_;
+
+    std::shared_ptr<const WordSet> stop_words_;
+
+    std::deque<Term, CountingAdaptor<Term>> terms_;         // index is TermId, elements never move
+    CountedMap<std::string_view, TermId> word_to_term_id_;  // keys point into terms_
+    std::vector<TermId, CountingAllocator<TermId>> free_term_ids_;
 
-    std::set<int> document_ids_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
+    // Sorted words for prefix queries, kept only while they are enabled: all words at the last rebuild, shared
+    // between clones, and the words added since. Removed words stay in the front-coded dictionary until the next rebuild
+    std::shared_ptr<const FrontCodedDictionary> sorted_words_;
+    CountedMap<std::string_view, TermId> recent_words_; // keys point into terms_
+    size_t stale_word_count_ = 0;
+    size_t prefix_expansion_limit_ = DEFAULT_PREFIX_EXPANSION_LIMIT;
+
+    CountedMap<DocumentId, DocumentData> documents_;
+    DocumentIds document_ids_;
+
+    ScoringMode scoring_mode_ = ScoringMode::EXACT;
+    double impact_tolerance_ = 0.0;
+    int impact_document_count_ = 0; // document count of the last refresh of all impacts
+
+    std::shared_ptr<FuzzyTermIndex> fuzzy_index_; // shared between clones, changed through GetMutableFuzzyIndex
+
+    const uint64_t instance_id_ = GenerateSearchServerId();
+    uint64_t generation_ = 0;
+
+    size_t memory_budget_ = 0; // 0 - no budget
+    MemoryBudgetPolicy memory_budget_policy_ = MemoryBudgetPolicy::FAIL_FAST;
 
     //-------------------------------------------------------------------------------------
     bool IsStopWord(std::string_view word) const;
@@ -86,38 +321,140 @@ private:
     std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
 
     static int ComputeAverageRating(const std::vector<int> &ratings);
+    // Always false for unsigned ids
+    static bool IsNegative(DocumentId document_id);
+
+    template <typename StringContainer>
+    static WordSet MakeStopWords(const StringContainer &stop_words, MemoryCounter &counter);
+
+    // Used by Clone only, the dictionary is rebuilt to point into the words of the copy
+    BasicSearchServer(const BasicSearchServer &other);
+
+    TermId AcquireTerm(std::string_view word);
+    // Copy-on-write by use_count, which is safe only with a single writer among the clones sharing the structure:
+    // a clone that copies a shared list drops its reference while still reading it, so a second writer could see
+    // the count fall to 1 and change the list in place under that copy
+    PostingList &GetMutablePostings(Term &term);
+    FuzzyTermIndex &GetMutableFuzzyIndex();
+    void ReleaseTermIfUnused(TermId term_id);
+    // Rebuilds the front-coded dictionary once the words added or removed since the last rebuild are an eighth of it
+    void UpdateSortedWords();
+    void RebuildSortedWords();
+
+    static bool HasTerm(const DocumentData &document_data, TermId term_id);
+    bool HasWord(const DocumentData &document_data, std::string_view word) const;
+
+    static size_t EstimateDocumentMemory(const std::vector<std::string_view> &words);
+    void CheckMemoryBudget(size_t required);
+
+    // Sorts a forward index by term and merges the entries of repeated words
+    static void MergeRepeatedWords(DocumentWords &words);
 
     struct QueryWord
     {
         std::string_view data;
         bool is_minus;
         bool is_stop;
+        bool is_prefix;
     };
 
     QueryWord ParseQueryWord(std::string_view &text) const;
 
     struct Query
     {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        std::pmr::vector<std::string_view> plus_words;
+        std::pmr::vector<std::string_view> minus_words;
+        std::pmr::vector<std::string_view> plus_prefixes;
+        std::pmr::vector<std::string_view> minus_prefixes;
     };
 
-    Query ParseQuery(std::string_view text, bool needUnique = true) const;
+    Query ParseQuery(std::string_view text, bool needUnique = true,
+                     std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
+
+    double ComputeInverseDocumentFreq(size_t document_freq) const;
 
-    // Existence required
-    double ComputeWordInverseDocumentFreq(std::string_view word) const;
+    bool IsImpactDrifted(size_t current, size_t reference) const;
+    void RefreshImpacts(Term &term);
+    // Refreshes all impacts if the document count has drifted, returns whether it did
+    bool RefreshImpactsIfCountDrifted();
+    void RefreshImpactsIfDrifted(Term &term);
+    // Called after the postings of the words of a document have changed
+    void UpdateImpacts(const DocumentWords &words);
 
+    struct NewPosting
+    {
+        TermId term_id;
+        DocumentId document_id;
+        Score term_freq;
+    };
+
+    template <class ExecutionPolicy>
+    void AddDocumentBatch(ExecutionPolicy policy, typename std::vector<NewDocument>::const_iterator first, typename std::vector<NewDocument>::const_iterator last);
+    // The documents of the postings must be in documents_ already
+    template <class ExecutionPolicy>
+    void InsertPostings(ExecutionPolicy policy, std::vector<NewPosting> &postings);
+
+    template <class ExecutionPolicy>
+    void RemoveDocumentBatch(ExecutionPolicy policy, typename std::vector<DocumentId>::const_iterator first, typename std::vector<DocumentId>::const_iterator last);
+
+    template <typename Words>
+    std::pmr::vector<QueryTerm> ResolveTerms(const Words &words,
+                                             std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
+
+    // Also adds the corrections of unknown words when the fuzzy search is on
+    template <typename Words>
+    std::pmr::vector<QueryTerm> ResolvePlusTerms(const Words &words,
+                                                 std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
+    void AppendCorrections(std::string_view word, std::pmr::vector<QueryTerm> &terms) const;
+
+    // Words of the index with the prefix, at most prefix_expansion_limit_ of them in lexicographic order
+    std::pmr::vector<std::string_view> ExpandPrefix(std::string_view prefix, std::pmr::memory_resource *resource) const;
+    template <typename Words>
+    void AppendPrefixTerms(const Words &prefixes, std::pmr::vector<QueryTerm> &terms) const;
+
+    template <typename Words>
+    ResolvedQuery ResolveQueryWords(const Words &plus_words, const Words &minus_words, const Words &plus_prefixes,
+                                    const Words &minus_prefixes, std::pmr::memory_resource *resource) const;
+    ResolvedQuery ResolveQuery(const Query &query, std::pmr::memory_resource *resource) const;
+
+    // Documents with any of the minus-words, built before scoring so they are skipped while accumulating
+    static DocumentBitmap BuildExcludedDocuments(const ResolvedQuery &query, std::pmr::memory_resource *resource);
+
+    MatchResult MatchResolvedDocument(const ResolvedQuery &query, DocumentId document_id) const;
+
+    // Temporaries of the search live in `resource`, only the result is copied out
+    template <class ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopResolvedDocuments(ExecutionPolicy policy, const ResolvedQuery &query, DocumentPredicate document_predicate,
+                                                   std::pmr::memory_resource *resource) const;
+    // The plus terms are scored in parallel, one task per term, so the work is the sum of their postings
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query &query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopResolvedDocuments(AutoExecutionPolicy auto_police, const ResolvedQuery &query, DocumentPredicate document_predicate,
+                                                   std::pmr::memory_resource *resource) const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(std::execution::sequenced_policy seq_police, const Query &query, DocumentPredicate document_predicate) const;
+    std::pmr::vector<Document> FindAllDocuments(std::execution::sequenced_policy seq_police, const ResolvedQuery &query, DocumentPredicate document_predicate,
+                                                std::pmr::memory_resource *resource) const;
+
+    template <typename DocumentPredicate, typename Budget>
+    std::pmr::vector<Document> FindAllDocuments(std::execution::sequenced_policy seq_police, const ResolvedQuery &query, DocumentPredicate document_predicate,
+                                                const Budget &budget, bool &is_partial, std::pmr::memory_resource *resource) const;
+
+    static std::vector<Document> SelectTopDocuments(std::pmr::vector<Document> &documents);
+    void ScoreCursor(typename SearchCursor::State &state) const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(std::execution::parallel_policy par_police, const Query &query, DocumentPredicate document_predicate) const;
+    std::pmr::vector<Document> FindAllDocuments(std::execution::parallel_policy par_police, const ResolvedQuery &query, DocumentPredicate document_predicate,
+                                                std::pmr::memory_resource *resource) const;
 };
 //-------------------------------------------------------------------------------------
 
+using SearchServer = BasicSearchServer<DefaultIndexTraits>;
+
+// Instantiated in search_server.cpp for the traits of index_traits.h
+extern template class BasicSearchServer<DefaultIndexTraits>;
+extern template class BasicSearchServer<CompactIndexTraits>;
+extern template class BasicSearchServer<WideIndexTraits>;
+
 void AddDocument(SearchServer &search_server, int document_id, std::string_view document,
                  DocumentStatus status, const std::vector<int> &ratings);
 
@@ -127,97 +464,473 @@ void MatchDocuments(const SearchServer &search_server, std::string_view query);
 
 void RemoveDuplicates(SearchServer &search_server);
 
+// Top MAX_RESULT_DOCUMENT_COUNT of several results, each sorted by IsMoreRelevant
+std::vector<Document> MergeTopDocuments(const std::vector<std::vector<Document>> &results);
+
+template <typename Traits>
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer &stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words)) // Extract non-empty stop words
+BasicSearchServer<Traits>::BasicSearchServer(const StringContainer &stop_words)
+    : memory_(std::make_shared<MemoryCounters>()),
+      stop_words_(std::make_shared<const WordSet>(MakeStopWords(stop_words, memory_->stop_words))), // Extract non-empty stop words
+      terms_(CountingAdaptor<Term>(&memory_->terms)),
+      word_to_term_id_(CountingAdaptor<int>(&memory_->dictionary)),
+      free_term_ids_(CountingAllocator<TermId>(&memory_->terms)),
+      recent_words_(CountingAdaptor<int>(&memory_->dictionary)),
+      documents_(CountingAdaptor<int>(&memory_->documents)),
+      document_ids_(CountingAdaptor<int>(&memory_->document_ids))
 {
     using namespace std::string_literals;
-    if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord))
+    if (!all_of(stop_words_->begin(), stop_words_->end(), IsValidWord))
     {
         throw std::invalid_argument("Some of stop words are invalid"s);
     }
 }
 
-template <class ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query) const
+template <typename Traits>
+template <typename StringContainer>
+typename BasicSearchServer<Traits>::WordSet BasicSearchServer<Traits>::MakeStopWords(const StringContainer &stop_words, MemoryCounter &counter)
+{
+    const auto unique_words = MakeUniqueNonEmptyStrings(stop_words);
+    return WordSet(unique_words.begin(), unique_words.end(), CountingAdaptor<CountedString>(&counter));
+}
+
+template <typename Traits>
+template <class ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy>>
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query) const
 {
     return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
-template <class ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status) const
+template <typename Traits>
+template <class ExecutionPolicy, EnableIfExecutionPolicy<ExecutionPolicy>>
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentStatus status) const
 {
     return FindTopDocuments(policy, raw_query,
-                            [status](int document_id, DocumentStatus document_status, int rating)
+                            [status](DocumentId, DocumentStatus document_status, int)
                             {
                                 return document_status == status;
                             });
 }
 
+template <typename Traits>
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const
 {
     return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
 }
 
-template <class ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate) const
+template <typename Traits>
+template <class ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy>>
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query, DocumentPredicate document_predicate) const
 {
-    const auto query = ParseQuery(raw_query, true);
+    QueryArenaScope arena;
+    const auto query = ParseQuery(raw_query, true, arena.GetResource());
 
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+    return FindTopResolvedDocuments(policy, ResolveQuery(query, arena.GetResource()), document_predicate, arena.GetResource());
+}
 
-    sort(matched_documents.begin(), matched_documents.end(),
-         [](const Document &lhs, const Document &rhs)
-         {
-             return lhs.relevance > rhs.relevance || (std::abs(lhs.relevance - rhs.relevance) < EPSILON && lhs.rating > rhs.rating);
-         });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+template <typename Traits>
+template <typename DocumentPredicate>
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindTopDocuments(const PreparedQuery &query, DocumentPredicate document_predicate) const
+{
+    return FindTopDocuments(std::execution::seq, query, document_predicate);
+}
+
+template <typename Traits>
+template <class ExecutionPolicy, typename DocumentPredicate, EnableIfExecutionPolicy<ExecutionPolicy>>
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindTopDocuments(ExecutionPolicy policy, const PreparedQuery &query, DocumentPredicate document_predicate) const
+{
+    QueryArenaScope arena;
+    if (query.IsResolvedFor(*this))
     {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        return FindTopResolvedDocuments(policy, query.terms_, document_predicate, arena.GetResource());
     }
-    return matched_documents;
+    // Stale query: only dictionary lookups are repeated, the text is not parsed again
+    return FindTopResolvedDocuments(policy,
+                                    ResolveQueryWords(query.plus_words_, query.minus_words_, query.plus_prefixes_,
+                                                      query.minus_prefixes_, arena.GetResource()),
+                                    document_predicate, arena.GetResource());
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query &query, DocumentPredicate document_predicate) const
+template <typename Traits>
+template <typename Words>
+std::pmr::vector<typename BasicSearchServer<Traits>::QueryTerm> BasicSearchServer<Traits>::ResolveTerms(const Words &words, std::pmr::memory_resource *resource) const
 {
-    return FindAllDocuments(std::execution::seq, query, document_predicate);
+    std::pmr::vector<QueryTerm> terms(resource);
+    terms.reserve(words.size());
+    for (std::string_view word : words)
+    {
+        auto it = word_to_term_id_.find(word);
+        if (it == word_to_term_id_.end())
+        {
+            continue;
+        }
+        const Term &term = terms_[it->second];
+        if (scoring_mode_ == ScoringMode::IMPACT)
+        {
+            terms.push_back({word, term.postings.get(), term.inverse_document_freq, it->second, true});
+        }
+        else
+        {
+            terms.push_back({word, term.postings.get(), ComputeInverseDocumentFreq(term.postings->size()), it->second});
+        }
+    }
+    return terms;
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_policy seq_police, const Query &query, DocumentPredicate document_predicate) const
+template <typename Traits>
+template <typename Words>
+std::pmr::vector<typename BasicSearchServer<Traits>::QueryTerm> BasicSearchServer<Traits>::ResolvePlusTerms(const Words &words, std::pmr::memory_resource *resource) const
 {
-    std::map<int, double> document_to_relevance;
-    for (std::string_view word : query.plus_words)
+    auto terms = ResolveTerms(words, resource);
+    if (fuzzy_index_ && terms.size() < words.size())
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        for (std::string_view word : words)
         {
-            continue;
+            if (word_to_term_id_.count(word) == 0)
+            {
+                AppendCorrections(word, terms);
+            }
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
+    }
+    return terms;
+}
+
+template <typename Traits>
+template <typename Words>
+void BasicSearchServer<Traits>::AppendPrefixTerms(const Words &prefixes, std::pmr::vector<QueryTerm> &terms) const
+{
+    std::pmr::memory_resource *resource = terms.get_allocator().resource();
+    for (std::string_view prefix : prefixes)
+    {
+        for (const QueryTerm &expanded_term : ResolveTerms(ExpandPrefix(prefix, resource), resource))
         {
-            const auto &document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating))
+            // The word may be in the query already, on its own or from another prefix
+            if (std::none_of(terms.begin(), terms.end(),
+                             [&expanded_term](const QueryTerm &term)
+                             {
+                                 return term.term_id == expanded_term.term_id;
+                             }))
             {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                terms.push_back(expanded_term);
             }
         }
     }
-    for (std::string_view word : query.minus_words)
+}
+
+template <typename Traits>
+template <typename Words>
+typename BasicSearchServer<Traits>::ResolvedQuery BasicSearchServer<Traits>::ResolveQueryWords(const Words &plus_words, const Words &minus_words, const Words &plus_prefixes,
+                                              const Words &minus_prefixes, std::pmr::memory_resource *resource) const
+{
+    ResolvedQuery query{ResolvePlusTerms(plus_words, resource), ResolveTerms(minus_words, resource)};
+    AppendPrefixTerms(plus_prefixes, query.plus_terms);
+    AppendPrefixTerms(minus_prefixes, query.minus_terms);
+    return query;
+}
+
+template <typename Traits>
+template <class ExecutionPolicy>
+void BasicSearchServer<Traits>::AddDocumentBatch(ExecutionPolicy policy, typename std::vector<NewDocument>::const_iterator first,
+                                                 typename std::vector<NewDocument>::const_iterator last)
+{
+    using namespace std::string_literals;
+    const size_t count = last - first;
+    std::vector<DocumentId> document_ids;
+    document_ids.reserve(count);
+    for (auto it = first; it != last; ++it)
+    {
+        if (IsNegative(it->id) || documents_.count(it->id) > 0)
+        {
+            throw std::invalid_argument("Invalid document_id"s);
+        }
+        document_ids.push_back(it->id);
+    }
+    std::sort(policy, document_ids.begin(), document_ids.end());
+    if (std::adjacent_find(document_ids.begin(), document_ids.end()) != document_ids.end())
+    {
+        throw std::invalid_argument("Invalid document_id"s);
+    }
+
+    // An exception must not leave a parallel algorithm, the first one in the order of documents is rethrown
+    std::vector<std::vector<std::string_view>> words(count);
+    std::vector<std::exception_ptr> errors(count);
+    std::vector<size_t> indexes(count);
+    std::iota(indexes.begin(), indexes.end(), size_t(0));
+    std::for_each(policy, indexes.begin(), indexes.end(),
+                  [&](size_t i)
+                  {
+                      try
+                      {
+                          words[i] = SplitIntoWordsNoStop(first[i].text);
+                      }
+                      catch (...)
+                      {
+                          errors[i] = std::current_exception();
+                      }
+                  });
+    for (const std::exception_ptr &error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    if (memory_budget_ != 0)
+    {
+        CheckMemoryBudget(std::transform_reduce(policy, words.begin(), words.end(), size_t(0), std::plus<>(), EstimateDocumentMemory));
+    }
+
+    // The dictionary is changed sequentially, the forward indexes are sorted in parallel
+    std::vector<DocumentWords> document_words;
+    document_words.reserve(count);
+    for (const std::vector<std::string_view> &document : words)
+    {
+        const Score inv_word_count = Score(1) / document.size();
+        DocumentWords &current = document_words.emplace_back(CountingAllocator<WordFreq>(&memory_->documents));
+        current.reserve(document.size());
+        for (std::string_view word : document)
+        {
+            current.push_back({AcquireTerm(word), inv_word_count});
+        }
+    }
+    std::for_each(policy, document_words.begin(), document_words.end(), MergeRepeatedWords);
+
+    std::vector<NewPosting> postings;
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (const auto [term_id, term_freq] : document_words[i])
+        {
+            postings.push_back({term_id, first[i].id, term_freq});
+        }
+        auto stored_words = std::allocate_shared<const DocumentWords>(CountingAllocator<DocumentWords>(&memory_->documents),
+                                                                      std::move(document_words[i]));
+        documents_.emplace(first[i].id, DocumentData{ComputeAverageRating(first[i].ratings), first[i].status, std::move(stored_words)});
+        document_ids_.emplace(first[i].id);
+    }
+    InsertPostings(policy, postings);
+    ++generation_;
+}
+
+template <typename Traits>
+template <class ExecutionPolicy>
+void BasicSearchServer<Traits>::InsertPostings(ExecutionPolicy policy, std::vector<NewPosting> &postings)
+{
+    std::sort(policy, postings.begin(), postings.end(),
+              [](const NewPosting &lhs, const NewPosting &rhs)
+              {
+                  return std::pair(lhs.term_id, lhs.document_id) < std::pair(rhs.term_id, rhs.document_id);
+              });
+
+    std::vector<std::pair<size_t, size_t>> term_ranges;
+    for (size_t begin = 0; begin < postings.size();)
+    {
+        size_t end = begin + 1;
+        while (end < postings.size() && postings[end].term_id == postings[begin].term_id)
+        {
+            ++end;
+        }
+        term_ranges.emplace_back(begin, end);
+        begin = end;
+    }
+
+    // Every task owns one term. Documents come in ascending order, so the end of the list is a good hint
+    std::for_each(policy, term_ranges.begin(), term_ranges.end(),
+                  [&](const std::pair<size_t, size_t> &range)
+                  {
+                      Term &term = terms_[postings[range.first].term_id];
+                      PostingList &term_postings = GetMutablePostings(term);
+                      for (size_t i = range.first; i < range.second; ++i)
+                      {
+                          term_postings.emplace_hint(term_postings.end(), postings[i].document_id,
+                                                     Posting{postings[i].term_freq, static_cast<Score>(postings[i].term_freq * term.inverse_document_freq)});
+                      }
+                  });
+    if (scoring_mode_ == ScoringMode::IMPACT && !RefreshImpactsIfCountDrifted())
+    {
+        std::for_each(policy, term_ranges.begin(), term_ranges.end(),
+                      [&](const std::pair<size_t, size_t> &range)
+                      {
+                          RefreshImpactsIfDrifted(terms_[postings[range.first].term_id]);
+                      });
+    }
+}
+
+template <typename Traits>
+template <class ExecutionPolicy>
+void BasicSearchServer<Traits>::RemoveDocumentBatch(ExecutionPolicy policy, typename std::vector<DocumentId>::const_iterator first,
+                                                    typename std::vector<DocumentId>::const_iterator last)
+{
+    std::vector<typename decltype(documents_)::node_type> removed;
+    // <term, document> of every removed posting, grouped by term
+    std::vector<std::pair<TermId, DocumentId>> postings;
+    for (auto it = first; it != last; ++it)
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        auto document = documents_.extract(*it);
+        if (document.empty())
         {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word))
+        for (const auto [term_id, _] : *document.mapped().words)
+        {
+            postings.emplace_back(term_id, *it);
+        }
+        document_ids_.erase(*it);
+        removed.push_back(std::move(document));
+    }
+    if (removed.empty())
+    {
+        return;
+    }
+    std::sort(policy, postings.begin(), postings.end());
+
+    std::vector<std::pair<size_t, size_t>> term_ranges;
+    for (size_t begin = 0; begin < postings.size();)
+    {
+        size_t end = begin + 1;
+        while (end < postings.size() && postings[end].first == postings[begin].first)
         {
-            document_to_relevance.erase(document_id);
+            ++end;
         }
+        term_ranges.emplace_back(begin, end);
+        begin = end;
     }
 
-    std::vector<Document> matched_documents;
+    // Every task owns one term, the dictionary and the free list are changed sequentially afterwards
+    std::for_each(policy, term_ranges.begin(), term_ranges.end(),
+                  [&](const std::pair<size_t, size_t> &range)
+                  {
+                      PostingList &term_postings = GetMutablePostings(terms_[postings[range.first].first]);
+                      for (size_t i = range.first; i < range.second; ++i)
+                      {
+                          term_postings.erase(postings[i].second);
+                      }
+                  });
+    if (scoring_mode_ == ScoringMode::IMPACT && !RefreshImpactsIfCountDrifted())
+    {
+        std::for_each(policy, term_ranges.begin(), term_ranges.end(),
+                      [&](const std::pair<size_t, size_t> &range)
+                      {
+                          RefreshImpactsIfDrifted(terms_[postings[range.first].first]);
+                      });
+    }
+    for (const auto &[begin, _] : term_ranges)
+    {
+        ReleaseTermIfUnused(postings[begin].first);
+    }
+    ++generation_;
+}
+
+template <typename Traits>
+template <class ExecutionPolicy, typename DocumentPredicate>
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindTopResolvedDocuments(ExecutionPolicy policy, const ResolvedQuery &query, DocumentPredicate document_predicate,
+                                                             std::pmr::memory_resource *resource) const
+{
+    auto matched_documents = FindAllDocuments(policy, query, document_predicate, resource);
+    return SelectTopDocuments(matched_documents);
+}
+
+template <typename Traits>
+template <typename DocumentPredicate>
+std::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindTopResolvedDocuments(AutoExecutionPolicy, const ResolvedQuery &query, DocumentPredicate document_predicate,
+                                                             std::pmr::memory_resource *resource) const
+{
+    size_t work = 0;
+    for (const QueryTerm &term : query.plus_terms)
+    {
+        work += term.postings->size();
+    }
+    if (IsParallelWorthwhile(work, query.plus_terms.size()))
+    {
+        return FindTopResolvedDocuments(std::execution::par, query, document_predicate, resource);
+    }
+    return FindTopResolvedDocuments(std::execution::seq, query, document_predicate, resource);
+}
+
+template <typename Traits>
+template <typename DocumentPredicate>
+typename BasicSearchServer<Traits>::SearchPage BasicSearchServer<Traits>::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t offset, size_t limit) const
+{
+    auto state = std::make_shared<typename SearchCursor::State>();
+    state->query = PrepareQuery(raw_query);
+    state->document_predicate = document_predicate;
+    return FindTopDocuments(SearchCursor(std::move(state), offset), limit);
+}
+
+template <typename Traits>
+template <typename DocumentPredicate>
+typename BasicSearchServer<Traits>::SearchResult BasicSearchServer<Traits>::FindTopDocumentsWithin(const SearchBudget &budget, std::string_view raw_query, DocumentPredicate document_predicate) const
+{
+    QueryArenaScope arena;
+    const auto query = ParseQuery(raw_query, true, arena.GetResource());
+
+    SearchResult result;
+    auto matched_documents = FindAllDocuments(std::execution::seq, ResolveQuery(query, arena.GetResource()), document_predicate,
+                                              budget, result.is_partial, arena.GetResource());
+    result.documents = SelectTopDocuments(matched_documents);
+    return result;
+}
+
+template <typename Traits>
+template <typename DocumentPredicate>
+std::future<typename BasicSearchServer<Traits>::SearchResult> BasicSearchServer<Traits>::FindTopDocumentsAsync(SearchBudget budget, std::string raw_query, DocumentPredicate document_predicate) const
+{
+    return SearchTaskPool::GetShared().Submit([this, budget = std::move(budget), raw_query = std::move(raw_query), document_predicate]
+                                              {
+                                                  return FindTopDocumentsWithin(budget, raw_query, document_predicate);
+                                              });
+}
+
+template <typename Traits>
+template <typename DocumentPredicate>
+std::pmr::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindAllDocuments(std::execution::sequenced_policy seq_police, const ResolvedQuery &query, DocumentPredicate document_predicate,
+                                                          std::pmr::memory_resource *resource) const
+{
+    bool is_partial = false;
+    return FindAllDocuments(seq_police, query, document_predicate, UnlimitedBudget{}, is_partial, resource);
+}
+
+template <typename Traits>
+template <typename DocumentPredicate, typename Budget>
+std::pmr::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindAllDocuments(std::execution::sequenced_policy, const ResolvedQuery &query, DocumentPredicate document_predicate,
+                                                          const Budget &budget, bool &is_partial, std::pmr::memory_resource *resource) const
+{
+    // Minus-words are applied even on an exhausted budget, excluded documents must never be returned
+    const DocumentBitmap excluded_documents = BuildExcludedDocuments(query, resource);
+    std::pmr::map<DocumentId, Score> document_to_relevance(resource);
+    is_partial = budget.IsExhausted();
+    int postings_before_check = BUDGET_CHECK_INTERVAL;
+    for (const QueryTerm &term : query.plus_terms)
+    {
+        if (is_partial)
+        {
+            break;
+        }
+        for (const auto &[document_id, posting] : *term.postings)
+        {
+            if (--postings_before_check == 0)
+            {
+                postings_before_check = BUDGET_CHECK_INTERVAL;
+                if (budget.IsExhausted())
+                {
+                    is_partial = true;
+                    break;
+                }
+            }
+            if (excluded_documents.Contains(document_id))
+            {
+                continue;
+            }
+            const auto &document_data = documents_.at(document_id);
+            if (document_predicate(document_id, document_data.status, document_data.rating))
+            {
+                document_to_relevance[document_id] += term.use_impacts ? posting.impact : posting.term_freq * term.inverse_document_freq;
+            }
+        }
+    }
+
+    std::pmr::vector<Document> matched_documents(resource);
+    matched_documents.reserve(document_to_relevance.size());
     for (const auto [document_id, relevance] : document_to_relevance)
     {
         matched_documents.push_back(
@@ -226,35 +939,29 @@ std::vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_p
     return matched_documents;
 }
 
+template <typename Traits>
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(std::execution::parallel_policy par_police, const Query &query, DocumentPredicate document_predicate) const
+std::pmr::vector<typename BasicSearchServer<Traits>::Document> BasicSearchServer<Traits>::FindAllDocuments(std::execution::parallel_policy, const ResolvedQuery &query, DocumentPredicate document_predicate,
+                                                          std::pmr::memory_resource *resource) const
 
 {
-    ConcurrentMap<int, double> document_to_relevance(101);
+    const DocumentBitmap excluded_documents = BuildExcludedDocuments(query, resource);
+    ConcurrentMap<DocumentId, Score> document_to_relevance(101);
 
-    std::for_each(std::execution::par, query.plus_words.begin(), query.plus_words.end(), [this, &document_to_relevance, &document_predicate](std::string_view word)
+    std::for_each(std::execution::par, query.plus_terms.begin(), query.plus_terms.end(), [this, &document_to_relevance, &document_predicate, &excluded_documents](const QueryTerm &term)
                   {
-        if ( word_to_document_freqs_.count(word) != 0 ) {
-            auto it = word_to_document_freqs_.find(word);
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for ( const auto [document_id, term_freq] : it->second ) {
-                const auto &document_data = documents_.at(document_id);
-                if ( document_predicate(document_id, document_data.status, document_data.rating) ) {
-                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                }
+        for ( const auto &[document_id, posting] : *term.postings ) {
+            if ( excluded_documents.Contains(document_id) ) {
+                continue;
             }
-        } });
-
-    std::for_each(std::execution::par, query.minus_words.begin(), query.minus_words.end(), [this, &document_to_relevance](std::string_view word)
-                  {
-        if ( word_to_document_freqs_.count(word) != 0 ) {
-            auto it = word_to_document_freqs_.find(word);
-            for ( const auto [document_id, _] : it->second ) {
-                document_to_relevance.Erase(document_id);
+            const auto &document_data = documents_.at(document_id);
+            if ( document_predicate(document_id, document_data.status, document_data.rating) ) {
+                document_to_relevance[document_id].ref_to_value += term.use_impacts ? posting.impact : posting.term_freq * term.inverse_document_freq;
             }
         } });
 
-    std::vector<Document> matched_documents;
+    // Buckets are filled from other threads, so only the bitmap and the result use the arena
+    std::pmr::vector<Document> matched_documents(resource);
     for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap())
     {
         matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
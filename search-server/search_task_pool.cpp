@@ -0,0 +1,74 @@
+#include "search_task_pool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+SearchTaskPool::SearchTaskPool(size_t thread_count)
+{
+    if (thread_count == 0)
+    {
+        throw invalid_argument("A task pool needs at least one thread"s);
+    }
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        threads_.emplace_back([this]
+                              { WorkerLoop(); });
+    }
+}
+
+SearchTaskPool::~SearchTaskPool()
+{
+    {
+        lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    task_added_.notify_all();
+    for (thread &worker : threads_)
+    {
+        worker.join();
+    }
+}
+
+size_t SearchTaskPool::GetThreadCount() const
+{
+    return threads_.size();
+}
+
+SearchTaskPool &SearchTaskPool::GetShared()
+{
+    static SearchTaskPool pool(max(thread::hardware_concurrency(), 1u));
+    return pool;
+}
+
+void SearchTaskPool::Enqueue(function<void()> task)
+{
+    {
+        lock_guard guard(mutex_);
+        tasks_.push_back(move(task));
+    }
+    task_added_.notify_one();
+}
+
+void SearchTaskPool::WorkerLoop()
+{
+    while (true)
+    {
+        function<void()> task;
+        {
+            unique_lock lock(mutex_);
+            task_added_.wait(lock, [this]
+                             { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty())
+            {
+                return;
+            }
+            task = move(tasks_.front());
+            tasks_.pop_front();
+        }
+        // A packaged task keeps its exception for the future
+        task();
+    }
+}
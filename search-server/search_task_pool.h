@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of threads running tasks in the order they were submitted. The threads live as long as the pool,
+// so their query arenas are reused and no more tasks run at once than there are threads
+class SearchTaskPool
+{
+public:
+    explicit SearchTaskPool(size_t thread_count);
+    // Runs the tasks already submitted, then joins the threads
+    ~SearchTaskPool();
+
+    SearchTaskPool(const SearchTaskPool &) = delete;
+    SearchTaskPool &operator=(const SearchTaskPool &) = delete;
+
+    // The result or the exception of the task goes to the future
+    template <typename Task>
+    std::future<std::invoke_result_t<Task &>> Submit(Task task);
+
+    size_t GetThreadCount() const;
+
+    // Pool of the asynchronous searches, one thread per hardware thread
+    static SearchTaskPool &GetShared();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable task_added_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    void Enqueue(std::function<void()> task);
+    void WorkerLoop();
+};
+
+template <typename Task>
+std::future<std::invoke_result_t<Task &>> SearchTaskPool::Submit(Task task)
+{
+    // std::function needs a copyable target, a packaged task is move-only
+    auto packaged = std::make_shared<std::packaged_task<std::invoke_result_t<Task &>()>>(std::move(task));
+    auto result = packaged->get_future();
+    Enqueue([packaged]
+            {
+                (*packaged)();
+            });
+    return result;
+}
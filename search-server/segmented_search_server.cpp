@@ -0,0 +1,300 @@
+#include "segmented_search_server.h"
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+SegmentedSearchServer::SegmentedSearchServer(string_view stop_words_text, size_t segment_capacity, size_t merge_factor)
+    : SegmentedSearchServer(SplitIntoWords(stop_words_text), segment_capacity, merge_factor)
+{
+}
+
+SegmentedSearchServer::SegmentedSearchServer(const string &stop_words_text, size_t segment_capacity, size_t merge_factor)
+    : SegmentedSearchServer(SplitIntoWords(stop_words_text), segment_capacity, merge_factor)
+{
+}
+
+SegmentedSearchServer::~SegmentedSearchServer()
+{
+    {
+        lock_guard guard(merge_mutex_);
+        is_stopping_ = true;
+    }
+    merge_changed_.notify_all();
+    merger_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status,
+                                        const vector<int> &ratings)
+{
+    auto lock = LockExclusive();
+    for (const auto &segment : segments_)
+    {
+        if (segment->Contains(document_id))
+        {
+            throw invalid_argument("Invalid document_id"s);
+        }
+    }
+    mutable_segment_->AddDocument(document_id, document, status, ratings);
+    if (static_cast<size_t>(mutable_segment_->GetDocumentCount()) >= segment_capacity_)
+    {
+        const auto sealed = SealMutableSegment();
+        lock.unlock();
+        RequestMerge();
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id)
+{
+    const auto lock = LockExclusive();
+    for (const auto &segment : segments_)
+    {
+        if (segment->RemoveDocument(document_id))
+        {
+            return;
+        }
+    }
+    mutable_segment_->RemoveDocument(document_id);
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(string_view raw_query) const
+{
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const
+{
+    return FindTopDocuments(raw_query,
+                            [status](int, DocumentStatus document_status, int)
+                            {
+                                return document_status == status;
+                            });
+}
+
+SearchServer::OwningMatchResult SegmentedSearchServer::MatchDocument(string_view raw_query, int document_id) const
+{
+    const auto lock = LockShared();
+    const PreparedQuery query = mutable_segment_->PrepareQuery(raw_query);
+    for (const auto &segment : segments_)
+    {
+        if (segment->Contains(document_id))
+        {
+            return segment->MatchDocument(query, document_id);
+        }
+    }
+    const auto [words, status] = mutable_segment_->MatchDocument(query, document_id);
+    return {{words.begin(), words.end()}, status};
+}
+
+int SegmentedSearchServer::GetDocumentCount() const
+{
+    const auto lock = LockShared();
+    int result = mutable_segment_->GetDocumentCount();
+    for (const auto &segment : segments_)
+    {
+        result += segment->GetDocumentCount();
+    }
+    return result;
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const
+{
+    const auto lock = LockShared();
+    return segments_.size();
+}
+
+void SegmentedSearchServer::Flush()
+{
+    auto lock = LockExclusive();
+    if (mutable_segment_->GetDocumentCount() == 0)
+    {
+        return;
+    }
+    const auto sealed = SealMutableSegment();
+    lock.unlock();
+    RequestMerge();
+}
+
+void SegmentedSearchServer::WaitForMerges()
+{
+    unique_lock merge_lock(merge_mutex_);
+    merge_changed_.wait(merge_lock,
+                        [this]
+                        {
+                            return !is_merge_requested_ && !is_merging_;
+                        });
+}
+
+void SegmentedSearchServer::CheckOptions() const
+{
+    if (segment_capacity_ == 0)
+    {
+        throw invalid_argument("Segment capacity must be positive"s);
+    }
+    if (merge_factor_ < 2)
+    {
+        throw invalid_argument("Merge factor must be at least 2"s);
+    }
+}
+
+shared_lock<shared_mutex> SegmentedSearchServer::LockShared() const
+{
+    lock_guard turnstile(turnstile_);
+    return shared_lock(mutex_);
+}
+
+unique_lock<shared_mutex> SegmentedSearchServer::LockExclusive()
+{
+    lock_guard turnstile(turnstile_);
+    return unique_lock(mutex_);
+}
+
+unique_ptr<SearchServer> SegmentedSearchServer::SealMutableSegment()
+{
+    segments_.push_back(make_shared<CompactSegment>(CompactSegment::Build(*mutable_segment_)));
+    return exchange(mutable_segment_, make_unique<SearchServer>(stop_words_));
+}
+
+void SegmentedSearchServer::RequestMerge()
+{
+    {
+        lock_guard guard(merge_mutex_);
+        is_merge_requested_ = true;
+    }
+    merge_changed_.notify_all();
+}
+
+void SegmentedSearchServer::RunMerger()
+{
+    unique_lock merge_lock(merge_mutex_);
+    while (true)
+    {
+        merge_changed_.wait(merge_lock,
+                            [this]
+                            {
+                                return is_stopping_ || is_merge_requested_;
+                            });
+        if (is_stopping_)
+        {
+            return;
+        }
+        is_merge_requested_ = false;
+        is_merging_ = true;
+        merge_lock.unlock();
+
+        while (MergeSegments())
+        {
+        }
+
+        merge_lock.lock();
+        is_merging_ = false;
+        merge_changed_.notify_all();
+    }
+}
+
+bool SegmentedSearchServer::MergeSegments()
+{
+    vector<shared_ptr<CompactSegment>> inputs;
+    vector<const CompactSegment *> sources;
+    vector<vector<bool>> removed;
+    {
+        const auto lock = LockShared();
+        inputs = SelectSegmentsToMerge();
+        for (const auto &segment : inputs)
+        {
+            sources.push_back(segment.get());
+            removed.push_back(segment->GetRemovedMarks());
+        }
+    }
+    if (inputs.empty())
+    {
+        return false;
+    }
+
+    // Only the removal marks of the inputs may change meanwhile, and they were copied.
+    // Sealing appends segments, so the inputs stay in segments_ until they are replaced here
+    auto merged = make_shared<CompactSegment>(CompactSegment::Merge(sources, removed));
+
+    const auto lock = LockExclusive();
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        for (const int document_id : inputs[i]->GetRemovedSince(removed[i]))
+        {
+            merged->RemoveDocument(document_id);
+        }
+    }
+    segments_.erase(remove_if(segments_.begin(), segments_.end(),
+                              [&inputs](const shared_ptr<CompactSegment> &segment)
+                              {
+                                  return find(inputs.begin(), inputs.end(), segment) != inputs.end();
+                              }),
+                    segments_.end());
+    if (merged->GetDocumentCount() > 0)
+    {
+        segments_.push_back(move(merged));
+    }
+    return true;
+}
+
+vector<shared_ptr<CompactSegment>> SegmentedSearchServer::SelectSegmentsToMerge() const
+{
+    // The lowest tier that has enough segments; the merged segment usually goes one tier up
+    map<size_t, vector<shared_ptr<CompactSegment>>> tiers;
+    for (const auto &segment : segments_)
+    {
+        tiers[GetTier(*segment)].push_back(segment);
+    }
+    for (auto &[tier, segments] : tiers)
+    {
+        if (segments.size() >= merge_factor_)
+        {
+            segments.resize(merge_factor_);
+            return segments;
+        }
+    }
+    return {};
+}
+
+size_t SegmentedSearchServer::GetTier(const CompactSegment &segment) const
+{
+    size_t tier = 0;
+    for (size_t limit = segment_capacity_; static_cast<size_t>(segment.GetDocumentCount()) > limit; limit *= merge_factor_)
+    {
+        ++tier;
+    }
+    return tier;
+}
+
+map<string_view, double> SegmentedSearchServer::ComputeInverseDocumentFreqs(const PreparedQuery &query) const
+{
+    int document_count = mutable_segment_->GetDocumentCount();
+    for (const auto &segment : segments_)
+    {
+        document_count += segment->GetDocumentCount();
+    }
+
+    map<string_view, size_t> document_freqs;
+    for (const string &word : query.GetPlusWords())
+    {
+        size_t &document_freq = document_freqs[word];
+        for (const auto &segment : segments_)
+        {
+            document_freq += segment->GetDocumentFreq(word);
+        }
+    }
+    for (const QueryTerm &term : query.GetTerms().plus_terms)
+    {
+        document_freqs[term.word] += term.postings->size();
+    }
+
+    map<string_view, double> inverse_document_freqs;
+    for (const auto [word, document_freq] : document_freqs)
+    {
+        if (document_freq > 0)
+        {
+            inverse_document_freqs[word] = log(document_count * 1.0 / document_freq);
+        }
+    }
+    return inverse_document_freqs;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <execution>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "compact_segment.h"
+#include "document.h"
+#include "search_server.h"
+
+const size_t DEFAULT_SEGMENT_CAPACITY = 4096;
+const size_t DEFAULT_MERGE_FACTOR = 4;
+
+// Index split into segments in the LSM way. New documents go to a small mutable SearchServer; when it holds
+// segment_capacity documents it is sealed into a CompactSegment. A background thread merges sealed segments by a
+// tiered policy: a segment with up to segment_capacity * merge_factor^k documents is in tier k, and merge_factor
+// segments of one tier are merged into one. Queries go to all segments with IDF over all of them, so rankings are
+// the same as of a single SearchServer.
+class SegmentedSearchServer
+{
+public:
+    template <typename StringContainer>
+    explicit SegmentedSearchServer(const StringContainer &stop_words, size_t segment_capacity = DEFAULT_SEGMENT_CAPACITY,
+                                   size_t merge_factor = DEFAULT_MERGE_FACTOR);
+    explicit SegmentedSearchServer(std::string_view stop_words_text, size_t segment_capacity = DEFAULT_SEGMENT_CAPACITY,
+                                   size_t merge_factor = DEFAULT_MERGE_FACTOR);
+    explicit SegmentedSearchServer(const std::string &stop_words_text, size_t segment_capacity = DEFAULT_SEGMENT_CAPACITY,
+                                   size_t merge_factor = DEFAULT_MERGE_FACTOR);
+    ~SegmentedSearchServer();
+
+    SegmentedSearchServer(const SegmentedSearchServer &) = delete;
+    SegmentedSearchServer &operator=(const SegmentedSearchServer &) = delete;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int> &ratings);
+    void RemoveDocument(int document_id);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    SearchServer::OwningMatchResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+    // Sealed segments
+    size_t GetSegmentCount() const;
+
+    // Seals the mutable segment even if it is not full
+    void Flush();
+    // Returns when the merger has nothing to do
+    void WaitForMerges();
+
+private:
+    size_t segment_capacity_;
+    size_t merge_factor_;
+
+    std::set<std::string, std::less<>> stop_words_; // for every new mutable segment
+
+    mutable std::shared_mutex mutex_;
+    // A shared_mutex of glibc lets new readers in while a writer waits, so a stream of queries could starve it.
+    // A writer holds the turnstile while it waits for the lock, readers pass the turnstile first
+    mutable std::mutex turnstile_;
+    std::unique_ptr<SearchServer> mutable_segment_;
+    std::vector<std::shared_ptr<CompactSegment>> segments_; // removals change them under the exclusive lock
+
+    std::mutex merge_mutex_;
+    std::condition_variable merge_changed_;
+    bool is_merge_requested_ = false;
+    bool is_merging_ = false;
+    bool is_stopping_ = false;
+    std::thread merger_; // the last member: it starts when everything else is ready
+
+    void CheckOptions() const;
+
+    std::shared_lock<std::shared_mutex> LockShared() const;
+    std::unique_lock<std::shared_mutex> LockExclusive();
+
+    // The exclusive lock must be held. Returns the sealed server to be freed after the lock is released
+    std::unique_ptr<SearchServer> SealMutableSegment();
+    void RequestMerge();
+    void RunMerger();
+    // Merges one group of segments, returns false when the policy finds none
+    bool MergeSegments();
+    // Segments to merge next, the lock must be held
+    std::vector<std::shared_ptr<CompactSegment>> SelectSegmentsToMerge() const;
+    size_t GetTier(const CompactSegment &segment) const;
+
+    // IDF of the plus-words over all segments, the lock must be held
+    std::map<std::string_view, double> ComputeInverseDocumentFreqs(const PreparedQuery &query) const;
+};
+
+template <typename StringContainer>
+SegmentedSearchServer::SegmentedSearchServer(const StringContainer &stop_words, size_t segment_capacity, size_t merge_factor)
+    : segment_capacity_(segment_capacity),
+      merge_factor_(merge_factor),
+      stop_words_(MakeUniqueNonEmptyStrings(stop_words)),
+      mutable_segment_(std::make_unique<SearchServer>(stop_words_))
+{
+    CheckOptions();
+    merger_ = std::thread([this]
+                          {
+                              RunMerger();
+                          });
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const
+{
+    const auto lock = LockShared();
+    PreparedQuery query = mutable_segment_->PrepareQuery(raw_query);
+    const auto inverse_document_freqs = ComputeInverseDocumentFreqs(query);
+    query.OverrideInverseDocumentFreqs(inverse_document_freqs);
+
+    std::vector<std::vector<Document>> results(segments_.size() + 1);
+    results.back() = mutable_segment_->FindTopDocuments(query, document_predicate);
+    std::vector<size_t> indexes(segments_.size());
+    std::iota(indexes.begin(), indexes.end(), size_t(0));
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(),
+                  [&](size_t i)
+                  {
+                      results[i] = segments_[i]->FindTopDocuments(query, inverse_document_freqs, document_predicate);
+                  });
+    return MergeTopDocuments(results);
+}
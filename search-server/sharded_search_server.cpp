@@ -0,0 +1,158 @@
+#include "sharded_search_server.h"
+
+#include <cmath>
+
+using namespace std;
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, string_view stop_words_text)
+    : ShardedSearchServer(shard_count, SplitIntoWords(stop_words_text))
+{
+}
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const string &stop_words_text)
+    : ShardedSearchServer(shard_count, SplitIntoWords(stop_words_text))
+{
+}
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status,
+                                      const vector<int> &ratings)
+{
+    if (document_id < 0)
+    {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    Shard &shard = GetShard(document_id);
+    lock_guard guard(shard.mutex);
+    shard.server.AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id)
+{
+    if (document_id < 0)
+    {
+        return;
+    }
+    Shard &shard = GetShard(document_id);
+    lock_guard guard(shard.mutex);
+    shard.server.RemoveDocument(document_id);
+}
+
+void ShardedSearchServer::RemoveDocuments(const vector<int> &document_ids)
+{
+    vector<vector<int>> shard_document_ids(shards_.size());
+    for (const int document_id : document_ids)
+    {
+        if (document_id >= 0)
+        {
+            shard_document_ids[document_id % shards_.size()].push_back(document_id);
+        }
+    }
+    for (size_t i = 0; i < shards_.size(); ++i)
+    {
+        if (shard_document_ids[i].empty())
+        {
+            continue;
+        }
+        lock_guard guard(shards_[i].mutex);
+        shards_[i].server.RemoveDocuments(execution::par, shard_document_ids[i]);
+    }
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query) const
+{
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const
+{
+    return FindTopDocuments(raw_query,
+                            [status](int, DocumentStatus document_status, int)
+                            {
+                                return document_status == status;
+                            });
+}
+
+SearchServer::MatchResult ShardedSearchServer::MatchDocument(string_view raw_query, int document_id) const
+{
+    if (document_id < 0)
+    {
+        throw out_of_range("Invalid document_id"s);
+    }
+    const Shard &shard = GetShard(document_id);
+    shared_lock guard(shard.mutex);
+    return shard.server.MatchDocument(raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const
+{
+    int result = 0;
+    for (const Shard &shard : shards_)
+    {
+        shared_lock guard(shard.mutex);
+        result += shard.server.GetDocumentCount();
+    }
+    return result;
+}
+
+size_t ShardedSearchServer::GetShardCount() const
+{
+    return shards_.size();
+}
+
+ShardedSearchServer::Shard &ShardedSearchServer::GetShard(int document_id)
+{
+    return shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
+
+const ShardedSearchServer::Shard &ShardedSearchServer::GetShard(int document_id) const
+{
+    return shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
+
+vector<shared_lock<shared_mutex>> ShardedSearchServer::LockAllShared() const
+{
+    // Always in shard order; writers hold a single shard only, so this cannot deadlock
+    vector<shared_lock<shared_mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const Shard &shard : shards_)
+    {
+        locks.emplace_back(shard.mutex);
+    }
+    return locks;
+}
+
+vector<PreparedQuery> ShardedSearchServer::PrepareShardQueries(string_view raw_query) const
+{
+    vector<PreparedQuery> queries;
+    queries.reserve(shards_.size());
+    queries.push_back(shards_.front().server.PrepareQuery(raw_query));
+    for (size_t i = 1; i < shards_.size(); ++i)
+    {
+        queries.push_back(queries.front());
+        shards_[i].server.RefreshQuery(queries.back());
+    }
+
+    int document_count = 0;
+    for (const Shard &shard : shards_)
+    {
+        document_count += shard.server.GetDocumentCount();
+    }
+    map<string_view, size_t> document_freqs;
+    for (const PreparedQuery &query : queries)
+    {
+        for (const QueryTerm &term : query.GetTerms().plus_terms)
+        {
+            document_freqs[term.word] += term.postings->size();
+        }
+    }
+    map<string_view, double> inverse_document_freqs;
+    for (const auto [word, document_freq] : document_freqs)
+    {
+        inverse_document_freqs[word] = log(document_count * 1.0 / document_freq);
+    }
+    for (PreparedQuery &query : queries)
+    {
+        query.OverrideInverseDocumentFreqs(inverse_document_freqs);
+    }
+    return queries;
+}
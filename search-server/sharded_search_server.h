@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <execution>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Documents are partitioned by id over several SearchServer shards, each guarded by its own lock.
+// Queries are scattered over all shards with IDF computed from global document frequencies,
+// so rankings are the same as of a single SearchServer holding all documents.
+class ShardedSearchServer
+{
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(size_t shard_count, const StringContainer &stop_words);
+    ShardedSearchServer(size_t shard_count, std::string_view stop_words_text);
+    ShardedSearchServer(size_t shard_count, const std::string &stop_words_text);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int> &ratings);
+
+    void RemoveDocument(int document_id);
+    // Every shard is locked once for all of its documents
+    void RemoveDocuments(const std::vector<int> &document_ids);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    SearchServer::MatchResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+    size_t GetShardCount() const;
+
+private:
+    struct Shard
+    {
+        template <typename StopWords>
+        explicit Shard(const StopWords &stop_words)
+            : server(stop_words)
+        {
+        }
+
+        mutable std::shared_mutex mutex;
+        SearchServer server;
+    };
+
+    std::deque<Shard> shards_;
+
+    Shard &GetShard(int document_id);
+    const Shard &GetShard(int document_id) const;
+
+    std::vector<std::shared_lock<std::shared_mutex>> LockAllShared() const;
+
+    // Resolved query for every shard with IDF over all of them, shards must be locked
+    std::vector<PreparedQuery> PrepareShardQueries(std::string_view raw_query) const;
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StringContainer &stop_words)
+{
+    using namespace std::string_literals;
+    if (shard_count == 0)
+    {
+        throw std::invalid_argument("Shard count must be positive"s);
+    }
+    for (size_t i = 0; i < shard_count; ++i)
+    {
+        shards_.emplace_back(stop_words);
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const
+{
+    const auto locks = LockAllShared();
+    const auto queries = PrepareShardQueries(raw_query);
+
+    std::vector<std::vector<Document>> shard_results(shards_.size());
+    std::vector<size_t> indexes(shards_.size());
+    for (size_t i = 0; i < indexes.size(); ++i)
+    {
+        indexes[i] = i;
+    }
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(),
+                  [&](size_t i)
+                  {
+                      shard_results[i] = shards_[i].server.FindTopDocuments(queries[i], document_predicate);
+                  });
+
+    return MergeTopDocuments(shard_results);
+}
@@ -27,4 +27,19 @@ list<string_view> SplitIntoWords(string_view text) {
     }
     
     return words;
-}
\ No newline at end of file
+}
+
+pmr::vector<string_view> SplitIntoWords(string_view text, pmr::memory_resource *resource) {
+    pmr::vector<string_view> words(resource);
+    while (true) {
+        const size_t begin = text.find_first_not_of(' ');
+        if (begin == text.npos) {
+            break;
+        }
+        text.remove_prefix(begin);
+        const size_t end = min(text.find(' '), text.size());
+        words.push_back(text.substr(0, end));
+        text.remove_prefix(end);
+    }
+    return words;
+}
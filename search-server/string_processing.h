@@ -2,10 +2,13 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <memory_resource>
 #include <set>
 #include <string_view>
 
 std::list<std::string_view> SplitIntoWords(std::string_view text);
+// Words are stored in the given resource, e.g. the arena of a query
+std::pmr::vector<std::string_view> SplitIntoWords(std::string_view text, std::pmr::memory_resource *resource);
 
 template <typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
@@ -0,0 +1,1663 @@
+#include "test_example_functions.h"
+
+#include "document_bitmap.h"
+#include "durable_search_server.h"
+#include "front_coded_dictionary.h"
+#include "fuzzy_term_index.h"
+#include "query_arena.h"
+#include "request_queue.h"
+#include "search_server.h"
+#include "search_task_pool.h"
+#include "segmented_search_server.h"
+#include "sharded_search_server.h"
+#include "versioned_search_server.h"
+#include "write_ahead_log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    vector<int> GetIds(const vector<Document> &documents)
+    {
+        vector<int> ids;
+        for (const Document &document : documents)
+        {
+            ids.push_back(document.id);
+        }
+        return ids;
+    }
+
+    vector<int> GetIds(const SearchPage &page)
+    {
+        vector<int> ids;
+        for (const Document &document : page)
+        {
+            ids.push_back(document.id);
+        }
+        return ids;
+    }
+
+    SearchServer MakeAnimalServer()
+    {
+        SearchServer search_server("and with"s);
+        search_server.AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, {1, 2});
+        search_server.AddDocument(2, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+        search_server.AddDocument(3, "nasty dog with big eyes"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+        search_server.AddDocument(4, "nasty pigeon john"s, DocumentStatus::BANNED, {9});
+        return search_server;
+    }
+
+    // Texts over the words w0..w{vocabulary_size-1}, the same for the same seed
+    vector<string> MakeTexts(int count, int words_in_text, int vocabulary_size, unsigned seed)
+    {
+        mt19937 generator(seed);
+        uniform_int_distribution<int> word(0, vocabulary_size - 1);
+        vector<string> texts(count);
+        for (string &text : texts)
+        {
+            for (int i = 0; i < words_in_text; ++i)
+            {
+                text += "w"s + to_string(word(generator)) + " "s;
+            }
+        }
+        return texts;
+    }
+
+    void AssertSameTop(const vector<Document> &expected, const vector<Document> &actual, const string &query)
+    {
+        ASSERT_HINT(GetIds(actual) == GetIds(expected), query);
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            ASSERT_HINT(abs(actual[i].relevance - expected[i].relevance) < EPSILON, query);
+            ASSERT_EQUAL_HINT(actual[i].rating, expected[i].rating, query);
+        }
+    }
+
+    // Two servers over the same changing corpus: queries are compared after every batch of changes
+    template <typename Check>
+    void ForEachCorpusChange(SearchServer &lhs, SearchServer &rhs, Check check)
+    {
+        const auto texts = MakeTexts(400, 6, 80, 6);
+        for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+        {
+            lhs.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+            rhs.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+            if (id % 50 == 49)
+            {
+                check();
+            }
+        }
+        for (int id = 0; id < static_cast<int>(texts.size()); id += 3)
+        {
+            lhs.RemoveDocument(id);
+            rhs.RemoveDocument(id);
+        }
+        check();
+    }
+
+    void AssertBitmapMatchesSet(vector<uint64_t> ids, const vector<uint64_t> &probes)
+    {
+        const set<uint64_t> expected(ids.begin(), ids.end());
+        pmr::vector<uint64_t> document_ids(ids.begin(), ids.end());
+        const DocumentBitmap bitmap(document_ids, pmr::get_default_resource());
+        ASSERT_EQUAL(bitmap.GetSize(), expected.size());
+        for (uint64_t id : probes)
+        {
+            ASSERT_EQUAL_HINT(bitmap.Contains(id), expected.count(id) > 0, to_string(id));
+        }
+        for (uint64_t id : expected)
+        {
+            ASSERT_HINT(bitmap.Contains(id), to_string(id));
+        }
+    }
+
+    // Directory removed with everything in it when the test ends
+    class TemporaryDirectory
+    {
+    public:
+        TemporaryDirectory()
+        {
+            string path = (filesystem::temp_directory_path() / "search_server_test_XXXXXX").string();
+            if (mkdtemp(path.data()) == nullptr)
+            {
+                throw runtime_error("Cannot create a temporary directory"s);
+            }
+            path_ = path;
+        }
+
+        ~TemporaryDirectory()
+        {
+            filesystem::remove_all(path_);
+        }
+
+        const string &GetPath() const
+        {
+            return path_;
+        }
+
+    private:
+        string path_;
+    };
+
+    void AppendToFile(const string &path, const string &data)
+    {
+        ofstream(path, ios::binary | ios::app) << data;
+    }
+
+    template <typename Traits>
+    vector<int64_t> GetTopIds(const BasicSearchServer<Traits> &search_server, const string &query)
+    {
+        vector<int64_t> ids;
+        for (const auto &document : search_server.FindTopDocuments(query))
+        {
+            ids.push_back(static_cast<int64_t>(document.id));
+        }
+        return ids;
+    }
+}
+
+// ---------- PreparedQuery ----------
+
+void TestPreparedQueryMatchesRawQuery()
+{
+    const SearchServer search_server = MakeAnimalServer();
+    for (const string &query : {"curly nasty cat"s, "cat -curly"s, "nasty -dog eyes"s, "unknown"s})
+    {
+        const PreparedQuery prepared = search_server.PrepareQuery(query);
+        const auto expected = search_server.FindTopDocuments(query);
+        const auto actual = search_server.FindTopDocuments(prepared);
+        AssertSameTop(expected, actual, query);
+        ASSERT(GetIds(search_server.FindTopDocuments(prepared, DocumentStatus::BANNED)) ==
+               GetIds(search_server.FindTopDocuments(query, DocumentStatus::BANNED)));
+    }
+}
+
+void TestPreparedQueryParsesOnce()
+{
+    const SearchServer search_server = MakeAnimalServer();
+    const PreparedQuery prepared = search_server.PrepareQuery("cat cat -dog with"s);
+    ASSERT(prepared.GetPlusWords() == vector<string>{"cat"s});
+    ASSERT(prepared.GetMinusWords() == vector<string>{"dog"s});
+    ASSERT(prepared.IsResolvedFor(search_server));
+    ASSERT_THROWS(search_server.PrepareQuery("cat --dog"s), invalid_argument);
+    ASSERT_THROWS(search_server.PrepareQuery("cat -"s), invalid_argument);
+}
+
+void TestPreparedQueryIsResolvedAgainAfterChanges()
+{
+    SearchServer search_server = MakeAnimalServer();
+    PreparedQuery prepared = search_server.PrepareQuery("parrot"s);
+    ASSERT(search_server.FindTopDocuments(prepared).empty());
+
+    search_server.AddDocument(5, "green parrot"s, DocumentStatus::ACTUAL, {1});
+    ASSERT(!prepared.IsResolvedFor(search_server));
+    ASSERT(GetIds(search_server.FindTopDocuments(prepared)) == vector<int>{5});
+    search_server.RefreshQuery(prepared);
+    ASSERT(prepared.IsResolvedFor(search_server));
+
+    // A copy points into its own words
+    const PreparedQuery copy = prepared;
+    search_server.RemoveDocument(5);
+    ASSERT(search_server.FindTopDocuments(copy).empty());
+    ASSERT(search_server.FindTopDocuments(prepared).empty());
+}
+
+void TestPreparedQueryIsNotReusedByANewServer()
+{
+    optional<SearchServer> search_server;
+    search_server.emplace("and"s);
+    search_server->AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    const SearchServer *address = &*search_server;
+    const uint64_t generation = search_server->GetGeneration();
+    const PreparedQuery prepared = search_server->PrepareQuery("cat"s);
+    const SearchPage page = search_server->FindTopDocuments("cat"s, 0, 1);
+
+    // Same address and generation, but the terms of the query point into the destroyed server
+    search_server.reset();
+    search_server.emplace("and"s);
+    search_server->AddDocument(2, "black dog and cat"s, DocumentStatus::ACTUAL, {2});
+    ASSERT(&*search_server == address);
+    ASSERT_EQUAL(search_server->GetGeneration(), generation);
+    ASSERT(!prepared.IsResolvedFor(*search_server));
+    ASSERT(GetIds(search_server->FindTopDocuments(prepared)) == vector<int>{2});
+    ASSERT_THROWS(search_server->FindTopDocuments(page.GetNextCursor(), 1), invalid_argument);
+
+    const SearchServer clone = search_server->Clone();
+    const SearchServer moved = move(*search_server);
+    ASSERT(clone.GetInstanceId() != moved.GetInstanceId());
+    ASSERT(moved.GetInstanceId() != search_server->GetInstanceId());
+}
+
+// ---------- ShardedSearchServer ----------
+
+void TestShardedSearchMatchesSingleServer()
+{
+    const auto texts = MakeTexts(300, 8, 60, 1);
+    const auto queries = MakeTexts(40, 3, 70, 2);
+    SearchServer single(""s);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+    {
+        single.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    }
+    for (size_t shard_count : {1, 3, 4})
+    {
+        ShardedSearchServer sharded(shard_count, ""s);
+        for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+        {
+            sharded.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        }
+        ASSERT_EQUAL(sharded.GetDocumentCount(), single.GetDocumentCount());
+        for (const string &query : queries)
+        {
+            // Global IDF: the relevances are those of the single server, not of the shard holding the document
+            AssertSameTop(single.FindTopDocuments(query), sharded.FindTopDocuments(query), query);
+            const auto odd = [](int document_id, DocumentStatus, int)
+            {
+                return document_id % 2 == 1;
+            };
+            AssertSameTop(single.FindTopDocuments(query, odd), sharded.FindTopDocuments(query, odd), query);
+            AssertSameTop(single.FindTopDocuments(query + " -w1"s), sharded.FindTopDocuments(query + " -w1"s), query);
+        }
+    }
+}
+
+void TestShardedRemovalAndMatching()
+{
+    ShardedSearchServer sharded(3, "and"s);
+    sharded.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+    sharded.AddDocument(2, "cat"s, DocumentStatus::ACTUAL, {2});
+    sharded.AddDocument(3, "dog"s, DocumentStatus::BANNED, {3});
+    sharded.AddDocument(4, "cat dog"s, DocumentStatus::ACTUAL, {4});
+    ASSERT_THROWS(sharded.AddDocument(4, "bird"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+
+    // Matched words point into the query
+    const string query = "dog -bird"s;
+    const auto [words, status] = sharded.MatchDocument(query, 3);
+    ASSERT(words == vector<string_view>{"dog"sv});
+    ASSERT(status == DocumentStatus::BANNED);
+
+    sharded.RemoveDocuments({1, 4, 100});
+    sharded.RemoveDocument(2);
+    ASSERT_EQUAL(sharded.GetDocumentCount(), 1);
+    ASSERT(sharded.FindTopDocuments("cat"s).empty());
+    ASSERT(GetIds(sharded.FindTopDocuments("dog"s, DocumentStatus::BANNED)) == vector<int>{3});
+    ASSERT_THROWS(ShardedSearchServer(0, ""s), invalid_argument);
+}
+
+// ---------- Deadlines and cancellation ----------
+
+void TestSearchWithinBudget()
+{
+    const SearchServer search_server = MakeAnimalServer();
+    const SearchBudget generous(chrono::seconds(60));
+    const SearchResult result = search_server.FindTopDocumentsWithin(generous, "curly nasty cat"s);
+    ASSERT(!result.is_partial);
+    AssertSameTop(search_server.FindTopDocuments("curly nasty cat"s), result.documents, "curly nasty cat"s);
+
+    const SearchBudget expired(SearchBudget::Clock::now() - chrono::seconds(1));
+    ASSERT(expired.IsExhausted());
+    const SearchResult expired_result = search_server.FindTopDocumentsWithin(expired, "curly nasty cat"s);
+    ASSERT(expired_result.is_partial);
+    ASSERT(expired_result.documents.empty());
+
+    // Copies of a token share the flag
+    const CancellationToken token;
+    const SearchBudget cancelled(chrono::seconds(60), token);
+    CancellationToken(token).Cancel();
+    ASSERT(cancelled.IsExhausted());
+    ASSERT(search_server.FindTopDocumentsWithin(cancelled, "cat"s).is_partial);
+}
+
+void TestSearchIsCancelledWhileScoring()
+{
+    const int document_count = 10 * BUDGET_CHECK_INTERVAL;
+    SearchServer search_server(""s);
+    for (int id = 0; id < document_count; ++id)
+    {
+        search_server.AddDocument(id, "common word"s, DocumentStatus::ACTUAL, {id});
+    }
+    const CancellationToken token;
+    const SearchBudget budget(chrono::seconds(60), token);
+    int scored = 0;
+    const SearchResult result = search_server.FindTopDocumentsWithin(budget, "common"s,
+                                                                     [&](int, DocumentStatus, int)
+                                                                     {
+                                                                         if (++scored == BUDGET_CHECK_INTERVAL)
+                                                                         {
+                                                                             token.Cancel();
+                                                                         }
+                                                                         return true;
+                                                                     });
+    ASSERT(result.is_partial);
+    // Scoring stops at the next check of the budget
+    ASSERT(scored <= 2 * BUDGET_CHECK_INTERVAL);
+    ASSERT_EQUAL(result.documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+}
+
+void TestAsyncSearch()
+{
+    const SearchServer search_server = MakeAnimalServer();
+    auto found = search_server.FindTopDocumentsAsync(SearchBudget(chrono::seconds(60)), "nasty"s, DocumentStatus::BANNED);
+    auto invalid = search_server.FindTopDocumentsAsync(SearchBudget(chrono::seconds(60)), "nasty --dog"s);
+    auto matched = search_server.MatchDocumentAsync(SearchBudget(chrono::seconds(60)), "curly tail -dog"s, 2);
+    auto expired = search_server.MatchDocumentAsync(SearchBudget(SearchBudget::Clock::now()), "curly"s, 2);
+
+    ASSERT(GetIds(found.get().documents) == vector<int>{4});
+    ASSERT_THROWS(invalid.get(), invalid_argument);
+    // The words are copies, the query string of the task is gone
+    const auto [words, status] = matched.get();
+    ASSERT(words == (vector<string>{"curly"s, "tail"s}));
+    ASSERT(status == DocumentStatus::ACTUAL);
+    ASSERT_THROWS(expired.get(), BudgetExhausted);
+}
+
+void TestTaskPoolRunsEveryTask()
+{
+    atomic<int> done = 0;
+    vector<future<int>> results;
+    {
+        SearchTaskPool pool(2);
+        ASSERT_EQUAL(pool.GetThreadCount(), 2u);
+        for (int i = 0; i < 100; ++i)
+        {
+            results.push_back(pool.Submit([i, &done]
+                                          {
+                                              ++done;
+                                              return i * i;
+                                          }));
+        }
+        auto failed = pool.Submit([]() -> int
+                                  { throw out_of_range("failed"s); });
+        ASSERT_THROWS(failed.get(), out_of_range);
+    }
+    // The destructor runs what is queued before it joins the threads
+    ASSERT_EQUAL(done.load(), 100);
+    ASSERT_EQUAL(results[9].get(), 81);
+    ASSERT_THROWS(SearchTaskPool(0), invalid_argument);
+}
+
+void TestAsyncSearchesShareThePool()
+{
+    const SearchServer search_server = MakeAnimalServer();
+    mutex threads_mutex;
+    set<thread::id> threads;
+    const auto record_thread = [&](int, DocumentStatus, int)
+    {
+        lock_guard guard(threads_mutex);
+        threads.insert(this_thread::get_id());
+        return true;
+    };
+    vector<future<SearchResult>> results;
+    for (int i = 0; i < 200; ++i)
+    {
+        results.push_back(search_server.FindTopDocumentsAsync(SearchBudget(chrono::seconds(60)), "curly"s, record_thread));
+    }
+    for (auto &result : results)
+    {
+        ASSERT(!result.get().documents.empty());
+    }
+    // Not a thread per call: the searches ran on the threads of the shared pool
+    ASSERT(!threads.empty());
+    ASSERT(threads.size() <= SearchTaskPool::GetShared().GetThreadCount());
+    ASSERT(threads.count(this_thread::get_id()) == 0);
+}
+
+// ---------- Memory accounting ----------
+
+void TestMemoryStatsFollowTheIndex()
+{
+    SearchServer search_server("and with"s);
+    const MemoryStats empty = search_server.GetMemoryStats();
+    ASSERT(empty.stop_words > 0);
+
+    const auto texts = MakeTexts(200, 10, 500, 3);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+    {
+        search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    }
+    const MemoryStats loaded = search_server.GetMemoryStats();
+    ASSERT(loaded.terms > empty.terms);
+    ASSERT(loaded.dictionary > empty.dictionary);
+    ASSERT(loaded.documents > empty.documents);
+    ASSERT(loaded.document_ids > empty.document_ids);
+    ASSERT_EQUAL(loaded.stop_words, empty.stop_words);
+    ASSERT_EQUAL(loaded.fuzzy, 0u);
+
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+    {
+        search_server.RemoveDocument(id);
+    }
+    search_server.Compact();
+    const MemoryStats removed = search_server.GetMemoryStats();
+    ASSERT_EQUAL(removed.documents, empty.documents);
+    ASSERT_EQUAL(removed.document_ids, empty.document_ids);
+    ASSERT_EQUAL(removed.dictionary, empty.dictionary);
+    ASSERT(removed.Total() < loaded.Total());
+}
+
+void TestMemoryBudget()
+{
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+    const MemoryStats before = search_server.GetMemoryStats();
+    search_server.SetMemoryBudget(before.Total() + 64);
+
+    // A rejected document changes nothing
+    ASSERT_THROWS(search_server.AddDocument(2, MakeTexts(1, 100, 1000, 4)[0], DocumentStatus::ACTUAL, {}), length_error);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 1);
+    ASSERT_EQUAL(search_server.GetMemoryStats().Total(), before.Total());
+    ASSERT(search_server.FindTopDocuments("w1"s).empty());
+
+    search_server.SetMemoryBudget(before.Total() + 64, MemoryBudgetPolicy::COMPACT);
+    ASSERT_THROWS(search_server.AddDocument(2, MakeTexts(1, 100, 1000, 4)[0], DocumentStatus::ACTUAL, {}), length_error);
+
+    search_server.ResetMemoryBudget();
+    search_server.AddDocument(2, MakeTexts(1, 100, 1000, 4)[0], DocumentStatus::ACTUAL, {});
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 2);
+
+    // The slots of the removed words are what COMPACT gets back
+    search_server.RemoveDocument(2);
+    search_server.SetMemoryBudget(search_server.GetMemoryStats().Total());
+    ASSERT_THROWS(search_server.AddDocument(3, "fish"s, DocumentStatus::ACTUAL, {}), length_error);
+    search_server.SetMemoryBudget(search_server.GetMemoryStats().Total(), MemoryBudgetPolicy::COMPACT);
+    search_server.AddDocument(3, "fish"s, DocumentStatus::ACTUAL, {});
+    ASSERT(GetIds(search_server.FindTopDocuments("fish cat"s)) == (vector<int>{3, 1}));
+}
+
+void TestCompactRenumbersTerms()
+{
+    SearchServer search_server(""s);
+    search_server.EnablePrefixSearch();
+    search_server.EnableFuzzySearch(FuzzyOptions());
+    const auto texts = MakeTexts(300, 8, 2000, 9);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+    {
+        search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    }
+    for (int id = 0; id < static_cast<int>(texts.size()); id += 2)
+    {
+        search_server.RemoveDocument(id);
+    }
+    const PreparedQuery prepared = search_server.PrepareQuery(texts[1]);
+    const SearchPage first_page = search_server.FindTopDocuments(texts[3], 0, 2);
+    vector<vector<Document>> expected;
+    for (const string &query : {texts[1], texts[5] + " -w1"s, "w1*"s, "w1O"s})
+    {
+        expected.push_back(search_server.FindTopDocuments(query));
+    }
+    // The keys point into the words of the index, which Compact moves
+    const auto copy_frequencies = [&search_server]
+    {
+        const auto frequencies = search_server.GetWordFrequencies(7);
+        return map<string, double>(frequencies.begin(), frequencies.end());
+    };
+    const map<string, double> frequencies = copy_frequencies();
+    const MemoryStats before = search_server.GetMemoryStats();
+
+    search_server.Compact();
+    const MemoryStats after = search_server.GetMemoryStats();
+    ASSERT(after.terms < before.terms);
+    ASSERT(after.Total() < before.Total());
+
+    // The same answers under the new term ids
+    size_t i = 0;
+    for (const string &query : {texts[1], texts[5] + " -w1"s, "w1*"s, "w1O"s})
+    {
+        AssertSameTop(expected[i++], search_server.FindTopDocuments(query), query);
+    }
+    ASSERT(copy_frequencies() == frequencies);
+    ASSERT(!prepared.IsResolvedFor(search_server));
+    AssertSameTop(expected[0], search_server.FindTopDocuments(prepared), texts[1]);
+    const SearchPage next_page = search_server.FindTopDocuments(first_page.GetNextCursor(), 3);
+    ASSERT(GetIds(next_page) == GetIds(search_server.FindTopDocuments(texts[3], 2, 3)));
+
+    // New words take fresh ids after the live ones
+    search_server.AddDocument(1000, "fresh w1"s, DocumentStatus::ACTUAL, {});
+    ASSERT(GetIds(search_server.FindTopDocuments("fresh"s)) == vector<int>{1000});
+    const string query = "fresh w1 w2"s;
+    ASSERT(get<0>(search_server.MatchDocument(query, 1000)) == (vector<string_view>{"fresh"sv, "w1"sv}));
+}
+
+void TestCompactShrinksFlatPostings()
+{
+    BasicSearchServer<CompactIndexTraits> search_server(""s);
+    for (uint32_t id = 0; id < 1000; ++id)
+    {
+        search_server.AddDocument(id, "common w"s + to_string(id % 10), DocumentStatus::ACTUAL, {});
+    }
+    for (uint32_t id = 0; id < 1000; id += 4)
+    {
+        search_server.RemoveDocument(id);
+    }
+    const MemoryStats before = search_server.GetMemoryStats();
+    search_server.Compact();
+    ASSERT(search_server.GetMemoryStats().terms < before.terms);
+    ASSERT_EQUAL(search_server.FindTopDocuments("common"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+}
+
+// ---------- Forward index ----------
+
+void TestWordFrequenciesFromForwardIndex()
+{
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "cat and dog and cat cat"s, DocumentStatus::ACTUAL, {});
+    search_server.AddDocument(2, "dog"s, DocumentStatus::ACTUAL, {});
+
+    const auto frequencies = search_server.GetWordFrequencies(1);
+    ASSERT_EQUAL(frequencies.size(), 2u);
+    ASSERT(abs(frequencies.at("cat"sv) - 0.75) < EPSILON);
+    ASSERT(abs(frequencies.at("dog"sv) - 0.25) < EPSILON);
+    ASSERT(search_server.GetWordFrequencies(3).empty());
+
+    // Matching looks the query terms up in the forward array of the document
+    const string query = "cat dog"s;
+    const auto [words, status] = search_server.MatchDocument(query, 2);
+    ASSERT(words == vector<string_view>{"dog"sv});
+
+    search_server.RemoveDocument(1);
+    ASSERT(search_server.GetWordFrequencies(1).empty());
+    ASSERT(search_server.FindTopDocuments("cat"s).empty());
+    ASSERT_EQUAL(search_server.GetWordFrequencies(2).at("dog"sv), 1.0);
+}
+
+void TestReleasedTermsAreReused()
+{
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "alpha beta"s, DocumentStatus::ACTUAL, {});
+    search_server.RemoveDocument(1);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 0);
+    ASSERT(search_server.begin() == search_server.end());
+
+    // The freed slots of alpha and beta hold other words now, none of them may match the old ones
+    search_server.AddDocument(2, "gamma delta"s, DocumentStatus::ACTUAL, {});
+    search_server.AddDocument(3, "alpha"s, DocumentStatus::ACTUAL, {});
+    ASSERT(GetIds(search_server.FindTopDocuments("alpha"s)) == vector<int>{3});
+    ASSERT(GetIds(search_server.FindTopDocuments("gamma"s)) == vector<int>{2});
+    ASSERT(search_server.FindTopDocuments("beta"s).empty());
+    const auto frequencies = search_server.GetWordFrequencies(2);
+    ASSERT(frequencies.count("gamma"sv) == 1 && frequencies.count("delta"sv) == 1);
+    ASSERT((vector<int>(search_server.begin(), search_server.end()) == vector<int>{2, 3}));
+}
+
+// ---------- Pagination ----------
+
+void TestPagesFollowTheRanking()
+{
+    SearchServer search_server(""s);
+    const auto texts = MakeTexts(120, 6, 20, 5);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+    {
+        search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    }
+    const string query = "w1 w2 w3 -w4"s;
+    const SearchPage all = search_server.FindTopDocuments(query, 0, texts.size());
+    const vector<int> ranking = GetIds(all);
+    ASSERT(ranking.size() > 20u);
+    ASSERT_EQUAL(all.GetTotalCount(), ranking.size());
+    ASSERT(vector<int>(ranking.begin(), ranking.begin() + MAX_RESULT_DOCUMENT_COUNT) ==
+           GetIds(search_server.FindTopDocuments(query)));
+
+    // Pages by cursor and by offset cut the same ranking
+    vector<int> paged;
+    SearchPage page = search_server.FindTopDocuments(query, 0, 7);
+    while (page.begin() != page.end())
+    {
+        ASSERT_EQUAL(page.GetOffset(), paged.size());
+        ASSERT(GetIds(search_server.FindTopDocuments(query, page.GetOffset(), 7)) == GetIds(page));
+        const vector<int> ids = GetIds(page);
+        paged.insert(paged.end(), ids.begin(), ids.end());
+        page = search_server.FindTopDocuments(page.GetNextCursor(), 7);
+    }
+    ASSERT(paged == ranking);
+    ASSERT(GetIds(search_server.FindTopDocuments(query, ranking.size() + 10, 7)).empty());
+}
+
+void TestPagesAreStableAcrossChanges()
+{
+    SearchServer search_server = MakeAnimalServer();
+    const SearchPage first = search_server.FindTopDocuments("cat nasty"s, 0, 1);
+    const vector<int> first_ids = GetIds(first);
+
+    // A page keeps its documents, the next page is scored against the changed index
+    search_server.AddDocument(5, "cat cat cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT(GetIds(first) == first_ids);
+    const SearchPage next = search_server.FindTopDocuments(first.GetNextCursor(), 10);
+    ASSERT_EQUAL(next.GetOffset(), 1u);
+    ASSERT_EQUAL(next.GetTotalCount(), 4u);
+    ASSERT(GetIds(next) == GetIds(search_server.FindTopDocuments("cat nasty"s, 1, 10)));
+
+    const SearchServer other = MakeAnimalServer();
+    ASSERT_THROWS(other.FindTopDocuments(first.GetNextCursor(), 1), invalid_argument);
+    ASSERT_THROWS(search_server.FindTopDocuments(SearchCursor(), 1), invalid_argument);
+}
+
+// ---------- Request queues ----------
+
+void TestConcurrentRequestQueueMatchesRequestQueue()
+{
+    const SearchServer search_server = MakeAnimalServer();
+    RequestQueue request_queue(search_server);
+    ConcurrentRequestQueue concurrent_queue(search_server);
+    ConcurrentRequestQueue small_queue(search_server, 3);
+    const auto is_empty_request = [](int i)
+    {
+        // Runs of empty and non-empty requests, so the window gains and loses them
+        return (i / 7) % 3 != 0;
+    };
+    for (int i = 0; i < 2000; ++i)
+    {
+        const string query = is_empty_request(i) ? "parrot"s : "cat"s;
+        request_queue.AddFindRequest(query);
+        concurrent_queue.AddFindRequest(query);
+        small_queue.AddFindRequest(query, DocumentStatus::ACTUAL);
+        ASSERT_EQUAL(concurrent_queue.GetNoResultRequests(), request_queue.GetNoResultRequests());
+        int expected = 0;
+        for (int j = max(0, i - 2); j <= i; ++j)
+        {
+            expected += is_empty_request(j);
+        }
+        ASSERT_EQUAL(small_queue.GetNoResultRequests(), expected);
+    }
+}
+
+void TestConcurrentRequestQueueCountsEveryThread()
+{
+    const SearchServer search_server = MakeAnimalServer();
+    const int thread_count = 4;
+    const int requests_per_thread = 500;
+    ConcurrentRequestQueue request_queue(search_server, thread_count * requests_per_thread);
+    vector<thread> threads;
+    for (int t = 0; t < thread_count; ++t)
+    {
+        threads.emplace_back([&request_queue]
+                             {
+                                 for (int i = 0; i < requests_per_thread; ++i)
+                                 {
+                                     request_queue.AddFindRequest(i % 2 == 0 ? "parrot"s : "cat"s);
+                                 }
+                             });
+    }
+    for (thread &t : threads)
+    {
+        t.join();
+    }
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), thread_count * requests_per_thread / 2);
+}
+
+void TestConcurrentRequestQueueTimeWindow()
+{
+    const SearchServer search_server = MakeAnimalServer();
+    ConcurrentRequestQueue request_queue(search_server, chrono::milliseconds(100), 10);
+    for (int i = 0; i < 5; ++i)
+    {
+        request_queue.AddFindRequest("parrot"s);
+        request_queue.AddFindRequest("cat"s);
+    }
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 5);
+    this_thread::sleep_for(chrono::milliseconds(250));
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 0);
+    request_queue.AddFindRequest("parrot"s);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1);
+}
+
+// ---------- Impact scoring ----------
+
+void TestImpactScoringWithoutToleranceIsExact()
+{
+    SearchServer exact(""s);
+    SearchServer impact(""s);
+    impact.SetScoringMode(ScoringMode::IMPACT, 0.0);
+    ASSERT(impact.GetScoringMode() == ScoringMode::IMPACT);
+    const auto queries = MakeTexts(20, 3, 90, 7);
+    ForEachCorpusChange(exact, impact, [&]
+                        {
+                            for (const string &query : queries)
+                            {
+                                AssertSameTop(exact.FindTopDocuments(query), impact.FindTopDocuments(query), query);
+                                AssertSameTop(exact.FindTopDocuments(execution::par, query),
+                                              impact.FindTopDocuments(execution::par, query), query);
+                            }
+                        });
+    ASSERT_THROWS(impact.SetScoringMode(ScoringMode::IMPACT, -0.1), invalid_argument);
+}
+
+void TestImpactScoringStaysWithinTolerance()
+{
+    const double tolerance = 0.05;
+    const int plus_words = 3;
+    // Every IDF is off by at most 2 * log(1 + tolerance) and term frequencies are at most 1
+    const double max_error = plus_words * 2 * log(1 + tolerance) + EPSILON;
+    SearchServer exact(""s);
+    SearchServer impact(""s);
+    impact.SetScoringMode(ScoringMode::IMPACT, tolerance);
+    const auto queries = MakeTexts(20, plus_words, 90, 8);
+    ForEachCorpusChange(exact, impact, [&]
+                        {
+                            for (const string &query : queries)
+                            {
+                                const SearchPage expected = exact.FindTopDocuments(query, 0, 1000);
+                                for (const Document &document : impact.FindTopDocuments(query, 0, 1000))
+                                {
+                                    const auto it = find_if(expected.begin(), expected.end(), [&](const Document &other)
+                                                            {
+                                                                return other.id == document.id;
+                                                            });
+                                    ASSERT_HINT(it != expected.end(), query);
+                                    ASSERT_HINT(abs(it->relevance - document.relevance) <= max_error, query);
+                                }
+                            }
+                        });
+
+    // Switching back computes IDF from the current counts again
+    impact.SetScoringMode(ScoringMode::EXACT);
+    for (const string &query : queries)
+    {
+        AssertSameTop(exact.FindTopDocuments(query), impact.FindTopDocuments(query), query);
+    }
+}
+
+// ---------- Query arena ----------
+
+void TestQueryArenaIsReleasedByOutermostScope()
+{
+    void *first = nullptr;
+    {
+        QueryArenaScope outer;
+        first = outer.GetResource()->allocate(100);
+        {
+            QueryArenaScope inner;
+            ASSERT(inner.GetResource() == outer.GetResource());
+            void *second = inner.GetResource()->allocate(100);
+            ASSERT(second != first);
+        }
+        // The inner scope did not release the arena, so the next block does not reuse the first ones
+        void *third = outer.GetResource()->allocate(100);
+        ASSERT(third != first);
+    }
+    {
+        QueryArenaScope scope;
+        ASSERT(scope.GetResource()->allocate(100) == first);
+    }
+
+    // Every thread has its own arena
+    {
+        QueryArenaScope scope;
+        pmr::memory_resource *other = nullptr;
+        thread([&other]
+               {
+                   QueryArenaScope other_scope;
+                   other = other_scope.GetResource();
+               })
+            .join();
+        ASSERT(other != scope.GetResource());
+    }
+}
+
+void TestQueriesLargerThanArena()
+{
+    // Enough matched documents to overflow the initial arena of the thread
+    SearchServer search_server(""s);
+    const int document_count = 20000;
+    for (int id = 0; id < document_count; ++id)
+    {
+        search_server.AddDocument(id, id % 2 == 0 ? "common even"s : "common odd"s, DocumentStatus::ACTUAL, {id});
+    }
+    for (int repeat = 0; repeat < 3; ++repeat)
+    {
+        // The arena grows after the first query, the results must not change
+        const SearchPage page = search_server.FindTopDocuments("common -odd"s, 0, document_count);
+        ASSERT_EQUAL(page.GetTotalCount(), static_cast<size_t>(document_count / 2));
+        AssertSameTop(search_server.FindTopDocuments(execution::par, "common -odd"s),
+                      search_server.FindTopDocuments("common -odd"s), "common -odd"s);
+    }
+}
+
+// ---------- Batched removal ----------
+
+void TestRemoveDocumentsMatchesOneByOne()
+{
+    const auto texts = MakeTexts(300, 8, 100, 9);
+    const auto queries = MakeTexts(30, 3, 100, 10);
+    SearchServer one_by_one(""s);
+    SearchServer batched_seq(""s);
+    SearchServer batched_par(""s);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+    {
+        for (SearchServer *search_server : {&one_by_one, &batched_seq, &batched_par})
+        {
+            search_server->AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        }
+    }
+
+    // Unknown and repeated ids are ignored
+    vector<int> removed = {1000, 5, 5};
+    for (int id = 0; id < static_cast<int>(texts.size()); id += 2)
+    {
+        removed.push_back(id);
+    }
+    for (int id : removed)
+    {
+        one_by_one.RemoveDocument(id);
+    }
+    batched_seq.RemoveDocuments(execution::seq, removed);
+    batched_par.RemoveDocuments(execution::par, removed);
+
+    for (const SearchServer *search_server : {&batched_seq, &batched_par})
+    {
+        ASSERT_EQUAL(search_server->GetDocumentCount(), one_by_one.GetDocumentCount());
+        ASSERT((vector<int>(search_server->begin(), search_server->end()) ==
+                vector<int>(one_by_one.begin(), one_by_one.end())));
+        ASSERT_EQUAL(search_server->GetMemoryStats().Total(), one_by_one.GetMemoryStats().Total());
+        for (const string &query : queries)
+        {
+            AssertSameTop(one_by_one.FindTopDocuments(query), search_server->FindTopDocuments(query), query);
+        }
+        for (int id = 0; id < 10; ++id)
+        {
+            ASSERT(search_server->GetWordFrequencies(id) == one_by_one.GetWordFrequencies(id));
+        }
+    }
+
+    // Removing everything leaves an empty index
+    batched_par.RemoveDocuments(vector<int>(batched_par.begin(), batched_par.end()));
+    ASSERT_EQUAL(batched_par.GetDocumentCount(), 0);
+    ASSERT(batched_par.FindTopDocuments(queries[0]).empty());
+}
+
+// ---------- Minus-word bitmap ----------
+
+void TestDocumentBitmap()
+{
+    ASSERT(!DocumentBitmap().Contains(0));
+    ASSERT_EQUAL(DocumentBitmap().GetSize(), 0u);
+
+    vector<uint64_t> probes;
+    for (uint64_t id = 0; id < 300; ++id)
+    {
+        probes.push_back(id);
+        probes.push_back(65536 - 150 + id);
+        probes.push_back((uint64_t(1) << 40) + id);
+    }
+    probes.push_back(numeric_limits<uint64_t>::max());
+
+    // Dense, with repeated ids
+    AssertBitmapMatchesSet({7, 3, 3, 100, 64, 63, 65, 10}, probes);
+
+    // Sparse: arrays on both sides of a chunk boundary, far chunks and a chunk dense enough for a bitmap
+    vector<uint64_t> sparse = {0, 65535, 65536, 65600, uint64_t(1) << 40, (uint64_t(1) << 40) + 299};
+    mt19937 generator(11);
+    for (size_t i = 0; i < 2 * DocumentBitmap::SPARSE_CHUNK_LIMIT; ++i)
+    {
+        const uint64_t id = (uint64_t(5) << 16) + generator() % 65536;
+        sparse.push_back(id);
+        probes.push_back(id);
+        probes.push_back(id + 1);
+    }
+    AssertBitmapMatchesSet(sparse, probes);
+
+    // Negative ids of a signed DocumentId convert to values above the non-negative ones
+    const uint64_t minus_one = static_cast<uint64_t>(int64_t(-1));
+    AssertBitmapMatchesSet({1, 2, 3}, {minus_one, 0, 4});
+    AssertBitmapMatchesSet({minus_one, 2}, {minus_one, 0, 1, 2, minus_one - 1});
+}
+
+void TestMinusWordsExcludeDocuments()
+{
+    SearchServer search_server(""s);
+    const int document_count = 3000;
+    for (int id = 0; id < document_count; ++id)
+    {
+        // "rare" is in a few documents spread over the ids, "many" in every other one
+        string text = "common"s;
+        text += id % 2 == 0 ? " many"s : ""s;
+        text += id % 997 == 0 ? " rare"s : ""s;
+        search_server.AddDocument(id * 40, text, DocumentStatus::ACTUAL, {id});
+    }
+    for (const string &query : {"common -rare"s, "common -many"s, "common -rare -many"s})
+    {
+        const SearchPage page = search_server.FindTopDocuments(query, 0, document_count);
+        for (const Document &document : page)
+        {
+            const auto words = search_server.GetWordFrequencies(document.id);
+            ASSERT_HINT(words.count("rare"sv) == 0 || query.find("-rare"s) == string::npos, query);
+            ASSERT_HINT(words.count("many"sv) == 0 || query.find("-many"s) == string::npos, query);
+        }
+        AssertSameTop(search_server.FindTopDocuments(query), search_server.FindTopDocuments(execution::par, query), query);
+    }
+    ASSERT_EQUAL(search_server.FindTopDocuments("common -rare"s, 0, document_count).GetTotalCount(), 2996u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("common -many"s, 0, document_count).GetTotalCount(), 1500u);
+}
+
+// ---------- Copy-on-write versions ----------
+
+void TestCloneIsIsolated()
+{
+    SearchServer original = MakeAnimalServer();
+    const auto cat_before = GetIds(original.FindTopDocuments("cat"s));
+
+    SearchServer clone = original.Clone();
+    clone.AddDocument(5, "cat cat"s, DocumentStatus::ACTUAL, {});
+    clone.RemoveDocument(1);
+    ASSERT(GetIds(original.FindTopDocuments("cat"s)) == cat_before);
+    ASSERT_EQUAL(original.GetDocumentCount(), 4);
+    ASSERT(GetIds(clone.FindTopDocuments("cat"s)) == (vector<int>{5, 2}));
+
+    // And the other way round, once the clone is done with
+    original.RemoveDocument(2);
+    original.AddDocument(6, "curly"s, DocumentStatus::ACTUAL, {});
+    ASSERT(GetIds(clone.FindTopDocuments("curly"s)) == vector<int>{2});
+    ASSERT(GetIds(original.FindTopDocuments("curly"s)) == vector<int>{6});
+    ASSERT(clone.GetWordFrequencies(6).empty());
+}
+
+void TestVersionsArePublishedAtomically()
+{
+    VersionedSearchServer versions(MakeAnimalServer());
+    const auto old_snapshot = versions.Acquire();
+    ASSERT_EQUAL(versions.GetVersion(), 1u);
+
+    versions.Update([](SearchServer &next)
+                    {
+                        next.AddDocument(5, "parrot"s, DocumentStatus::ACTUAL, {});
+                    });
+    ASSERT_EQUAL(versions.GetVersion(), 2u);
+    ASSERT(old_snapshot->FindTopDocuments("parrot"s).empty());
+    ASSERT(GetIds(versions.Acquire()->FindTopDocuments("parrot"s)) == vector<int>{5});
+
+    // A failed update publishes nothing
+    ASSERT_THROWS(versions.Update([](SearchServer &next)
+                                  {
+                                      next.RemoveDocument(5);
+                                      next.AddDocument(1, "duplicate"s, DocumentStatus::ACTUAL, {});
+                                  }),
+                  invalid_argument);
+    ASSERT_EQUAL(versions.GetVersion(), 2u);
+    ASSERT_EQUAL(versions.Acquire()->GetDocumentCount(), 5);
+
+    SearchServer next = versions.CloneCurrent();
+    next.RemoveDocument(5);
+    versions.Publish(move(next));
+    ASSERT_EQUAL(versions.GetVersion(), 3u);
+    ASSERT(versions.Acquire()->FindTopDocuments("parrot"s).empty());
+}
+
+void TestReadersSeeWholeVersions()
+{
+    SearchServer initial(""s);
+    initial.AddDocument(0, "all"s, DocumentStatus::ACTUAL, {});
+    VersionedSearchServer versions(move(initial));
+    atomic<bool> done = false;
+    thread writer([&]
+                  {
+                      for (int id = 1; id <= 200; ++id)
+                      {
+                          versions.Update([id](SearchServer &next)
+                                          {
+                                              next.AddDocument(id, "all"s, DocumentStatus::ACTUAL, {});
+                                          });
+                      }
+                      done = true;
+                  });
+    int last_count = 0;
+    while (!done)
+    {
+        // A snapshot never changes under its reader and versions only grow
+        const auto snapshot = versions.Acquire();
+        const int count = snapshot->GetDocumentCount();
+        ASSERT(count >= last_count);
+        ASSERT_EQUAL(snapshot->FindTopDocuments("all"s, 0, 1000).GetTotalCount(), static_cast<size_t>(count));
+        last_count = count;
+    }
+    writer.join();
+    ASSERT_EQUAL(versions.Acquire()->GetDocumentCount(), 201);
+}
+
+// ---------- Write-ahead log and snapshots ----------
+
+void TestWriteAheadLogRecovery()
+{
+    TemporaryDirectory directory;
+    const string path = directory.GetPath() + "/wal"s;
+    {
+        WriteAheadLog log(path, 1);
+        log.AppendAddDocument(1, "cat dog"s, DocumentStatus::BANNED, {1, -2});
+        log.AppendRemoveDocuments({1, 7});
+        log.Sync(log.AppendAddDocument(2, "parrot"s, DocumentStatus::ACTUAL, {}));
+        ASSERT_EQUAL(log.GetLastLsn(), 3u);
+    }
+    const uintmax_t intact_size = filesystem::file_size(path);
+    // A record torn by a crash: its header promises more than was written
+    AppendToFile(path, string("\x40\x00\x00\x00\x12\x34\x56\x78\x01"s));
+
+    const vector<LogRecord> records = WriteAheadLog::Recover(path);
+    ASSERT_EQUAL(records.size(), 3u);
+    ASSERT(records[0].type == LogRecordType::ADD_DOCUMENT && records[0].document_id == 1);
+    ASSERT(records[0].status == DocumentStatus::BANNED && records[0].text == "cat dog"s);
+    ASSERT(records[0].ratings == (vector<int>{1, -2}));
+    ASSERT(records[1].type == LogRecordType::REMOVE_DOCUMENTS && records[1].document_ids == (vector<int>{1, 7}));
+    ASSERT_EQUAL(records[2].lsn, 3u);
+    ASSERT_EQUAL(filesystem::file_size(path), intact_size);
+
+    // Appending continues after the cut, and a record with a broken checksum drops itself and the rest
+    {
+        WriteAheadLog log(path, 4);
+        log.Sync(log.AppendRemoveDocuments({2}));
+    }
+    string bytes;
+    {
+        ifstream input(path, ios::binary);
+        bytes.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    }
+    ASSERT_EQUAL(WriteAheadLog::Recover(path).size(), 4u);
+    bytes[intact_size + 8] ^= 1;
+    ofstream(path, ios::binary | ios::trunc) << bytes;
+    ASSERT_EQUAL(WriteAheadLog::Recover(path).size(), 3u);
+}
+
+void TestGroupCommit()
+{
+    TemporaryDirectory directory;
+    WriteAheadLog log(directory.GetPath() + "/wal"s, 1, WriteAheadLogOptions{chrono::microseconds(2000)});
+    const int thread_count = 4;
+    const int records_per_thread = 25;
+    vector<thread> threads;
+    for (int t = 0; t < thread_count; ++t)
+    {
+        threads.emplace_back([&log, t]
+                             {
+                                 for (int i = 0; i < records_per_thread; ++i)
+                                 {
+                                     log.Sync(log.AppendRemoveDocuments({t * records_per_thread + i}));
+                                 }
+                             });
+    }
+    for (thread &t : threads)
+    {
+        t.join();
+    }
+    ASSERT_EQUAL(log.GetLastLsn(), static_cast<uint64_t>(thread_count * records_per_thread));
+    ASSERT(log.GetSyncCount() <= log.GetLastLsn());
+    ASSERT_EQUAL(WriteAheadLog::Recover(directory.GetPath() + "/wal"s).size(),
+                 static_cast<size_t>(thread_count * records_per_thread));
+}
+
+void TestDurableSearchServerSurvivesRestart()
+{
+    TemporaryDirectory directory;
+    const string path = directory.GetPath() + "/index"s;
+    vector<int> expected_ids;
+    {
+        DurableSearchServer durable(path, "and"s);
+        durable.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+        durable.AddDocuments({{2, "cat"sv, DocumentStatus::ACTUAL, {2}}, {3, "dog"sv, DocumentStatus::ACTUAL, {3}}});
+        durable.Checkpoint();
+        durable.RemoveDocument(1);
+        durable.AddDocument(4, "cat cat dog"s, DocumentStatus::BANNED, {4});
+        ASSERT_THROWS(durable.AddDocument(4, "again"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+        durable.RemoveDocuments({3, 100});
+        expected_ids = GetIds(durable.Read().search_server.FindTopDocuments("cat dog"s, DocumentStatus::BANNED));
+    }
+    {
+        // The snapshot, then the log after it; the failed add was never logged
+        DurableSearchServer durable(path, "ignored"s);
+        {
+            const auto access = durable.Read();
+            const SearchServer &search_server = access.search_server;
+            ASSERT((vector<int>(search_server.begin(), search_server.end()) == vector<int>{2, 4}));
+            ASSERT(GetIds(search_server.FindTopDocuments("cat dog"s, DocumentStatus::BANNED)) == expected_ids);
+            ASSERT(search_server.FindTopDocuments("and"s).empty());
+        }
+        durable.AddDocument(5, "parrot"s, DocumentStatus::ACTUAL, {});
+    }
+    // A crash in the middle of the last append loses only that record
+    AppendToFile(path + "/wal"s, string("\x10\x00\x00"s));
+    DurableSearchServer durable(path, ""s);
+    ASSERT_EQUAL(durable.Read().search_server.GetDocumentCount(), 3);
+    ASSERT(GetIds(durable.Read().search_server.FindTopDocuments("parrot"s)) == vector<int>{5});
+}
+
+void TestDurableReadsWaitForChanges()
+{
+    TemporaryDirectory directory;
+    DurableSearchServer durable(directory.GetPath() + "/index"s, ""s);
+    atomic<bool> done = false;
+    thread writer([&]
+                  {
+                      for (int id = 0; id < 200; ++id)
+                      {
+                          durable.AddDocument(id, "all"s, DocumentStatus::ACTUAL, {});
+                      }
+                      done = true;
+                  });
+    int last_count = 0;
+    while (!done)
+    {
+        // Never in the middle of a change: the document count and the search agree
+        const auto access = durable.Read();
+        const int count = access.search_server.GetDocumentCount();
+        ASSERT(count >= last_count);
+        ASSERT_EQUAL(access.search_server.FindTopDocuments("all"s, 0, 1000).GetTotalCount(), static_cast<size_t>(count));
+        last_count = count;
+    }
+    writer.join();
+    ASSERT_EQUAL(durable.Read().search_server.GetDocumentCount(), 200);
+}
+
+void TestSnapshotRoundTrip()
+{
+    SearchServer search_server = MakeAnimalServer();
+    search_server.SetScoringMode(ScoringMode::IMPACT, 0.1);
+    string snapshot;
+    search_server.SaveSnapshot(snapshot);
+    const SearchServer loaded = SearchServer::LoadSnapshot(snapshot);
+    ASSERT(loaded.GetScoringMode() == ScoringMode::IMPACT);
+    ASSERT_EQUAL(loaded.GetDocumentCount(), search_server.GetDocumentCount());
+    for (const string &query : {"curly nasty cat"s, "with"s, "dog -eyes"s})
+    {
+        AssertSameTop(search_server.FindTopDocuments(query), loaded.FindTopDocuments(query), query);
+    }
+
+    // Truncated images and counts larger than the rest of the image are rejected
+    for (size_t size = 0; size < snapshot.size(); size += 3)
+    {
+        ASSERT_THROWS(SearchServer::LoadSnapshot(string_view(snapshot).substr(0, size)), invalid_argument);
+    }
+    // Counts of stop words, words and documents of an empty server follow the 13-byte header
+    string empty;
+    SearchServer(""s).SaveSnapshot(empty);
+    ASSERT_EQUAL(empty.size(), 25u);
+    for (size_t count_offset : {13, 17, 21})
+    {
+        string inflated = empty;
+        inflated.replace(count_offset, 4, "\xff\xff\xff\x7f"s);
+        ASSERT_THROWS(SearchServer::LoadSnapshot(inflated), invalid_argument);
+    }
+}
+
+// ---------- Segmented index ----------
+
+void TestSegmentedSearchMatchesSingleServer()
+{
+    const auto texts = MakeTexts(400, 8, 60, 12);
+    const auto queries = MakeTexts(30, 3, 70, 13);
+    SearchServer single(""s);
+    SegmentedSearchServer segmented(""s, 16, 2);
+    const auto check = [&]
+    {
+        ASSERT_EQUAL(segmented.GetDocumentCount(), single.GetDocumentCount());
+        for (const string &query : queries)
+        {
+            AssertSameTop(single.FindTopDocuments(query), segmented.FindTopDocuments(query), query);
+            AssertSameTop(single.FindTopDocuments(query + " -w2"s), segmented.FindTopDocuments(query + " -w2"s), query);
+        }
+    };
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+    {
+        single.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        segmented.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        // Removals hit sealed segments, segments being merged and the mutable one
+        if (id % 5 == 4)
+        {
+            single.RemoveDocument(id - 3);
+            segmented.RemoveDocument(id - 3);
+        }
+        if (id % 100 == 99)
+        {
+            check();
+        }
+    }
+    segmented.WaitForMerges();
+    check();
+    segmented.Flush();
+    segmented.WaitForMerges();
+    check();
+    // Tiers of 16 * 2^k documents: a merged index keeps a segment or two per tier
+    ASSERT(segmented.GetSegmentCount() <= 10u);
+}
+
+void TestSegmentedRemovalSurvivesMerges()
+{
+    SegmentedSearchServer segmented("and"s, 4, 2);
+    for (int id = 0; id < 64; ++id)
+    {
+        segmented.AddDocument(id, id % 2 == 0 ? "cat and dog"s : "cat"s, DocumentStatus::ACTUAL, {id});
+    }
+    ASSERT_THROWS(segmented.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+    for (int id = 0; id < 64; id += 2)
+    {
+        segmented.RemoveDocument(id);
+    }
+    segmented.Flush();
+    segmented.WaitForMerges();
+    ASSERT_EQUAL(segmented.GetDocumentCount(), 32);
+    ASSERT(segmented.FindTopDocuments("dog"s).empty());
+    ASSERT_EQUAL(segmented.FindTopDocuments("cat"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    const auto [words, status] = segmented.MatchDocument("cat dog"s, 63);
+    ASSERT(words == vector<string>{"cat"s});
+    ASSERT(status == DocumentStatus::ACTUAL);
+    ASSERT_THROWS(segmented.MatchDocument("cat"s, 0), out_of_range);
+}
+
+// ---------- Index traits ----------
+
+void TestIndexTraitsRankAlike()
+{
+    static_assert(is_same_v<decltype(BasicSearchServer<CompactIndexTraits>::Document::id), uint32_t>);
+    static_assert(is_same_v<decltype(BasicSearchServer<CompactIndexTraits>::Document::relevance), float>);
+    static_assert(is_same_v<decltype(BasicSearchServer<WideIndexTraits>::Document::id), int64_t>);
+    static_assert(is_same_v<SearchServer, BasicSearchServer<DefaultIndexTraits>>);
+
+    const auto texts = MakeTexts(300, 8, 60, 14);
+    const auto queries = MakeTexts(30, 3, 70, 15);
+    SearchServer default_server(""s);
+    BasicSearchServer<CompactIndexTraits> compact_server(""s);
+    BasicSearchServer<WideIndexTraits> wide_server(""s);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+    {
+        default_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        compact_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        wide_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    }
+    compact_server.RemoveDocuments({0, 1, 2});
+    wide_server.RemoveDocuments({0, 1, 2});
+    default_server.RemoveDocuments({0, 1, 2});
+    for (const string &query : queries)
+    {
+        const string with_minus = query + " -w3"s;
+        ASSERT_HINT(GetTopIds(compact_server, with_minus) == GetTopIds(default_server, with_minus), with_minus);
+        ASSERT_HINT(GetTopIds(wide_server, with_minus) == GetTopIds(default_server, with_minus), with_minus);
+    }
+
+    // The paged, prepared and matching paths of the other layouts
+    const auto page = compact_server.FindTopDocuments(queries[0], 0, 1000);
+    ASSERT_EQUAL(page.GetTotalCount(), default_server.FindTopDocuments(queries[0], 0, 1000).GetTotalCount());
+    const auto prepared = wide_server.PrepareQuery(queries[0]);
+    ASSERT(GetTopIds(wide_server, queries[0]).size() == wide_server.FindTopDocuments(prepared).size());
+    const string query = "w1 w2 w3"s;
+    ASSERT(get<0>(compact_server.MatchDocument(query, 10u)) == get<0>(default_server.MatchDocument(query, 10)));
+}
+
+void TestWideDocumentIds()
+{
+    const int64_t large_id = (int64_t(1) << 40) + 5;
+    BasicSearchServer<WideIndexTraits> search_server("and"s);
+    search_server.AddDocument(large_id, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(large_id + (int64_t(1) << 33), "cat"s, DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, {3});
+    ASSERT_THROWS(search_server.AddDocument(-1, "dog"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+    ASSERT((GetTopIds(search_server, "cat -dog"s) == vector<int64_t>{large_id + (int64_t(1) << 33)}));
+
+    // 64-bit ids survive a snapshot
+    string snapshot;
+    search_server.SaveSnapshot(snapshot);
+    const auto loaded = BasicSearchServer<WideIndexTraits>::LoadSnapshot(snapshot);
+    ASSERT(GetTopIds(loaded, "cat dog"s) == GetTopIds(search_server, "cat dog"s));
+    ASSERT(loaded.GetWordFrequencies(large_id).size() == 2);
+
+    // The default layout keeps 32-bit ids in its snapshots, the wide one stores 64 bits
+    SearchServer default_server(""s);
+    default_server.AddDocument(7, "cat"s, DocumentStatus::ACTUAL, {});
+    BasicSearchServer<WideIndexTraits> wide_server(""s);
+    wide_server.AddDocument(7, "cat"s, DocumentStatus::ACTUAL, {});
+    string default_snapshot;
+    string wide_snapshot;
+    default_server.SaveSnapshot(default_snapshot);
+    wide_server.SaveSnapshot(wide_snapshot);
+    ASSERT_EQUAL(wide_snapshot.size(), default_snapshot.size() + sizeof(uint32_t));
+}
+
+// ---------- Auto execution policy ----------
+
+void TestParallelThresholdDecision()
+{
+    SetParallelThreshold(1000);
+    ASSERT_EQUAL(GetParallelThreshold(), 1000u);
+    ASSERT(!IsParallelWorthwhile(999, 8));
+    ASSERT(IsParallelWorthwhile(1000, 8));
+    // A single task cannot be split, however large
+    ASSERT(!IsParallelWorthwhile(1000000, 1));
+    SetParallelThreshold(0);
+    ASSERT_EQUAL(GetParallelThreshold(), 1u);
+    ASSERT(!IsParallelWorthwhile(0, 8));
+
+    const size_t calibrated = CalibrateParallelThreshold();
+    ASSERT(calibrated > 0);
+    ASSERT_EQUAL(GetParallelThreshold(), calibrated);
+}
+
+void TestAutoPolicyMatchesSequential()
+{
+    const auto texts = MakeTexts(500, 8, 50, 16);
+    const auto queries = MakeTexts(20, 3, 60, 17);
+    // Thresholds that make every call parallel and every call sequential
+    for (size_t threshold : {size_t(1), numeric_limits<size_t>::max()})
+    {
+        SetParallelThreshold(threshold);
+        SearchServer sequential(""s);
+        SearchServer automatic(""s);
+        for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+        {
+            sequential.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+            automatic.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        }
+        for (int id = 0; id < static_cast<int>(texts.size()); id += 4)
+        {
+            sequential.RemoveDocument(execution::seq, id);
+            automatic.RemoveDocument(auto_policy, id);
+        }
+        ASSERT_EQUAL(automatic.GetDocumentCount(), sequential.GetDocumentCount());
+        for (const string &query : queries)
+        {
+            AssertSameTop(sequential.FindTopDocuments(execution::seq, query),
+                          automatic.FindTopDocuments(auto_policy, query), query);
+            AssertSameTop(sequential.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL),
+                          automatic.FindTopDocuments(auto_policy, query, DocumentStatus::ACTUAL), query);
+            const string with_minus = query + " -w1"s;
+            for (int id = 1; id < 20; id += 4)
+            {
+                const auto [expected_words, expected_status] = sequential.MatchDocument(execution::seq, with_minus, id);
+                const auto [words, status] = automatic.MatchDocument(auto_policy, with_minus, id);
+                ASSERT_HINT(words == expected_words && status == expected_status, with_minus);
+            }
+        }
+        ASSERT_THROWS(automatic.MatchDocument(auto_policy, queries[0], 0), out_of_range);
+    }
+    CalibrateParallelThreshold();
+}
+
+// ---------- Fuzzy search ----------
+
+void TestOptimalStringAlignmentDistance()
+{
+    const auto distance = [](string_view lhs, string_view rhs)
+    {
+        return FuzzyTermIndex::ComputeEditDistance(lhs, rhs, 10);
+    };
+    ASSERT_EQUAL(distance("cat"sv, "cat"sv), 0);
+    ASSERT_EQUAL(distance(""sv, "abc"sv), 3);
+    ASSERT_EQUAL(distance("cat"sv, "cut"sv), 1);
+    ASSERT_EQUAL(distance("cat"sv, "cats"sv), 1);
+    ASSERT_EQUAL(distance("cat"sv, "act"sv), 1);
+    ASSERT_EQUAL(distance("kitten"sv, "sitting"sv), 3);
+    // An adjacent transposition is one edit, but a transposed pair is not edited again as in Damerau-Levenshtein
+    ASSERT_EQUAL(distance("ca"sv, "abc"sv), 3);
+    ASSERT_EQUAL(distance("abcd"sv, "badc"sv), 2);
+    // Distances above the limit are cut to limit + 1
+    ASSERT_EQUAL(FuzzyTermIndex::ComputeEditDistance("kitten"sv, "sitting"sv, 2), 3);
+    ASSERT_EQUAL(FuzzyTermIndex::ComputeEditDistance("a"sv, "abcdef"sv, 1), 2);
+}
+
+void TestDeletionIndexFindsAllCloseWords()
+{
+    // Words not longer than prefix_length, so the index must find exactly the words within the distance
+    mt19937 generator(18);
+    vector<string> words;
+    set<string> unique_words;
+    while (words.size() < 300)
+    {
+        string word(2 + generator() % 5, ' ');
+        for (char &c : word)
+        {
+            c = static_cast<char>('a' + generator() % 4);
+        }
+        if (unique_words.insert(word).second)
+        {
+            words.push_back(word);
+        }
+    }
+    for (int max_edit_distance : {1, 2})
+    {
+        MemoryCounter counter;
+        FuzzyOptions options;
+        options.max_edit_distance = max_edit_distance;
+        FuzzyTermIndex index(options, counter);
+        for (TermId term_id = 0; term_id < words.size(); ++term_id)
+        {
+            index.AddTerm(words[term_id], term_id);
+        }
+        // Removed terms must not be found any more
+        for (TermId term_id = 0; term_id < words.size(); term_id += 10)
+        {
+            index.RemoveTerm(words[term_id], term_id);
+        }
+        for (const string &query : {"abc"s, "dddd"s, "ab"s, "cabdab"s, "bbbbbb"s, "acbd"s})
+        {
+            set<TermId> expected;
+            for (TermId term_id = 0; term_id < words.size(); ++term_id)
+            {
+                if (term_id % 10 != 0 && FuzzyTermIndex::ComputeEditDistance(query, words[term_id], 2) <= max_edit_distance)
+                {
+                    expected.insert(term_id);
+                }
+            }
+            set<TermId> found;
+            const auto corrections = index.FindCorrections(
+                query,
+                [&words](TermId term_id) -> string_view
+                {
+                    return words[term_id];
+                },
+                pmr::get_default_resource());
+            for (const FuzzyTermIndex::Correction &correction : corrections)
+            {
+                ASSERT_EQUAL(correction.distance, FuzzyTermIndex::ComputeEditDistance(query, words[correction.term_id], 2));
+                found.insert(correction.term_id);
+            }
+            ASSERT_HINT(found == expected, query);
+        }
+        ASSERT(counter.bytes > 0);
+    }
+    MemoryCounter counter;
+    FuzzyOptions invalid;
+    invalid.max_edit_distance = 3;
+    ASSERT_THROWS(FuzzyTermIndex(invalid, counter), invalid_argument);
+}
+
+void TestFuzzySearch()
+{
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "black cart"s, DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(3, "grey dog"s, DocumentStatus::ACTUAL, {3});
+    ASSERT(search_server.FindTopDocuments("cta"s).empty());
+
+    FuzzyOptions options;
+    options.penalty = 0.5;
+    search_server.EnableFuzzySearch(options);
+    ASSERT(search_server.IsFuzzySearchEnabled());
+    ASSERT(search_server.GetMemoryStats().fuzzy > 0);
+
+    // "cta" is one transposition from "cat" and two edits from "cart", which is too far
+    const auto found = search_server.FindTopDocuments("cta"s);
+    ASSERT(GetIds(found) == vector<int>{1});
+    const double exact_relevance = search_server.FindTopDocuments("cat"s)[0].relevance;
+    ASSERT(abs(found[0].relevance - exact_relevance * options.penalty) < EPSILON);
+    // A known word is not corrected, minus-words are never corrected
+    ASSERT(GetIds(search_server.FindTopDocuments("cat"s)) == vector<int>{1});
+    ASSERT(GetIds(search_server.FindTopDocuments("cat -dgo"s)) == vector<int>{1});
+    const string query = "whyte cta"s;
+    ASSERT(get<0>(search_server.MatchDocument(query, 1)) == (vector<string_view>{"cat"sv, "white"sv}));
+
+    search_server.RemoveDocument(1);
+    ASSERT(search_server.FindTopDocuments("cta"s).empty());
+    search_server.DisableFuzzySearch();
+    ASSERT(!search_server.IsFuzzySearchEnabled());
+    ASSERT_EQUAL(search_server.GetMemoryStats().fuzzy, 0u);
+    ASSERT(search_server.FindTopDocuments("crat"s).empty());
+}
+
+// ---------- Prefix search ----------
+
+void TestFrontCodedDictionaryPrefixes()
+{
+    // Groups of words sharing prefixes across block boundaries, and words long enough for two-byte lengths
+    set<string> word_set = {"a"s, "ab"s, "abc"s, "abd"s, "b"s, string(200, 'x'), string(200, 'x') + "y"s};
+    for (int i = 0; i < 100; ++i)
+    {
+        word_set.insert("cat"s + to_string(i));
+        word_set.insert("ca"s + to_string(i * 7));
+        word_set.insert("dog"s + string(i % 5, 'g'));
+    }
+    const vector<string> words(word_set.begin(), word_set.end());
+    ASSERT(words.size() > 10 * FrontCodedDictionary::BLOCK_SIZE);
+
+    MemoryCounter counter;
+    FrontCodedDictionary dictionary(counter);
+    for (TermId term_id = 0; term_id < words.size(); ++term_id)
+    {
+        dictionary.Append(words[term_id], term_id);
+    }
+    dictionary.ShrinkToFit();
+    ASSERT_EQUAL(dictionary.GetSize(), words.size());
+
+    vector<string> prefixes = {""s, "a"s, "ab"s, "abc"s, "abe"s, "c"s, "ca"s, "cat"s, "cat9"s, "cat99"s, "cat990"s,
+                               "d"s, "dogg"s, "x"s, string(200, 'x'), string(201, 'x'), "0"s, "z"s};
+    // The first word of every block and the words around it
+    for (size_t i = 0; i < words.size(); i += FrontCodedDictionary::BLOCK_SIZE)
+    {
+        prefixes.push_back(words[i]);
+        prefixes.push_back(words[i].substr(0, words[i].size() - 1));
+        if (i > 0)
+        {
+            prefixes.push_back(words[i - 1]);
+        }
+    }
+    for (const string &prefix : prefixes)
+    {
+        vector<pair<string, TermId>> expected;
+        for (TermId term_id = 0; term_id < words.size(); ++term_id)
+        {
+            if (words[term_id].compare(0, prefix.size(), prefix) == 0)
+            {
+                expected.emplace_back(words[term_id], term_id);
+            }
+        }
+        vector<pair<string, TermId>> found;
+        dictionary.ForEachWithPrefix(prefix, [&found](string_view word, TermId term_id)
+                                     {
+                                         found.emplace_back(string(word), term_id);
+                                         return true;
+                                     });
+        ASSERT_HINT(found == expected, prefix);
+    }
+
+    // The visitor stops the walk
+    size_t visited = 0;
+    dictionary.ForEachWithPrefix("cat"sv, [&visited](string_view, TermId)
+                                 {
+                                     return ++visited < 3;
+                                 });
+    ASSERT_EQUAL(visited, 3u);
+}
+
+void TestPrefixSearch()
+{
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "cat and catalog"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "cats"s, DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, {3});
+    search_server.AddDocument(4, "cat*"s, DocumentStatus::ACTUAL, {4});
+
+    // Disabled, '*' is an ordinary character
+    ASSERT(GetIds(search_server.FindTopDocuments("cat*"s)) == vector<int>{4});
+
+    search_server.EnablePrefixSearch();
+    ASSERT(search_server.IsPrefixSearchEnabled());
+    ASSERT((GetIds(search_server.FindTopDocuments("cat*"s)) == vector<int>{4, 2, 1}));
+    ASSERT((GetIds(search_server.FindTopDocuments("ca* -cats*"s)) == vector<int>{4, 1}));
+    ASSERT(search_server.FindTopDocuments("an*"s).empty());
+    ASSERT_THROWS(search_server.FindTopDocuments("*"s), invalid_argument);
+    const string query = "cata* dog"s;
+    ASSERT(get<0>(search_server.MatchDocument(query, 1)) == vector<string_view>{"catalog"sv});
+
+    // Words added after enabling are found, removed ones are not
+    search_server.AddDocument(5, "catfish"s, DocumentStatus::ACTUAL, {5});
+    search_server.RemoveDocument(2);
+    ASSERT((GetIds(search_server.FindTopDocuments("cat*"s)) == vector<int>{5, 4, 1}));
+
+    // With an expansion limit of 1 only the first word in lexicographic order is taken
+    search_server.EnablePrefixSearch(1);
+    ASSERT(GetIds(search_server.FindTopDocuments("cat*"s)) == vector<int>{1});
+    ASSERT_THROWS(search_server.EnablePrefixSearch(0), invalid_argument);
+
+    search_server.DisablePrefixSearch();
+    ASSERT(GetIds(search_server.FindTopDocuments("cat*"s)) == vector<int>{4});
+}
+
+void TestSearchServer()
+{
+    RUN_TEST(TestPreparedQueryMatchesRawQuery);
+    RUN_TEST(TestPreparedQueryParsesOnce);
+    RUN_TEST(TestPreparedQueryIsResolvedAgainAfterChanges);
+    RUN_TEST(TestPreparedQueryIsNotReusedByANewServer);
+    RUN_TEST(TestShardedSearchMatchesSingleServer);
+    RUN_TEST(TestShardedRemovalAndMatching);
+    RUN_TEST(TestSearchWithinBudget);
+    RUN_TEST(TestSearchIsCancelledWhileScoring);
+    RUN_TEST(TestAsyncSearch);
+    RUN_TEST(TestTaskPoolRunsEveryTask);
+    RUN_TEST(TestAsyncSearchesShareThePool);
+    RUN_TEST(TestMemoryStatsFollowTheIndex);
+    RUN_TEST(TestMemoryBudget);
+    RUN_TEST(TestCompactRenumbersTerms);
+    RUN_TEST(TestCompactShrinksFlatPostings);
+    RUN_TEST(TestWordFrequenciesFromForwardIndex);
+    RUN_TEST(TestReleasedTermsAreReused);
+    RUN_TEST(TestPagesFollowTheRanking);
+    RUN_TEST(TestPagesAreStableAcrossChanges);
+    RUN_TEST(TestConcurrentRequestQueueMatchesRequestQueue);
+    RUN_TEST(TestConcurrentRequestQueueCountsEveryThread);
+    RUN_TEST(TestConcurrentRequestQueueTimeWindow);
+    RUN_TEST(TestImpactScoringWithoutToleranceIsExact);
+    RUN_TEST(TestImpactScoringStaysWithinTolerance);
+    RUN_TEST(TestQueryArenaIsReleasedByOutermostScope);
+    RUN_TEST(TestQueriesLargerThanArena);
+    RUN_TEST(TestRemoveDocumentsMatchesOneByOne);
+    RUN_TEST(TestDocumentBitmap);
+    RUN_TEST(TestMinusWordsExcludeDocuments);
+    RUN_TEST(TestCloneIsIsolated);
+    RUN_TEST(TestVersionsArePublishedAtomically);
+    RUN_TEST(TestReadersSeeWholeVersions);
+    RUN_TEST(TestWriteAheadLogRecovery);
+    RUN_TEST(TestGroupCommit);
+    RUN_TEST(TestDurableSearchServerSurvivesRestart);
+    RUN_TEST(TestDurableReadsWaitForChanges);
+    RUN_TEST(TestSnapshotRoundTrip);
+    RUN_TEST(TestSegmentedSearchMatchesSingleServer);
+    RUN_TEST(TestSegmentedRemovalSurvivesMerges);
+    RUN_TEST(TestIndexTraitsRankAlike);
+    RUN_TEST(TestWideDocumentIds);
+    RUN_TEST(TestParallelThresholdDecision);
+    RUN_TEST(TestAutoPolicyMatchesSequential);
+    RUN_TEST(TestOptimalStringAlignmentDistance);
+    RUN_TEST(TestDeletionIndexFindsAllCloseWords);
+    RUN_TEST(TestFuzzySearch);
+    RUN_TEST(TestFrontCodedDictionaryPrefixes);
+    RUN_TEST(TestPrefixSearch);
+}
@@ -1 +1,71 @@
-#pragma once
\ No newline at end of file
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Checks of the unit tests: a failed check prints its place and expression to std::cerr and aborts
+template <typename T, typename U>
+void AssertEqualImpl(const T &t, const U &u, const std::string &t_str, const std::string &u_str, const std::string &file,
+                     const std::string &func, unsigned line, const std::string &hint)
+{
+    if (t != u)
+    {
+        std::cerr << file << "(" << line << "): " << func << ": ASSERT_EQUAL(" << t_str << ", " << u_str << ") failed: "
+                  << t << " != " << u << ".";
+        if (!hint.empty())
+        {
+            std::cerr << " Hint: " << hint;
+        }
+        std::cerr << std::endl;
+        std::abort();
+    }
+}
+
+inline void AssertImpl(bool value, const std::string &expr_str, const std::string &file, const std::string &func,
+                       unsigned line, const std::string &hint)
+{
+    if (!value)
+    {
+        std::cerr << file << "(" << line << "): " << func << ": ASSERT(" << expr_str << ") failed.";
+        if (!hint.empty())
+        {
+            std::cerr << " Hint: " << hint;
+        }
+        std::cerr << std::endl;
+        std::abort();
+    }
+}
+
+#define ASSERT_EQUAL(a, b) AssertEqualImpl((a), (b), #a, #b, __FILE__, __FUNCTION__, __LINE__, "")
+#define ASSERT_EQUAL_HINT(a, b, hint) AssertEqualImpl((a), (b), #a, #b, __FILE__, __FUNCTION__, __LINE__, (hint))
+#define ASSERT(expr) AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, "")
+#define ASSERT_HINT(expr, hint) AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, (hint))
+
+// Passes if the statement throws an exception of the given type
+#define ASSERT_THROWS(statement, exception_type)                                                          \
+    do                                                                                                    \
+    {                                                                                                     \
+        bool thrown = false;                                                                              \
+        try                                                                                               \
+        {                                                                                                 \
+            statement;                                                                                    \
+        }                                                                                                 \
+        catch (const exception_type &)                                                                    \
+        {                                                                                                 \
+            thrown = true;                                                                                \
+        }                                                                                                 \
+        AssertImpl(thrown, #statement " throws " #exception_type, __FILE__, __FUNCTION__, __LINE__, ""); \
+    } while (false)
+
+template <typename TestFunc>
+void RunTestImpl(const TestFunc &func, const std::string &test_name)
+{
+    func();
+    std::cerr << test_name << " OK" << std::endl;
+}
+
+#define RUN_TEST(func) RunTestImpl(func, #func)
+
+// Unit tests of the search server, run by main before the example
+void TestSearchServer();
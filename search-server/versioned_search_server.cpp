@@ -0,0 +1,36 @@
+#include "versioned_search_server.h"
+
+using namespace std;
+
+VersionedSearchServer::VersionedSearchServer(SearchServer search_server)
+    : current_(make_shared<const SearchServer>(move(search_server)))
+{
+}
+
+VersionedSearchServer::Snapshot VersionedSearchServer::Acquire() const
+{
+    return atomic_load(&current_);
+}
+
+SearchServer VersionedSearchServer::CloneCurrent() const
+{
+    return Acquire()->Clone();
+}
+
+void VersionedSearchServer::Publish(SearchServer search_server)
+{
+    lock_guard lock(writer_mutex_);
+    PublishLocked(move(search_server));
+}
+
+void VersionedSearchServer::PublishLocked(SearchServer search_server)
+{
+    // The previous version is destroyed by its last reader, or here, still under the writer lock
+    atomic_store(&current_, make_shared<const SearchServer>(move(search_server)));
+    version_.fetch_add(1, memory_order_relaxed);
+}
+
+uint64_t VersionedSearchServer::GetVersion() const
+{
+    return version_.load(memory_order_relaxed);
+}
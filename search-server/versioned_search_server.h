@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "search_server.h"
+
+// Immutable versions of a SearchServer. Queries pin the current version with Acquire and search it without locks.
+// The next version is built aside, usually from CloneCurrent, and replaces the current one atomically with
+// Publish. A version is freed when the last snapshot of it is released.
+// Versions share posting lists copy-on-write, which allows a single writer only (see SearchServer::Clone).
+// Update serializes writers; a caller that pairs CloneCurrent and Publish itself must be the only writer
+class VersionedSearchServer
+{
+public:
+    using Snapshot = std::shared_ptr<const SearchServer>;
+
+    explicit VersionedSearchServer(SearchServer search_server);
+
+    Snapshot Acquire() const;
+
+    // Clones the current version, calls update(SearchServer &) on the clone and publishes it, all under the
+    // writer lock. If update throws, nothing is published
+    template <typename Updater>
+    void Update(Updater update);
+
+    // Copy of the current version to change and publish. Structures it does not change stay shared.
+    // Single writer only: nothing may change another clone or publish until this one is published
+    SearchServer CloneCurrent() const;
+    void Publish(SearchServer search_server);
+
+    // Number of published versions, the initial one included
+    uint64_t GetVersion() const;
+
+private:
+    void PublishLocked(SearchServer search_server);
+
+    Snapshot current_; // accessed only through std::atomic_load/std::atomic_store
+    std::atomic<uint64_t> version_{1};
+    std::mutex writer_mutex_;
+};
+
+template <typename Updater>
+void VersionedSearchServer::Update(Updater update)
+{
+    std::lock_guard lock(writer_mutex_);
+    SearchServer next = CloneCurrent();
+    update(next);
+    PublishLocked(std::move(next));
+}
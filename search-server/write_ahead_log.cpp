@@ -0,0 +1,300 @@
+#include "write_ahead_log.h"
+
+#include <cerrno>
+#include <execution>
+#include <fstream>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "binary_io.h"
+
+using namespace std;
+
+namespace
+{
+    const size_t RECORD_HEADER_SIZE = 8;
+
+    // Returns errno of the failed write, 0 on success
+    int WriteAll(int fd, string_view data)
+    {
+        while (!data.empty())
+        {
+            const ssize_t written = write(fd, data.data(), data.size());
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return errno;
+            }
+            data.remove_prefix(written);
+        }
+        return 0;
+    }
+
+    DocumentStatus ToStatus(uint8_t value)
+    {
+        if (value > static_cast<uint8_t>(DocumentStatus::REMOVED))
+        {
+            throw invalid_argument("Unknown document status "s + to_string(value));
+        }
+        return static_cast<DocumentStatus>(value);
+    }
+
+    LogRecord DecodeRecord(string_view payload)
+    {
+        ByteReader reader(payload);
+        LogRecord record;
+        const uint8_t type = reader.GetU8();
+        switch (type)
+        {
+        case static_cast<uint8_t>(LogRecordType::ADD_DOCUMENT):
+            record.type = LogRecordType::ADD_DOCUMENT;
+            record.document_id = reader.GetI32();
+            record.status = ToStatus(reader.GetU8());
+            record.text = reader.GetString();
+            record.ratings.resize(reader.GetCount(sizeof(int32_t)));
+            for (int &rating : record.ratings)
+            {
+                rating = reader.GetI32();
+            }
+            break;
+        case static_cast<uint8_t>(LogRecordType::REMOVE_DOCUMENTS):
+            record.type = LogRecordType::REMOVE_DOCUMENTS;
+            record.document_ids.resize(reader.GetCount(sizeof(int32_t)));
+            for (int &document_id : record.document_ids)
+            {
+                document_id = reader.GetI32();
+            }
+            break;
+        default:
+            throw invalid_argument("Unknown log record type "s + to_string(type));
+        }
+        record.lsn = reader.GetU64();
+        reader.ExpectEnd();
+        return record;
+    }
+}
+
+vector<LogRecord> WriteAheadLog::Recover(const string &path)
+{
+    ifstream input(path, ios::binary);
+    if (!input)
+    {
+        return {};
+    }
+    const string data((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+
+    // Record boundaries are found sequentially, checksums and decoding are done in parallel
+    vector<pair<uint32_t, string_view>> payloads;
+    for (size_t pos = 0; data.size() - pos >= RECORD_HEADER_SIZE;)
+    {
+        ByteReader header(string_view(data).substr(pos, RECORD_HEADER_SIZE));
+        const uint32_t size = header.GetU32();
+        const uint32_t crc = header.GetU32();
+        if (data.size() - pos - RECORD_HEADER_SIZE < size)
+        {
+            break;
+        }
+        payloads.emplace_back(crc, string_view(data).substr(pos + RECORD_HEADER_SIZE, size));
+        pos += RECORD_HEADER_SIZE + size;
+    }
+
+    vector<optional<LogRecord>> decoded(payloads.size());
+    vector<size_t> indexes(payloads.size());
+    iota(indexes.begin(), indexes.end(), size_t(0));
+    for_each(execution::par, indexes.begin(), indexes.end(),
+             [&](size_t i)
+             {
+                 const auto [crc, payload] = payloads[i];
+                 if (ComputeCrc32(payload) != crc)
+                 {
+                     return;
+                 }
+                 try
+                 {
+                     decoded[i] = DecodeRecord(payload);
+                 }
+                 catch (const invalid_argument &)
+                 {
+                 }
+             });
+
+    vector<LogRecord> records;
+    size_t valid_size = 0;
+    for (optional<LogRecord> &record : decoded)
+    {
+        if (!record || (!records.empty() && record->lsn <= records.back().lsn))
+        {
+            break;
+        }
+        valid_size += RECORD_HEADER_SIZE + payloads[records.size()].second.size();
+        records.push_back(move(*record));
+    }
+
+    if (valid_size < data.size())
+    {
+        // The torn tail must not be followed by new records
+        const int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd < 0 || ftruncate(fd, static_cast<off_t>(valid_size)) != 0 || fsync(fd) != 0)
+        {
+            const int error = errno;
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            throw system_error(error, generic_category(), "Cannot truncate write-ahead log "s + path);
+        }
+        close(fd);
+    }
+    return records;
+}
+
+WriteAheadLog::WriteAheadLog(const string &path, uint64_t next_lsn, WriteAheadLogOptions options)
+    : options_(options), last_lsn_(next_lsn - 1), durable_lsn_(next_lsn - 1)
+{
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+    {
+        throw system_error(errno, generic_category(), "Cannot open write-ahead log "s + path);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    close(fd_);
+}
+
+uint64_t WriteAheadLog::AppendAddDocument(int document_id, string_view document, DocumentStatus status, const vector<int> &ratings)
+{
+    string fields;
+    ByteWriter writer(fields);
+    writer.PutU8(static_cast<uint8_t>(LogRecordType::ADD_DOCUMENT));
+    writer.PutI32(document_id);
+    writer.PutU8(static_cast<uint8_t>(status));
+    writer.PutString(document);
+    writer.PutU32(static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings)
+    {
+        writer.PutI32(rating);
+    }
+    return AppendRecord(fields);
+}
+
+uint64_t WriteAheadLog::AppendRemoveDocuments(const vector<int> &document_ids)
+{
+    string fields;
+    ByteWriter writer(fields);
+    writer.PutU8(static_cast<uint8_t>(LogRecordType::REMOVE_DOCUMENTS));
+    writer.PutU32(static_cast<uint32_t>(document_ids.size()));
+    for (const int document_id : document_ids)
+    {
+        writer.PutI32(document_id);
+    }
+    return AppendRecord(fields);
+}
+
+uint64_t WriteAheadLog::AppendRecord(const string &fields)
+{
+    // The LSN goes last, so only its 8 bytes are checksummed under the lock
+    const uint32_t fields_crc = ComputeCrc32(fields);
+
+    lock_guard lock(mutex_);
+    CheckNotFailed();
+    const uint64_t lsn = ++last_lsn_;
+    string lsn_bytes;
+    ByteWriter(lsn_bytes).PutU64(lsn);
+
+    ByteWriter writer(pending_);
+    writer.PutU32(static_cast<uint32_t>(fields.size() + lsn_bytes.size()));
+    writer.PutU32(ComputeCrc32(lsn_bytes, fields_crc));
+    pending_.append(fields);
+    pending_.append(lsn_bytes);
+    return lsn;
+}
+
+void WriteAheadLog::Sync(uint64_t lsn)
+{
+    unique_lock lock(mutex_);
+    while (durable_lsn_ < lsn)
+    {
+        CheckNotFailed();
+        if (is_syncing_)
+        {
+            synced_.wait(lock);
+            continue;
+        }
+
+        is_syncing_ = true;
+        if (options_.commit_delay.count() > 0)
+        {
+            lock.unlock();
+            this_thread::sleep_for(options_.commit_delay);
+            lock.lock();
+        }
+        writing_.swap(pending_);
+        const uint64_t batch_lsn = last_lsn_;
+        lock.unlock();
+
+        int error = WriteAll(fd_, writing_);
+        if (error == 0 && fdatasync(fd_) != 0)
+        {
+            error = errno;
+        }
+
+        lock.lock();
+        writing_.clear();
+        is_syncing_ = false;
+        if (error != 0)
+        {
+            is_failed_ = true;
+            synced_.notify_all();
+            throw system_error(error, generic_category(), "Cannot write write-ahead log"s);
+        }
+        durable_lsn_ = batch_lsn;
+        ++sync_count_;
+        synced_.notify_all();
+    }
+}
+
+void WriteAheadLog::Truncate()
+{
+    lock_guard lock(mutex_);
+    CheckNotFailed();
+    if (durable_lsn_ != last_lsn_)
+    {
+        throw logic_error("Write-ahead log has unsynced records"s);
+    }
+    if (ftruncate(fd_, 0) != 0 || fsync(fd_) != 0)
+    {
+        is_failed_ = true;
+        throw system_error(errno, generic_category(), "Cannot truncate write-ahead log"s);
+    }
+}
+
+uint64_t WriteAheadLog::GetLastLsn() const
+{
+    lock_guard lock(mutex_);
+    return last_lsn_;
+}
+
+uint64_t WriteAheadLog::GetSyncCount() const
+{
+    lock_guard lock(mutex_);
+    return sync_count_;
+}
+
+void WriteAheadLog::CheckNotFailed() const
+{
+    if (is_failed_)
+    {
+        throw runtime_error("Write-ahead log has failed earlier"s);
+    }
+}
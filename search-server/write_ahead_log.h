@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+// Append-only log of index mutations. A record is uint32 payload size, uint32 CRC-32 of the payload and the payload:
+// uint8 type, the fields of the mutation and uint64 lsn, integers are little-endian. A record torn by a crash
+// fails its checksum, it and everything after it are dropped on recovery.
+
+enum class LogRecordType : uint8_t
+{
+    ADD_DOCUMENT = 1,     // document_id, status, text, ratings
+    REMOVE_DOCUMENTS = 2, // document ids
+};
+
+struct LogRecord
+{
+    uint64_t lsn = 0;
+    LogRecordType type = LogRecordType::ADD_DOCUMENT;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::string text;
+    std::vector<int> ratings;
+    std::vector<int> document_ids; // REMOVE_DOCUMENTS
+};
+
+struct WriteAheadLogOptions
+{
+    // A writer that is going to sync waits this long for more records to join it. With 0 a sync takes the records
+    // that came while the previous one was in progress, which is enough when there are many concurrent writers
+    std::chrono::microseconds commit_delay{0};
+};
+
+class WriteAheadLog
+{
+public:
+    // Records of the log at path in order of their LSN. The file is cut after the last intact record
+    static std::vector<LogRecord> Recover(const std::string &path);
+
+    // Opens the log for appending, creating it if needed. LSNs continue from next_lsn
+    WriteAheadLog(const std::string &path, uint64_t next_lsn, WriteAheadLogOptions options = {});
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    // Buffer a record and return its LSN, the record is durable once Sync(lsn) has returned
+    uint64_t AppendAddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings);
+    uint64_t AppendRemoveDocuments(const std::vector<int> &document_ids);
+
+    // Group commit: one writer writes and fsyncs the records of all waiting writers, the others wait for it.
+    // After a failed write or fsync the log refuses all further calls, as it is not known what reached the disk
+    void Sync(uint64_t lsn);
+
+    // Empties the file. Every record must be synced and no other calls may run concurrently
+    void Truncate();
+
+    uint64_t GetLastLsn() const;
+    // Number of fsyncs, less than the number of synced records when commits were grouped
+    uint64_t GetSyncCount() const;
+
+private:
+    int fd_ = -1;
+    WriteAheadLogOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable synced_;
+    std::string pending_; // records not written yet
+    std::string writing_; // records being written by the current leader
+    uint64_t last_lsn_;
+    uint64_t durable_lsn_;
+    uint64_t sync_count_ = 0;
+    bool is_syncing_ = false;
+    bool is_failed_ = false;
+
+    uint64_t AppendRecord(const std::string &fields);
+    void CheckNotFailed() const;
+};